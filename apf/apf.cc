@@ -19,6 +19,7 @@
 #include "apfUserData.h"
 #include <cstdio>
 #include <cstdlib>
+#include <PCU.h>
 #include <pcu_util.h>
 #include <lionPrint.h>
 
@@ -283,6 +284,60 @@ void getComponents(Element* e, Vector3 const& param, double* components)
   e->getComponents(param,components);
 }
 
+void getComponents(Element* e, int n, Vector3 const* params,
+    double* components)
+{
+  e->getComponents(n,params,components);
+}
+
+void getComponentGrads(Element* e, int n, Vector3 const* params,
+    double* grads)
+{
+  e->getComponentGrads(n,params,grads);
+}
+
+void getComponents(Field* f, int n, MeshEntity* const* elements,
+    Vector3 const& param, double* components)
+{
+  if (!n)
+    return;
+  Mesh* m = f->getMesh();
+  int type = m->getType(elements[0]);
+  EntityShape* s = f->getShape()->getEntityShape(type);
+  int nen = s->countNodes();
+  int nc = f->countComponents();
+  bool shared = !s->dependsOnEntity();
+  /* node data and shape values, laid out so that the
+     elements are contiguous for each node and component */
+  NewArray<double> data(nen * nc * n);
+  NewArray<double> shapeValues(nen * n);
+  NewArray<double> d;
+  NewArray<double> v;
+  if (shared)
+    s->getValues(m, elements[0], param, v);
+  for (int i = 0; i < n; ++i) {
+    PCU_DEBUG_ASSERT(m->getType(elements[i]) == type);
+    f->getData()->getElementData(elements[i], d);
+    for (int j = 0; j < nen * nc; ++j)
+      data[j * n + i] = d[j];
+    if (!shared)
+      s->getValues(m, elements[i], param, v);
+    for (int ni = 0; ni < nen; ++ni)
+      shapeValues[ni * n + i] = v[ni];
+  }
+  for (int ci = 0; ci < nc; ++ci) {
+    double* out = components + ci * n;
+    for (int i = 0; i < n; ++i)
+      out[i] = 0;
+    for (int ni = 0; ni < nen; ++ni) {
+      double const* u = &data[(ni * nc + ci) * n];
+      double const* N = &shapeValues[ni * n];
+      for (int i = 0; i < n; ++i)
+        out[i] += u[i] * N[i];
+    }
+  }
+}
+
 int countIntPoints(MeshElement* e, int order)
 {
   return getIntegration(e->getType())->getAccurate(order)->countPoints();
@@ -293,6 +348,7 @@ void getIntPoint(MeshElement* e, int order, int point, Vector3& param)
   IntegrationPoint const* p = 
     getIntegration(e->getType())->getAccurate(order)->getPoint(point);
   param = p->param;
+  e->setIntPoint(order, point);
 }
 
 double getIntWeight(MeshElement* e, int order, int point)
@@ -324,9 +380,7 @@ void getJacobian(MeshElement* e, Vector3 const& local, Matrix3x3& j)
 
 void getJacobianInv(MeshElement* e, Vector3 const& local, Matrix3x3& jinv)
 {
-  Matrix3x3 j;
-  getJacobian(e, local, j);
-  jinv = getJacobianInverse(j, e->getDimension());
+  e->getJacobianInv(local, jinv);
 }
 
 double computeCosAngle(Mesh* m, MeshEntity* pe, MeshEntity* e1, MeshEntity* e2,
@@ -386,7 +440,13 @@ void getMatrixNodes(Element* e, NewArray<Matrix3x3>& values)
 void getShapeValues(Element* e, Vector3 const& local,
     NewArray<double>& values)
 {
-  e->getShape()->getValues(e->getMesh(), e->getEntity(), local,values);
+  double const* v = e->getShapeValues(local, values);
+  if (values.allocated() && v == &values[0])
+    return;
+  int n = e->getShape()->countNodes();
+  values.allocate(n);
+  for (int i = 0; i < n; ++i)
+    values[i] = v[i];
 }
 
 void getShapeGrads(Element* e, Vector3 const& local,
@@ -425,6 +485,21 @@ void synchronize(Field* f, Sharing* shr)
   synchronizeFieldData<double>(f->getData(), shr);
 }
 
+void startSynchronize(Field* f, Sharing* shr)
+{
+  startSynchronizeFieldData<double>(f->getData(), shr);
+}
+
+bool testSynchronize()
+{
+  return PCU_Comm_Test();
+}
+
+void finishSynchronize(Field* f)
+{
+  finishSynchronizeFieldData<double>(f->getData());
+}
+
 void accumulate(Field* f, Sharing* shr, bool delete_shr)
 {
   reduceFieldData(f->getData(), shr, delete_shr, ReductionSum<double>());
@@ -436,6 +511,33 @@ void sharedReduction(Field* f, Sharing* shr, bool delete_shr,
   reduceFieldData(f->getData(), shr, delete_shr, sum);
 }
 
+static std::vector<FieldDataOf<double>*> gatherData(
+    std::vector<Field*> const& fields)
+{
+  std::vector<FieldDataOf<double>*> data(fields.size());
+  for (size_t i = 0; i < fields.size(); ++i)
+    data[i] = fields[i]->getData();
+  return data;
+}
+
+void synchronize(std::vector<Field*> const& fields, Sharing* shr)
+{
+  synchronizeFieldData(gatherData(fields), shr);
+}
+
+void accumulate(std::vector<Field*> const& fields, Sharing* shr,
+    bool delete_shr)
+{
+  reduceFieldData(gatherData(fields), shr, delete_shr,
+      ReductionSum<double>());
+}
+
+void sharedReduction(std::vector<Field*> const& fields, Sharing* shr,
+    bool delete_shr, const ReductionOp<double>& sum)
+{
+  reduceFieldData(gatherData(fields), shr, delete_shr, sum);
+}
+
 
 
 void fail(const char* why)
@@ -39,6 +39,7 @@ class VectorElement;
 typedef VectorElement MeshElement;
 class FieldShape;
 struct Sharing;
+class CommPlan;
 template <class T> class ReductionOp;
 template <class T> class ReductionSum;
 
@@ -211,6 +212,15 @@ bool hasEntity(Field* f, MeshEntity* e);
   */
 const char* getName(Field* f);
 
+/** \brief Get the suffix naming the tag that holds a tag-backed
+  *        Field's nodes on one entity type
+  *
+  * \details A field named "u" keeps its vertex nodes in the tag
+  * "u_ver", its edge nodes in "u_edg", and so on. Numberings
+  * name their tags the same way.
+  */
+const char* getTagDataPostfix(int type);
+
 /** \brief Retrieve the type of value a field distributes
   */
 int getValueType(Field* f);
@@ -355,6 +365,42 @@ void getMatrix(Element* e, Vector3 const& param, Matrix3x3& value);
 /** \brief Evaluate a field into an array of component values. */
 void getComponents(Element* e, Vector3 const& param, double* components);
 
+/** \brief Evaluate a field at several points of one element.
+  *
+  * \details The shape functions are evaluated once per point and
+  * then every component is accumulated over all points in one
+  * contiguous loop per node, which compilers can vectorize.
+  * \param n the number of points
+  * \param params the local coordinates of the points
+  * \param components component c at point i is written to
+  *                   components[c * n + i]
+  */
+void getComponents(Element* e, int n, Vector3 const* params,
+    double* components);
+
+/** \brief Evaluate field gradients at several points of one element.
+  *
+  * \details Works for any number of components, so it batches both
+  * apf::getGrad and apf::getVectorGrad. The element must have been
+  * created from a MeshElement.
+  * \param grads the derivative along axis d of component c at point i
+  *              is written to grads[(c * 3 + d) * n + i]
+  */
+void getComponentGrads(Element* e, int n, Vector3 const* params,
+    double* grads);
+
+/** \brief Evaluate a field at one local point of several elements.
+  *
+  * \details The elements must all have the same type. Shape
+  * functions that do not depend on the entity are evaluated once
+  * for all of them.
+  * \param n the number of elements
+  * \param components component c in element i is written to
+  *                   components[c * n + i]
+  */
+void getComponents(Field* f, int n, MeshEntity* const* elements,
+    Vector3 const& param, double* components);
+
 /** \brief Get the number of integration points for an element.
   *
   * \param order the polynomial order of accuracy desired for the integration
@@ -393,6 +439,37 @@ void mapLocalToGlobal(MeshElement* e, Vector3 const& local, Vector3& global);
   */
 double getDV(MeshElement* e, Vector3 const& param);
 
+/** \brief Choose whether affine MeshElements cache their geometry.
+  *
+  * \details The Jacobian of a MeshElement with linear coordinates
+  * over an edge, triangle or tet is the same at every point.
+  * When this is on (the default), such a MeshElement computes its
+  * Jacobian, Jacobian inverse and differential volume once and
+  * returns them for every point after that. The cache lives as long
+  * as the MeshElement, so elements created after coordinates move
+  * see the new geometry.
+  */
+void setAffineCaching(bool on);
+
+/** \brief Get the value set by apf::setAffineCaching. */
+bool getAffineCaching();
+
+/** \brief Set the number of threads used by mesh loops.
+  *
+  * \details Integrator::process(Mesh*,int) and the loops over
+  * field nodes split their entities into this many contiguous
+  * ranges, one per thread, when the Integrator or operation can
+  * copy itself. The mesh is only read by the threads, and
+  * threads only overwrite field values that already exist:
+  * giving an entity a new value changes storage shared by
+  * all entities and must stay on one thread.
+  * The default is 1.
+  */
+void setLoopThreads(int n);
+
+/** \brief Get the number set by apf::setLoopThreads. */
+int getLoopThreads();
+
 /** \brief A virtual base for user-defined integrators.
   *
   * \details Users of APF can define an Integrator object to handle
@@ -452,6 +529,24 @@ class Integrator
       * if that is the user's goal.
       */
     virtual void parallelReduce();
+    /** \brief User callback: copy for a thread.
+      *
+      * \details When apf::setLoopThreads asks for more than one thread,
+      * Integrator::process(Mesh*,int) calls this for each extra thread
+      * and runs the copy over its own range of elements.
+      * Copies must accumulate separately from the original.
+      * The default returns NULL, which keeps the loop on one thread.
+      */
+    virtual Integrator* clone();
+    /** \brief User callback: combine the values of a copy.
+      *
+      * \details The original is called with each copy made by
+      * Integrator::clone in the order of their element ranges,
+      * after all ranges are done and before Integrator::parallelReduce,
+      * so the result does not depend on thread timing.
+      * The copy is deleted afterwards.
+      */
+    virtual void join(Integrator* copy);
   protected:
     int order;
     int ipnode;
@@ -667,6 +762,48 @@ int getDimension(MeshElement* me);
   */
 void synchronize(Field* f, Sharing* shr = 0);
 
+/** \brief Start synchronizing field values along partition boundary.
+  \details This sends the owned values like apf::synchronize
+  but returns before they arrive, so that local work which does
+  not need them can overlap the exchange. It starts a PCU phase,
+  so no other PCU communication may happen before
+  apf::finishSynchronize. */
+void startSynchronize(Field* f, Sharing* shr = 0);
+
+/** \brief Make progress on a started synchronization.
+  \details Never blocks. Call it now and then during the local work.
+  \returns true once all values sent to this part have arrived */
+bool testSynchronize();
+
+/** \brief Complete apf::startSynchronize.
+  \details Waits for the remaining values and assigns all
+  received values to the copies. */
+void finishSynchronize(Field* f);
+
+/** \brief Record the exchanges done by apf::synchronize.
+  \details The plan lists, for each peer, the entities with nodes
+  of shape \a s that are sent or received according to \a shr
+  (apf::getSharing by default), so that apf::synchronize(CommPlan*,Field*)
+  only copies values. It is rebuilt by its next use after
+  Mesh::partitionVersion changes, for example after migration.
+  Each rank decides to rebuild from its own copy of the version,
+  so it must have changed on all ranks, as it does when all of them
+  call Mesh2::acceptChanges.
+  This is a collective call, and plans can not be used
+  by the threads of PCU_Thrd_Run. */
+CommPlan* createCommPlan(Mesh* m, FieldShape* s, Sharing* shr = 0);
+
+/** \brief Destroy a plan made by apf::createCommPlan. */
+void destroyCommPlan(CommPlan* p);
+
+/** \brief Synchronize field values using a plan.
+  \details Same as apf::synchronize(Field*,Sharing*) for a field
+  of the plan's mesh and shape. Like it, entities whose owner has
+  no values for them are left alone. The buffers and MPI persistent requests
+  are kept in the plan while the number of components stays the same.
+  */
+void synchronize(CommPlan* p, Field* f);
+
 /** \brief Add field values along partition boundary.
   \details Using the copies described by
   an apf::Sharing object, add up the field values of
@@ -684,6 +821,25 @@ void accumulate(Field* f, Sharing* shr = 0, bool delete_shr = false);
 void sharedReduction(Field* f, Sharing* shr, bool delete_shr,
            const ReductionOp<double>& sum = ReductionSum<double>());
 
+/** \brief Synchronize several fields in one exchange.
+  \details Same as calling apf::synchronize on each field, but
+  the values of all fields on a shared entity travel together in
+  one message per neighbor and one communication phase.
+  The fields must be on the same mesh and may have different
+  shapes and numbers of components. An empty list does nothing. */
+void synchronize(std::vector<Field*> const& fields, Sharing* shr = 0);
+
+/** \brief Accumulate several fields in one exchange.
+  \details See apf::synchronize(std::vector<Field*> const&,Sharing*) */
+void accumulate(std::vector<Field*> const& fields, Sharing* shr = 0,
+    bool delete_shr = false);
+
+/** \brief Apply a reduction to several fields in one exchange.
+  \details See apf::synchronize(std::vector<Field*> const&,Sharing*) */
+void sharedReduction(std::vector<Field*> const& fields, Sharing* shr,
+    bool delete_shr,
+    const ReductionOp<double>& sum = ReductionSum<double>());
+
 
 /** \brief Declare failure of code inside APF.
   \details This function prints the string as an APF
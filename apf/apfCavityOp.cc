@@ -132,21 +132,12 @@ bool CavityOp::requestLocality(MeshEntity** entities, int count)
   return areLocal;
 }
 
-bool CavityOp::sendPullRequests(std::vector<PullRequest>& received)
+/* sends the requests for remote copies and leaves the
+   phase open, the local requests stay in this->requests */
+bool CavityOp::sendPullRequests()
 {
   int done = PCU_Min_Int(requests.empty());
   if (done) return false;
-  /* throw in the local pull requests */
-  int self = PCU_Comm_Self();
-  received.reserve(requests.size());
-  APF_ITERATE(Requests,requests,it)
-  {
-    PullRequest request;
-    request.to = self;
-    request.e = *it;
-    received.push_back(request);
-  }
-  /* now communicate the rest */
   PCU_Comm_Begin();
   APF_ITERATE(Requests,requests,it)
   {
@@ -159,18 +150,7 @@ bool CavityOp::sendPullRequests(std::vector<PullRequest>& received)
       PCU_COMM_PACK(remotePart,remoteEntity);
     }
   }
-  requests.clear();
   PCU_Comm_Send();
-  while (PCU_Comm_Listen())
-  {
-    PullRequest request;
-    request.to = PCU_Comm_Sender();
-    while ( ! PCU_Comm_Unpacked())
-    {
-      PCU_COMM_UNPACK(request.e);
-      received.push_back(request);
-    }
-  }
   return true;
 }
 
@@ -219,12 +199,31 @@ static void markElements(
 
 bool CavityOp::tryToPull()
 {
-  std::vector<PullRequest> pulls;
-  if ( ! sendPullRequests(pulls))
+  if ( ! sendPullRequests())
     return false;
   Migration* plan = new Migration(mesh);
-  for (std::size_t i=0; i < pulls.size(); ++i)
-    markElements(plan,pulls[i].e,pulls[i].to);
+  /* mark the local requests while the remote ones travel,
+     nudging them along every so often */
+  int const pollInterval = 64;
+  int self = PCU_Comm_Self();
+  int marked = 0;
+  APF_ITERATE(Requests,requests,it)
+  {
+    markElements(plan,*it,self);
+    if (++marked % pollInterval == 0)
+      PCU_Comm_Test();
+  }
+  requests.clear();
+  while (PCU_Comm_Listen())
+  {
+    int requester = PCU_Comm_Sender();
+    while ( ! PCU_Comm_Unpacked())
+    {
+      MeshEntity* e;
+      PCU_COMM_UNPACK(e);
+      markElements(plan,e,requester);
+    }
+  }
   mesh->migrate(plan); //plan deleted here
   return true;
 }
@@ -97,8 +97,7 @@ class CavityOp
     typedef std::vector<MeshEntity*> Requests;
     Requests requests;
     bool isRequesting;
-    struct PullRequest { MeshEntity* e; int to; };
-    bool sendPullRequests(std::vector<PullRequest>& received);
+    bool sendPullRequests();
     bool tryToPull();
     void applyLocallyWithModification(int d);
     void applyLocallyWithoutModification(int d);
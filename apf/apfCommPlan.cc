@@ -0,0 +1,252 @@
+/*
+ * Copyright 2011 Scientific Computation Research Center
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <PCU.h>
+#include "apf.h"
+#include "apfField.h"
+#include "apfFieldData.h"
+#include "apfShape.h"
+#include <pcu_util.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+namespace apf {
+
+/* the entities exchanged with one peer, in the order
+   their values are laid out in the buffer. The buffer starts
+   with one bit per entity telling whether the owner had values
+   for it, so that like apf::synchronize the entities without
+   data are skipped on both sides */
+struct CommPeer
+{
+  int peer;
+  std::vector<MeshEntity*> entities;
+  size_t nodes;
+  std::vector<double> values;
+};
+
+class CommPlan
+{
+  public:
+    Mesh* mesh;
+    FieldShape* shape;
+    Sharing* sharing;
+    bool ownsSharing;
+    unsigned version;
+    MPI_Comm comm;
+    std::vector<CommPeer> sends;
+    std::vector<CommPeer> receives;
+    /* requests are bound to buffers sized for this many components,
+       receives first, zero if there are none */
+    int components;
+    std::vector<MPI_Request> requests;
+};
+
+static CommPeer& getPeer(std::vector<CommPeer>& peers,
+    std::map<int,size_t>& index, int peer)
+{
+  std::map<int,size_t>::iterator it = index.find(peer);
+  if (it != index.end())
+    return peers[it->second];
+  index[peer] = peers.size();
+  peers.push_back(CommPeer());
+  peers.back().peer = peer;
+  peers.back().nodes = 0;
+  return peers.back();
+}
+
+static void addEntity(CommPlan* p, CommPeer& cp, MeshEntity* e)
+{
+  cp.entities.push_back(e);
+  cp.nodes += p->shape->countNodesOn(p->mesh->getType(e));
+}
+
+static size_t countFlagWords(CommPeer& cp)
+{
+  return (cp.entities.size() + 63) / 64;
+}
+
+/* the flags are 64-bit words carried in the double buffer,
+   MPI moves them between ranks of one machine type untouched */
+static void setFlag(double* words, size_t i)
+{
+  uint64_t w;
+  std::memcpy(&w, words + i / 64, sizeof(w));
+  w |= uint64_t(1) << (i % 64);
+  std::memcpy(words + i / 64, &w, sizeof(w));
+}
+
+static bool getFlag(double const* words, size_t i)
+{
+  uint64_t w;
+  std::memcpy(&w, words + i / 64, sizeof(w));
+  return (w >> (i % 64)) & 1;
+}
+
+static void freeRequests(CommPlan* p)
+{
+  for (size_t i = 0; i < p->requests.size(); ++i)
+    MPI_Request_free(&p->requests[i]);
+  p->requests.clear();
+  p->components = 0;
+}
+
+/* the same walk as synchronizeFieldData, owners tell
+   their copies and ghosts which entities to expect */
+static void build(CommPlan* p)
+{
+  Mesh* m = p->mesh;
+  if (p->ownsSharing) {
+    delete p->sharing;
+    p->sharing = getSharing(m);
+  }
+  freeRequests(p);
+  p->sends.clear();
+  p->receives.clear();
+  std::map<int,size_t> index;
+  PCU_Comm_Begin();
+  for (int d = 0; d < 4; ++d) {
+    if ( ! p->shape->hasNodesIn(d))
+      continue;
+    MeshEntity* e;
+    MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it))) {
+      if ( ! p->sharing->isOwned(e))
+        continue;
+      CopyArray copies;
+      p->sharing->getCopies(e, copies);
+      for (size_t i = 0; i < copies.getSize(); ++i) {
+        PCU_COMM_PACK(copies[i].peer, copies[i].entity);
+        addEntity(p, getPeer(p->sends, index, copies[i].peer), e);
+      }
+      Copies ghosts;
+      if (m->getGhosts(e, ghosts))
+        APF_ITERATE(Copies, ghosts, git) {
+          PCU_COMM_PACK(git->first, git->second);
+          addEntity(p, getPeer(p->sends, index, git->first), e);
+        }
+    }
+    m->end(it);
+  }
+  PCU_Comm_Send();
+  while (PCU_Comm_Listen()) {
+    p->receives.push_back(CommPeer());
+    CommPeer& cp = p->receives.back();
+    cp.peer = PCU_Comm_Sender();
+    cp.nodes = 0;
+    while ( ! PCU_Comm_Unpacked()) {
+      MeshEntity* e;
+      PCU_COMM_UNPACK(e);
+      addEntity(p, cp, e);
+    }
+  }
+  p->version = m->partitionVersion;
+}
+
+static void makeRequests(CommPlan* p, int components)
+{
+  freeRequests(p);
+  size_t nr = p->receives.size();
+  size_t ns = p->sends.size();
+  p->requests.resize(nr + ns);
+  for (size_t i = 0; i < nr; ++i) {
+    CommPeer& cp = p->receives[i];
+    cp.values.resize(countFlagWords(cp) + cp.nodes * components);
+    MPI_Recv_init(cp.values.empty() ? 0 : &cp.values[0],
+        int(cp.values.size()), MPI_DOUBLE, cp.peer, 0, p->comm,
+        &p->requests[i]);
+  }
+  for (size_t i = 0; i < ns; ++i) {
+    CommPeer& cp = p->sends[i];
+    cp.values.resize(countFlagWords(cp) + cp.nodes * components);
+    MPI_Send_init(cp.values.empty() ? 0 : &cp.values[0],
+        int(cp.values.size()), MPI_DOUBLE, cp.peer, 0, p->comm,
+        &p->requests[nr + i]);
+  }
+  p->components = components;
+}
+
+CommPlan* createCommPlan(Mesh* m, FieldShape* s, Sharing* shr)
+{
+  /* the plan talks to MPI directly, which only knows processes */
+  PCU_ALWAYS_ASSERT(PCU_Thrd_Peers() == 1);
+  CommPlan* p = new CommPlan();
+  p->mesh = m;
+  p->shape = s;
+  p->sharing = shr;
+  p->ownsSharing = !shr;
+  p->components = 0;
+  MPI_Comm_dup(PCU_Get_Comm(), &p->comm);
+  build(p);
+  return p;
+}
+
+void destroyCommPlan(CommPlan* p)
+{
+  freeRequests(p);
+  MPI_Comm_free(&p->comm);
+  if (p->ownsSharing)
+    delete p->sharing;
+  delete p;
+}
+
+void synchronize(CommPlan* p, Field* f)
+{
+  PCU_ALWAYS_ASSERT(f->getMesh() == p->mesh);
+  PCU_ALWAYS_ASSERT(f->getShape() == p->shape);
+  if (p->version != p->mesh->partitionVersion)
+    build(p);
+  int components = f->countComponents();
+  if (components != p->components)
+    makeRequests(p, components);
+  FieldDataOf<double>* data = f->getData();
+  size_t nr = p->receives.size();
+  size_t ns = p->sends.size();
+  if (nr)
+    MPI_Startall(int(nr), &p->requests[0]);
+  for (size_t i = 0; i < ns; ++i) {
+    CommPeer& cp = p->sends[i];
+    if (cp.values.empty())
+      continue;
+    double* flags = &cp.values[0];
+    size_t nf = countFlagWords(cp);
+    std::fill(flags, flags + nf, 0.0);
+    double* v = flags + nf;
+    for (size_t j = 0; j < cp.entities.size(); ++j) {
+      MeshEntity* e = cp.entities[j];
+      if (data->hasEntity(e)) {
+        setFlag(flags, j);
+        data->get(e, v);
+      }
+      v += f->countValuesOn(e);
+    }
+  }
+  if (ns)
+    MPI_Startall(int(ns), &p->requests[nr]);
+  for (size_t k = 0; k < nr; ++k) {
+    int i;
+    MPI_Waitany(int(nr), &p->requests[0], &i, MPI_STATUS_IGNORE);
+    CommPeer& cp = p->receives[i];
+    if (cp.values.empty())
+      continue;
+    double const* flags = &cp.values[0];
+    double* v = &cp.values[0] + countFlagWords(cp);
+    for (size_t j = 0; j < cp.entities.size(); ++j) {
+      MeshEntity* e = cp.entities[j];
+      if (getFlag(flags, j))
+        data->set(e, v);
+      v += f->countValuesOn(e);
+    }
+  }
+  if (ns)
+    MPI_Waitall(int(ns), &p->requests[nr], MPI_STATUSES_IGNORE);
+}
+
+}
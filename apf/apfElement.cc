@@ -9,6 +9,7 @@
 #include "apfShape.h"
 #include "apfMesh.h"
 #include "apfVectorElement.h"
+#include <pcu_util.h>
 
 namespace apf {
 
@@ -21,6 +22,10 @@ void Element::init(Field* f, MeshEntity* e, VectorElement* p)
   parent = p;
   nen = shape->countNodes();
   nc = f->countComponents();
+  intOrder = -1;
+  intPoint = -1;
+  table = 0;
+  tableOrder = -1;
   getNodeData();
 }
 
@@ -72,14 +77,87 @@ Matrix3x3 getJacobianInverse(Matrix3x3 J, int dim)
   }
 }
 
+void Element::setIntPoint(int order, int point)
+{
+  intOrder = order;
+  intPoint = point;
+}
+
+static bool samePoint(Vector3 const& a, Vector3 const& b)
+{
+  return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+Element* Element::getIntSource()
+{
+  return parent ? static_cast<Element*>(parent) : this;
+}
+
+ShapeTable const* Element::getTable()
+{
+  Element* source = getIntSource();
+  if (source->intPoint < 0)
+    return 0;
+  if (source->intOrder != tableOrder) {
+    table = getShapeTable(shape, getType(), source->intOrder);
+    tableOrder = source->intOrder;
+  }
+  return table;
+}
+
+ShapeTable const* Element::findTable(Vector3 const& xi, int& point)
+{
+  ShapeTable const* t = getTable();
+  if (!t)
+    return 0;
+  point = getIntSource()->intPoint;
+  if (!samePoint(t->getPoint(point), xi))
+    return 0;
+  return t;
+}
+
+/* batches of exactly the points of the last integration order
+   given to apf::getIntPoint read the whole table */
+ShapeTable const* Element::findTable(int n, Vector3 const* xi)
+{
+  ShapeTable const* t = getTable();
+  if (!t || t->countPoints() != n)
+    return 0;
+  for (int i = 0; i < n; ++i)
+    if (!samePoint(t->getPoint(i), xi[i]))
+      return 0;
+  return t;
+}
+
+double const* Element::getShapeValues(Vector3 const& xi,
+    NewArray<double>& values)
+{
+  int point;
+  ShapeTable const* t = findTable(xi, point);
+  if (t)
+    return t->getValues(point);
+  shape->getValues(mesh, entity, xi, values);
+  return &values[0];
+}
+
+Vector3 const* Element::getLocalGradients(Vector3 const& xi,
+    NewArray<Vector3>& grads)
+{
+  int point;
+  ShapeTable const* t = findTable(xi, point);
+  if (t)
+    return t->getLocalGradients(point);
+  shape->getLocalGradients(mesh, entity, xi, grads);
+  return &grads[0];
+}
+
 void Element::getGlobalGradients(Vector3 const& local,
                                  NewArray<Vector3>& globalGradients)
 {
-  Matrix3x3 J;
-  parent->getJacobian(local,J);
-  Matrix3x3 jinv = getJacobianInverse(J, getDimension());
-  NewArray<Vector3> localGradients;
-  shape->getLocalGradients(mesh, entity, local,localGradients);
+  Matrix3x3 jinv;
+  parent->getJacobianInv(local,jinv);
+  NewArray<Vector3> buffer;
+  Vector3 const* localGradients = getLocalGradients(local, buffer);
   globalGradients.allocate(nen);
   for (int i=0; i < nen; ++i)
     globalGradients[i] = jinv * localGradients[i];
@@ -87,8 +165,8 @@ void Element::getGlobalGradients(Vector3 const& local,
 
 void Element::getComponents(Vector3 const& xi, double* c)
 {
-  NewArray<double> shapeValues;
-  shape->getValues(mesh, entity, xi, shapeValues);
+  NewArray<double> buffer;
+  double const* shapeValues = getShapeValues(xi, buffer);
   for (int ci = 0; ci < nc; ++ci)
     c[ci] = 0;
   for (int ni = 0; ni < nen; ++ni)
@@ -96,6 +174,72 @@ void Element::getComponents(Vector3 const& xi, double* c)
       c[ci] += nodeData[ni * nc + ci] * shapeValues[ni];
 }
 
+/* the per-point work fills node-major tables so that the
+   accumulation below runs over contiguous points */
+void Element::getComponents(int n, Vector3 const* xi, double* c)
+{
+  ShapeTable const* t = findTable(n, xi);
+  NewArray<double> shapeValues(nen * n);
+  NewArray<double> buffer;
+  for (int i = 0; i < n; ++i) {
+    double const* v = t ? t->getValues(i) : getShapeValues(xi[i], buffer);
+    for (int ni = 0; ni < nen; ++ni)
+      shapeValues[ni * n + i] = v[ni];
+  }
+  for (int ci = 0; ci < nc; ++ci) {
+    double* out = c + ci * n;
+    for (int i = 0; i < n; ++i)
+      out[i] = 0;
+    for (int ni = 0; ni < nen; ++ni) {
+      double u = nodeData[ni * nc + ci];
+      double const* N = &shapeValues[ni * n];
+      for (int i = 0; i < n; ++i)
+        out[i] += u * N[i];
+    }
+  }
+}
+
+/* sums the local gradients first, since the inverse Jacobian
+   is applied the same way to every node */
+void Element::getComponentGrads(int n, Vector3 const* xi, double* g)
+{
+  /* global gradients need the Jacobian of a MeshElement */
+  PCU_ALWAYS_ASSERT(parent);
+  ShapeTable const* t = findTable(n, xi);
+  NewArray<double> localGradients(nen * 3 * n);
+  NewArray<Vector3> buffer;
+  for (int i = 0; i < n; ++i) {
+    Vector3 const* lg = t ? t->getLocalGradients(i) :
+      getLocalGradients(xi[i], buffer);
+    for (int ni = 0; ni < nen; ++ni)
+      for (int d = 0; d < 3; ++d)
+        localGradients[(ni * 3 + d) * n + i] = lg[ni][d];
+  }
+  for (int ci = 0; ci < nc; ++ci)
+    for (int d = 0; d < 3; ++d) {
+      double* out = g + (ci * 3 + d) * n;
+      for (int i = 0; i < n; ++i)
+        out[i] = 0;
+      for (int ni = 0; ni < nen; ++ni) {
+        double u = nodeData[ni * nc + ci];
+        double const* G = &localGradients[(ni * 3 + d) * n];
+        for (int i = 0; i < n; ++i)
+          out[i] += u * G[i];
+      }
+    }
+  for (int i = 0; i < n; ++i) {
+    Matrix3x3 jinv;
+    parent->getJacobianInv(xi[i], jinv);
+    for (int ci = 0; ci < nc; ++ci) {
+      double* c = g + ci * 3 * n + i;
+      Vector3 local(c[0], c[n], c[2 * n]);
+      Vector3 global = jinv * local;
+      for (int d = 0; d < 3; ++d)
+        c[d * n] = global[d];
+    }
+  }
+}
+
 void Element::getNodeData()
 {
   field->getData()->getElementData(entity,nodeData);
@@ -33,9 +33,25 @@ class Element
     Mesh* getMesh() {return mesh;}
     EntityShape* getShape() {return shape;}
     void getComponents(Vector3 const& xi, double* c);
+    void getComponents(int n, Vector3 const* xi, double* c);
+    void getComponentGrads(int n, Vector3 const* xi, double* g);
+    /* apf::getIntPoint records the point it returned on a
+       MeshElement, so that elements built on it can read
+       shape functions there from a ShapeTable */
+    void setIntPoint(int order, int point);
+    /* these return the tabulated values when xi is that point,
+       otherwise they evaluate into the given array */
+    double const* getShapeValues(Vector3 const& xi,
+        NewArray<double>& values);
+    Vector3 const* getLocalGradients(Vector3 const& xi,
+        NewArray<Vector3>& grads);
   protected:
     void init(Field* f, MeshEntity* e, VectorElement* p);
     void getNodeData();
+    Element* getIntSource();
+    ShapeTable const* getTable();
+    ShapeTable const* findTable(Vector3 const& xi, int& point);
+    ShapeTable const* findTable(int n, Vector3 const* xi);
     Field* field;
     Mesh* mesh;
     MeshEntity* entity;
@@ -44,6 +60,10 @@ class Element
     int nen;
     int nc;
     NewArray<double> nodeData;
+    int intOrder;
+    int intPoint;
+    ShapeTable const* table;
+    int tableOrder;
 };
 
 Matrix3x3 getJacobianInverse(Matrix3x3 J, int dim);
@@ -8,6 +8,9 @@
 #include "apfField.h"
 #include "apfShape.h"
 #include "apfTagData.h"
+#include "apfThreads.h"
+#include "apf.h"
+#include <vector>
 
 namespace apf {
 
@@ -69,8 +72,89 @@ void FieldOp::atNode(int)
 {
 }
 
+FieldOp* FieldOp::clone()
+{
+  return 0;
+}
+
+void FieldOp::join(FieldOp*)
+{
+}
+
+class FieldOpTask : public ThreadTask
+{
+  public:
+    FieldOpTask(FieldBase* f, FieldOp* o):
+      field(f),
+      op(o)
+    {
+    }
+    void run(MeshEntity** begin, MeshEntity** end)
+    {
+      for (MeshEntity** it = begin; it != end; ++it) {
+        if ( ! op->inEntity(*it))
+          continue;
+        int n = field->countNodesOn(*it);
+        for (int i=0; i < n; ++i)
+          op->atNode(i);
+        op->outEntity();
+      }
+    }
+    FieldBase* field;
+    FieldOp* op;
+};
+
+static bool applyThreaded(FieldOp* op, FieldBase* f)
+{
+  int threads = getLoopThreads();
+  if (threads == 1)
+    return false;
+  std::vector<FieldOp*> copies;
+  for (int i = 1; i < threads; ++i) {
+    FieldOp* copy = op->clone();
+    if (!copy)
+      break;
+    copies.push_back(copy);
+  }
+  if (copies.size() + 1 < size_t(threads)) {
+    for (size_t i = 0; i < copies.size(); ++i)
+      delete copies[i];
+    return false;
+  }
+  std::vector<FieldOpTask> tasks(threads, FieldOpTask(f, op));
+  std::vector<ThreadTask*> run(threads);
+  for (int i = 0; i < threads; ++i) {
+    if (i)
+      tasks[i].op = copies[i - 1];
+    run[i] = &tasks[i];
+  }
+  Mesh* m = f->getMesh();
+  FieldShape* s = f->getShape();
+  std::vector<MeshEntity*> entities;
+  for (int d=0; d < 4; ++d)
+  {
+    if ( ! s->hasNodesIn(d))
+      continue;
+    entities.clear();
+    MeshIterator* it = m->begin(d);
+    MeshEntity* e;
+    while ((e = m->iterate(it)))
+      if (s->countNodesOn(m->getType(e)))
+        entities.push_back(e);
+    m->end(it);
+    runThreads(run, entities);
+  }
+  for (size_t i = 0; i < copies.size(); ++i) {
+    op->join(copies[i]);
+    delete copies[i];
+  }
+  return true;
+}
+
 void FieldOp::apply(FieldBase* f)
 {
+  if (applyThreaded(this, f))
+    return;
   Mesh* m = f->getMesh();
   FieldShape* s = f->getShape();
   for (int d=0; d < 4; ++d)
@@ -115,6 +199,12 @@ struct ZeroOp : public FieldOp
   {
     setComponents(field, ent, n, &data[0]);
   }
+  FieldOp* clone()
+  {
+    if ( ! field->getData()->isFrozen())
+      return 0;
+    return new ZeroOp(field);
+  }
   Field* field;
   MeshEntity* ent;
   apf::NewArray<double> data;
@@ -64,9 +64,17 @@ class Field : public FieldBase
 class FieldOp
 {
   public:
+    virtual ~FieldOp() {}
     virtual bool inEntity(MeshEntity* e);
     virtual void outEntity();
     virtual void atNode(int node);
+    /* a copy that apply runs on another thread when
+       apf::setLoopThreads asks for more than one, or NULL (the default)
+       to stay on one thread. copies may only overwrite values the
+       fields already have, since storing new values is not thread safe */
+    virtual FieldOp* clone();
+    /* called on the original with each copy, in range order */
+    virtual void join(FieldOp* copy);
     void apply(FieldBase* f);
 };
 
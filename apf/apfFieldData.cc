@@ -2,7 +2,9 @@
 #include "apfFieldData.h"
 #include "apfShape.h"
 #include <pcu_util.h>
+#include <algorithm>
 #include <cstdlib>
+#include <vector>
 
 namespace apf {
 
@@ -15,12 +17,79 @@ void FieldData::rename(const char*)
   abort();
 }
 
+/* with the default sharing, messages only go to mesh neighbors,
+   which lets a mesh that knows them skip the phase barriers */
+static bool getNeighbors(Mesh* m, bool defaultSharing,
+    std::vector<int>& neighbors)
+{
+  Parts parts;
+  if (!defaultSharing || !m->getNeighbors(parts))
+    return false;
+  neighbors.assign(parts.begin(), parts.end());
+  return true;
+}
+
+static void beginPhase(bool known, std::vector<int> const& neighbors)
+{
+  if (!known)
+    return PCU_Comm_Begin();
+  PCU_Comm_Begin_Neighbors(neighbors.empty() ? 0 : &neighbors[0],
+      neighbors.size());
+}
+
+/* owners send their values to their copies and ghosts */
+template <class T>
+static void packValues(FieldDataOf<T>* data, Sharing* shr, int d)
+{
+  FieldBase* f = data->getField();
+  Mesh* m = f->getMesh();
+  MeshEntity* e;
+  MeshIterator* it = m->begin(d);
+  while ((e = m->iterate(it)))
+  {
+    if (( ! data->hasEntity(e))||
+        ( ! shr->isOwned(e)))
+      continue;
+    int n = f->countValuesOn(e);
+    CopyArray copies;
+    shr->getCopies(e, copies);
+    for (size_t i = 0; i < copies.getSize(); ++i)
+    {
+      PCU_COMM_PACK(copies[i].peer, copies[i].entity);
+      data->get(e, PCU_COMM_RESERVE(copies[i].peer, T, n));
+    }
+    apf::Copies ghosts;  
+    if (m->getGhosts(e, ghosts))
+    APF_ITERATE(Copies, ghosts, it)
+    {
+      PCU_COMM_PACK(it->first, it->second);
+      data->get(e, PCU_COMM_RESERVE(it->first, T, n));
+    }
+  }
+  m->end(it);
+}
+
+template <class T>
+static void unpackValues(FieldDataOf<T>* data)
+{
+  FieldBase* f = data->getField();
+  while (PCU_Comm_Receive())
+  {
+    MeshEntity* e;
+    PCU_COMM_UNPACK(e);
+    int n = f->countValuesOn(e);
+    data->set(e, PCU_COMM_EXTRACT(T, n));
+  }
+}
+
 template <class T>
 void synchronizeFieldData(FieldDataOf<T>* data, Sharing* shr, bool delete_shr)
 {
   FieldBase* f = data->getField();
   Mesh* m = f->getMesh();
   FieldShape* s = f->getShape();
+  std::vector<int> neighbors;
+  bool known = getNeighbors(m, !shr, neighbors);
   if (!shr)
   {
     shr = getSharing(m);
@@ -30,57 +99,55 @@ void synchronizeFieldData(FieldDataOf<T>* data, Sharing* shr, bool delete_shr)
   {
     if ( ! s->hasNodesIn(d))
       continue;
-    MeshEntity* e;
-    MeshIterator* it = m->begin(d);
-    PCU_Comm_Begin();
-    while ((e = m->iterate(it)))
-    {
-      if (( ! data->hasEntity(e))||
-          ( ! shr->isOwned(e)))
-        continue;
-      int n = f->countValuesOn(e);
-      NewArray<T> values(n);
-      data->get(e,&(values[0]));
-      CopyArray copies;
-      shr->getCopies(e, copies);
-      for (size_t i = 0; i < copies.getSize(); ++i)
-      {
-        PCU_COMM_PACK(copies[i].peer, copies[i].entity);
-        PCU_Comm_Pack(copies[i].peer, &(values[0]), n*sizeof(T));
-      }
-      apf::Copies ghosts;  
-      if (m->getGhosts(e, ghosts))
-      APF_ITERATE(Copies, ghosts, it)
-      {
-        PCU_COMM_PACK(it->first, it->second);
-        PCU_Comm_Pack(it->first, &(values[0]), n*sizeof(T));
-      }
-    }
-    m->end(it);
+    beginPhase(known, neighbors);
+    packValues(data, shr, d);
     PCU_Comm_Send();
-    while (PCU_Comm_Receive())
-    {
-      MeshEntity* e;
-      PCU_COMM_UNPACK(e);
-      int n = f->countValuesOn(e);
-      NewArray<T> values(n);
-      PCU_Comm_Unpack(&(values[0]),n*sizeof(T));
-      data->set(e,&(values[0]));
-    }
+    unpackValues(data);
   }
   if (delete_shr) delete shr;
 }
 
+/* all dimensions go in one phase, the received entities
+   tell which values they carry */
+template <class T>
+void startSynchronizeFieldData(FieldDataOf<T>* data, Sharing* shr)
+{
+  FieldBase* f = data->getField();
+  Mesh* m = f->getMesh();
+  FieldShape* s = f->getShape();
+  std::vector<int> neighbors;
+  bool known = getNeighbors(m, !shr, neighbors);
+  bool delete_shr = !shr;
+  if (!shr)
+    shr = getSharing(m);
+  beginPhase(known, neighbors);
+  for (int d=0; d < 4; ++d)
+    if (s->hasNodesIn(d))
+      packValues(data, shr, d);
+  PCU_Comm_Send();
+  if (delete_shr) delete shr;
+}
+
+template <class T>
+void finishSynchronizeFieldData(FieldDataOf<T>* data)
+{
+  unpackValues(data);
+}
+
 /* instantiate here */
 template void synchronizeFieldData<int>(FieldDataOf<int>*, Sharing*, bool);
 template void synchronizeFieldData<double>(FieldDataOf<double>*, Sharing*, bool);
 template void synchronizeFieldData<long>(FieldDataOf<long>*, Sharing*, bool);
+template void startSynchronizeFieldData<double>(FieldDataOf<double>*, Sharing*);
+template void finishSynchronizeFieldData<double>(FieldDataOf<double>*);
 
 void reduceFieldData(FieldDataOf<double>* data, Sharing* shr, bool delete_shr, const ReductionOp<double>& reduce_op /* =ReductionSum<double>() */)
 {
   FieldBase* f = data->getField();
   Mesh* m = f->getMesh();
   FieldShape* s = f->getShape();
+  std::vector<int> neighbors;
+  bool known = getNeighbors(m, !shr, neighbors);
   if (!shr)
   {
     shr = getSharing(m);
@@ -93,7 +160,7 @@ void reduceFieldData(FieldDataOf<double>* data, Sharing* shr, bool delete_shr, c
 
     MeshEntity* e;
     MeshIterator* it = m->begin(d);
-    PCU_Comm_Begin();
+    beginPhase(known, neighbors);
     while ((e = m->iterate(it)))
     {
       /* send to all parts that can see this entity */
@@ -116,13 +183,11 @@ void reduceFieldData(FieldDataOf<double>* data, Sharing* shr, bool delete_shr, c
       CopyArray copies;
       shr->getCopies(e, copies);
       int n = f->countValuesOn(e);
-      NewArray<double> values(n);
-      data->get(e,&(values[0]));
 
       for (size_t i = 0; i < copies.getSize(); ++i)
       {
         PCU_COMM_PACK(copies[i].peer, copies[i].entity);
-        PCU_Comm_Pack(copies[i].peer, &(values[0]), n*sizeof(double));
+        data->get(e, PCU_COMM_RESERVE(copies[i].peer, double, n));
       }
 
       // ghosts - only do them if this entity is on a partition boundary
@@ -133,7 +198,7 @@ void reduceFieldData(FieldDataOf<double>* data, Sharing* shr, bool delete_shr, c
         APF_ITERATE(Copies, ghosts, it2)
         {
           PCU_COMM_PACK(it2->first, it2->second);
-          PCU_Comm_Pack(it2->first, &(values[0]), n*sizeof(double));
+          data->get(e, PCU_COMM_RESERVE(it2->first, double, n));
         }
       }
     }
@@ -148,8 +213,7 @@ void reduceFieldData(FieldDataOf<double>* data, Sharing* shr, bool delete_shr, c
         PCU_COMM_UNPACK(e);
         int n = f->countValuesOn(e);
         NewArray<double> values(n);
-        NewArray<double> inValues(n);
-        PCU_Comm_Unpack(&(inValues[0]),n*sizeof(double));
+        double const* inValues = PCU_COMM_EXTRACT(double, n);
         data->get(e,&(values[0]));
         for (int i = 0; i < n; ++i)
           values[i] = reduce_op.apply(values[i], inValues[i]);
@@ -161,6 +225,203 @@ void reduceFieldData(FieldDataOf<double>* data, Sharing* shr, bool delete_shr, c
   if (delete_shr) delete shr;
 }
 
+/* Several fields travel in one phase. For each entity, the message
+   holds the entity on the receiver, a mask of the fields sent,
+   and the values of those fields in order. Each field contributes
+   the dimensions its own shape has nodes in. */
+
+static Mesh* getGroupMesh(std::vector<FieldDataOf<double>*> const& data)
+{
+  PCU_ALWAYS_ASSERT( ! data.empty());
+  Mesh* m = data[0]->getField()->getMesh();
+  for (size_t k = 1; k < data.size(); ++k)
+    PCU_ALWAYS_ASSERT(data[k]->getField()->getMesh() == m);
+  return m;
+}
+
+static bool groupHasNodesIn(std::vector<FieldDataOf<double>*> const& data,
+    int d)
+{
+  for (size_t k = 0; k < data.size(); ++k)
+    if (data[k]->getField()->getShape()->hasNodesIn(d))
+      return true;
+  return false;
+}
+
+static bool inMask(std::vector<unsigned> const& mask, size_t k)
+{
+  return mask[k / 32] & (1u << (k % 32));
+}
+
+/* marks the fields with nodes in dimension d that have values on e */
+static bool getGroupMask(std::vector<FieldDataOf<double>*> const& data,
+    int d, MeshEntity* e, std::vector<unsigned>& mask)
+{
+  std::fill(mask.begin(), mask.end(), 0);
+  bool any = false;
+  for (size_t k = 0; k < data.size(); ++k)
+    if (data[k]->getField()->getShape()->hasNodesIn(d) &&
+        data[k]->hasEntity(e)) {
+      mask[k / 32] |= 1u << (k % 32);
+      any = true;
+    }
+  return any;
+}
+
+static void packGroup(std::vector<FieldDataOf<double>*> const& data,
+    std::vector<unsigned> const& mask, MeshEntity* e,
+    int to, MeshEntity* remote)
+{
+  PCU_COMM_PACK(to, remote);
+  unsigned* m = PCU_COMM_RESERVE(to, unsigned, mask.size());
+  std::copy(mask.begin(), mask.end(), m);
+  for (size_t k = 0; k < data.size(); ++k)
+    if (inMask(mask, k)) {
+      int n = data[k]->getField()->countValuesOn(e);
+      data[k]->get(e, PCU_COMM_RESERVE(to, double, n));
+    }
+}
+
+static void packGroupCopies(std::vector<FieldDataOf<double>*> const& data,
+    std::vector<unsigned> const& mask, Mesh* m, MeshEntity* e,
+    CopyArray& copies)
+{
+  for (size_t i = 0; i < copies.getSize(); ++i)
+    packGroup(data, mask, e, copies[i].peer, copies[i].entity);
+  Copies ghosts;
+  if (m->getGhosts(e, ghosts))
+    APF_ITERATE(Copies, ghosts, it)
+      packGroup(data, mask, e, it->first, it->second);
+}
+
+/* receives the values of each field, then assigns them
+   or combines them with the local values */
+static void unpackGroups(std::vector<FieldDataOf<double>*> const& data,
+    const ReductionOp<double>* reduce_op)
+{
+  std::vector<unsigned> mask((data.size() + 31) / 32);
+  NewArray<double> values;
+  while (PCU_Comm_Receive())
+  {
+    MeshEntity* e;
+    PCU_COMM_UNPACK(e);
+    unsigned const* m = PCU_COMM_EXTRACT(unsigned, mask.size());
+    std::copy(m, m + mask.size(), mask.begin());
+    for (size_t k = 0; k < data.size(); ++k)
+    {
+      if ( ! inMask(mask, k))
+        continue;
+      int n = data[k]->getField()->countValuesOn(e);
+      double const* inValues = PCU_COMM_EXTRACT(double, n);
+      if ( ! reduce_op)
+      {
+        data[k]->set(e, inValues);
+        continue;
+      }
+      values.allocate(n);
+      data[k]->get(e, &(values[0]));
+      for (int i = 0; i < n; ++i)
+        values[i] = reduce_op->apply(values[i], inValues[i]);
+      data[k]->set(e, &(values[0]));
+    }
+  }
+}
+
+void synchronizeFieldData(std::vector<FieldDataOf<double>*> const& data,
+    Sharing* shr, bool delete_shr)
+{
+  if (data.empty())
+  {
+    if (delete_shr) delete shr;
+    return;
+  }
+  Mesh* m = getGroupMesh(data);
+  std::vector<int> neighbors;
+  bool known = getNeighbors(m, !shr, neighbors);
+  if (!shr)
+  {
+    shr = getSharing(m);
+    delete_shr = true;
+  }
+  std::vector<unsigned> mask((data.size() + 31) / 32);
+  beginPhase(known, neighbors);
+  for (int d = 0; d < 4; ++d)
+  {
+    if ( ! groupHasNodesIn(data, d))
+      continue;
+    MeshEntity* e;
+    MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it)))
+    {
+      if (( ! shr->isOwned(e)) ||
+          ( ! getGroupMask(data, d, e, mask)))
+        continue;
+      CopyArray copies;
+      shr->getCopies(e, copies);
+      packGroupCopies(data, mask, m, e, copies);
+    }
+    m->end(it);
+  }
+  PCU_Comm_Send();
+  unpackGroups(data, 0);
+  if (delete_shr) delete shr;
+}
+
+void reduceFieldData(std::vector<FieldDataOf<double>*> const& data,
+    Sharing* shr, bool delete_shr, const ReductionOp<double>& reduce_op)
+{
+  if (data.empty())
+  {
+    if (delete_shr) delete shr;
+    return;
+  }
+  Mesh* m = getGroupMesh(data);
+  std::vector<int> neighbors;
+  bool known = getNeighbors(m, !shr, neighbors);
+  if (!shr)
+  {
+    shr = getSharing(m);
+    delete_shr = true;
+  }
+  std::vector<unsigned> mask((data.size() + 31) / 32);
+  NewArray<double> values;
+  beginPhase(known, neighbors);
+  for (int d = 0; d < 4; ++d)
+  {
+    if ( ! groupHasNodesIn(data, d))
+      continue;
+    MeshEntity* e;
+    MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it)))
+    {
+      if ( ! getGroupMask(data, d, e, mask))
+        continue;
+      if (m->isGhost(e) && shr->isShared(e))
+      {
+        /* as in the single field case, ghosts do not contribute */
+        for (size_t k = 0; k < data.size(); ++k)
+          if (inMask(mask, k))
+          {
+            int n = data[k]->getField()->countValuesOn(e);
+            values.allocate(n);
+            for (int i = 0; i < n; ++i)
+              values[i] = reduce_op.getNeutralElement();
+            data[k]->set(e, &(values[0]));
+          }
+        continue;
+      }
+      CopyArray copies;
+      shr->getCopies(e, copies);
+      if (copies.getSize() > 0)
+        packGroupCopies(data, mask, m, e, copies);
+    }
+    m->end(it);
+  }
+  PCU_Comm_Send();
+  unpackGroups(data, &reduce_op);
+  if (delete_shr) delete shr;
+}
+
 template <class T>
 void FieldDataOf<T>::setNodeComponents(MeshEntity* e, int node,
     T const* components)
@@ -254,6 +515,16 @@ template class FieldDataOf<double>;
 template class FieldDataOf<int>;
 template class FieldDataOf<long>;
 
+/* threads may write (to) at once if it is frozen into an array,
+   or if it is one of the fields being read, which has values
+   on every entity written */
+template <class T>
+static bool canShare(FieldDataOf<T>* to, FieldDataOf<T>* a,
+    FieldDataOf<T>* b)
+{
+  return to->isFrozen() || to == a || to == b;
+}
+
 template <class T>
 class CopyOp : public FieldOp
 {
@@ -275,6 +546,12 @@ class CopyOp : public FieldOp
       }
       return false;
     }
+    FieldOp* clone()
+    {
+      if ( ! canShare(to, from, from))
+        return 0;
+      return new CopyOp<T>(from, to);
+    }
     void run() {apply(to->getField());}
     FieldDataOf<T>* from;
     FieldDataOf<T>* to;
@@ -319,6 +596,12 @@ class MultiplyOp : public FieldOp
       }
       return false;
     }
+    FieldOp* clone()
+    {
+      if ( ! canShare(to, from, from))
+        return 0;
+      return new MultiplyOp<T>(from, mult, to);
+    }
     void run() {apply(to->getField());}
     FieldDataOf<T>* from;
     T mult;
@@ -367,6 +650,12 @@ class AddOp : public FieldOp
       }
       return false;
     }
+    FieldOp* clone()
+    {
+      if ( ! canShare(to, from1, from2))
+        return 0;
+      return new AddOp<T>(from1, from2, to);
+    }
     void run() {apply(to->getField());}
     FieldDataOf<T>* from1;
     FieldDataOf<T>* from2;
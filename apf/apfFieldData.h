@@ -9,6 +9,7 @@
 #define APFFIELDDATA_H
 
 #include <string>
+#include <vector>
 #include "apfField.h"
 #include "apfShape.h"
 
@@ -35,8 +36,21 @@ class FieldDataOf;
 template <class T>
 void synchronizeFieldData(FieldDataOf<T>* data, Sharing* shr, bool delete_shr=false);
 
+template <class T>
+void startSynchronizeFieldData(FieldDataOf<T>* data, Sharing* shr);
+
+template <class T>
+void finishSynchronizeFieldData(FieldDataOf<T>* data);
+
 void reduceFieldData(FieldDataOf<double>* data, Sharing* shr, bool delete_shr=false, const ReductionOp<double>& reduce_op=ReductionSum<double>() );
 
+/* the same for several fields of one mesh in a single phase */
+void synchronizeFieldData(std::vector<FieldDataOf<double>*> const& data,
+    Sharing* shr, bool delete_shr=false);
+void reduceFieldData(std::vector<FieldDataOf<double>*> const& data,
+    Sharing* shr, bool delete_shr=false,
+    const ReductionOp<double>& reduce_op=ReductionSum<double>());
+
 template <class T>
 void copyFieldData(FieldDataOf<T>* from, FieldDataOf<T>* to);
 
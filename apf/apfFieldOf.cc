@@ -34,6 +34,12 @@ class Project : public FieldOp
       destroyMeshElement(meshElement);
       destroyElement(fromElement);
     }
+    FieldOp* clone()
+    {
+      if ( ! to->getData()->isFrozen())
+        return 0;
+      return new Project<T>(to, from);
+    }
     void run()
     {
       apply(to);
@@ -83,6 +89,16 @@ class Axpy : public FieldOp
       axpyv[0] = (xv[0] * a) + yv[0];
       y->setNodeValue(entity, n, axpyv);
     }
+    /* y already has every value it writes, so threads never
+       change its tag storage, only the values in it */
+    FieldOp* clone()
+    {
+      Axpy<T>* copy = new Axpy<T>();
+      copy->a = a;
+      copy->x = x;
+      copy->y = y;
+      return copy;
+    }
     double a;
     FieldOf<T>* x;
     FieldOf<T>* y;
@@ -33,6 +33,7 @@ class HVertex : public EntityShape {
     void getLocalGradients(
         Mesh*, MeshEntity*, Vector3 const&, NewArray<Vector3>&) const {}
     int countNodes() const { return 1; }
+    bool dependsOnEntity() const { return false; }
 };
 
 class HEdge2 : public EntityShape {
@@ -52,6 +53,7 @@ class HEdge2 : public EntityShape {
       dN[2] = Vector3(-0.5 * c0 * xi[0], 0.0, 0.0);
     }
     int countNodes() const { return 3; }
+    bool dependsOnEntity() const { return false; }
 };
 
 class HEdge3 : public EntityShape {
@@ -73,6 +75,7 @@ class HEdge3 : public EntityShape {
       dN[3] = Vector3(0.25 * c0 * (1.0 - 3.0*xi[0]*xi[0]), 0.0, 0.0);
     }
     int countNodes() const { return 4; }
+    bool dependsOnEntity() const { return false; }
 };
 
 class HTriangle2 : public EntityShape {
@@ -106,6 +109,7 @@ class HTriangle2 : public EntityShape {
       dN[5] = Vector3(-c0 * xi[1], c0 * (1.0 - xi[0] - 2.0*xi[1]), 0.0);
     }
     int countNodes() const { return 6; }
+    bool dependsOnEntity() const { return false; }
 };
 
 class HTriangle3 : public EntityShape {
@@ -248,6 +252,7 @@ class HTetrahedron2 : public EntityShape {
       dN[9] = Vector3( 0.0, xi[2], xi[1] ) * c0;
     }
     int countNodes() const {return 10;}
+    bool dependsOnEntity() const {return false;}
 };
 
 class Hierarchic2 : public FieldShape {
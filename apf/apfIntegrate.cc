@@ -8,7 +8,9 @@
 #include "apfIntegrate.h"
 #include "apfMesh.h"
 #include "apf.h"
+#include "apfThreads.h"
 #include "pcu_util.h"
+#include <vector>
 
 namespace apf {
 
@@ -641,11 +643,86 @@ void Integrator::parallelReduce()
 {
 }
 
+Integrator* Integrator::clone()
+{
+  return 0;
+}
+
+void Integrator::join(Integrator*)
+{
+}
+
+class IntegrateTask : public ThreadTask
+{
+  public:
+    IntegrateTask(Mesh* m, Integrator* i):
+      mesh(m),
+      integrator(i)
+    {
+    }
+    void run(MeshEntity** begin, MeshEntity** end)
+    {
+      for (MeshEntity** it = begin; it != end; ++it) {
+        MeshElement* e = createMeshElement(mesh, *it);
+        integrator->process(e);
+        destroyMeshElement(e);
+      }
+    }
+    Mesh* mesh;
+    Integrator* integrator;
+};
+
+/* the original takes the first range and joins the
+   copies in range order */
+static bool processThreaded(Integrator* in, Mesh* m, int d)
+{
+  int threads = getLoopThreads();
+  if (threads == 1)
+    return false;
+  std::vector<Integrator*> copies;
+  for (int i = 1; i < threads; ++i) {
+    Integrator* copy = in->clone();
+    if (!copy)
+      break;
+    copies.push_back(copy);
+  }
+  if (copies.size() + 1 < size_t(threads)) {
+    for (size_t i = 0; i < copies.size(); ++i)
+      delete copies[i];
+    return false;
+  }
+  std::vector<MeshEntity*> elements;
+  elements.reserve(m->count(d));
+  MeshEntity* entity;
+  MeshIterator* it = m->begin(d);
+  while ((entity = m->iterate(it)))
+    if (m->isOwned(entity))
+      elements.push_back(entity);
+  m->end(it);
+  std::vector<IntegrateTask> tasks(threads, IntegrateTask(m, in));
+  std::vector<ThreadTask*> run(threads);
+  for (int i = 0; i < threads; ++i) {
+    if (i)
+      tasks[i].integrator = copies[i - 1];
+    run[i] = &tasks[i];
+  }
+  runThreads(run, elements);
+  for (size_t i = 0; i < copies.size(); ++i) {
+    in->join(copies[i]);
+    delete copies[i];
+  }
+  return true;
+}
+
 void Integrator::process(Mesh* m, int d)
 {
   if(d<0)
     d = m->getDimension();
   PCU_DEBUG_ASSERT(d<=m->getDimension());
+  if (processThreaded(this, m, d)) {
+    this->parallelReduce();
+    return;
+  }
   MeshEntity* entity;
   MeshIterator* elements = m->begin(d);
   while ((entity = m->iterate(elements)))
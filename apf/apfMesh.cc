@@ -149,6 +149,7 @@ void Mesh::init(FieldShape* s)
   baseP->init("coordinates",this,s,data);
   data->init(baseP);
   hasFrozenFields = false;
+  partitionVersion = 0;
 }
 
 Mesh::~Mesh()
@@ -826,7 +827,7 @@ void printTypes(Mesh* m)
   }
 }
 
-void printStats(Mesh* m)
+void printStats(Mesh* m, bool printMemory)
 {
   long n[4];
   for (int i = 0; i < 4; ++i)
@@ -836,6 +837,87 @@ void printStats(Mesh* m)
   if (!PCU_Comm_Self())
     lion_oprint(1,"mesh entity counts: v %ld e %ld f %ld r %ld\n",
         n[0], n[1], n[2], n[3]);
+  if (printMemory)
+    printMemoryStats(m);
+}
+
+MemoryUsage::MemoryUsage()
+{
+  for (int i = 0; i < KINDS; ++i)
+  for (int j = 0; j < Mesh::TYPES; ++j) {
+    allocated[i][j] = 0;
+    live[i][j] = 0;
+  }
+}
+
+std::size_t MemoryUsage::getAllocated(int kind) const
+{
+  std::size_t sum = 0;
+  for (int j = 0; j < Mesh::TYPES; ++j)
+    sum += allocated[kind][j];
+  return sum;
+}
+
+std::size_t MemoryUsage::getLive(int kind) const
+{
+  std::size_t sum = 0;
+  for (int j = 0; j < Mesh::TYPES; ++j)
+    sum += live[kind][j];
+  return sum;
+}
+
+char const* const MemoryUsage::names[MemoryUsage::KINDS] =
+{"adjacency"
+,"free lists"
+,"frozen"
+,"coordinates"
+,"classification"
+,"tags"
+,"remotes"
+,"ghosts"
+,"matches"
+};
+
+void printMemoryStats(Mesh* m)
+{
+  MemoryUsage u;
+  int has = m->getMemoryUsage(u);
+  if (!PCU_Or(has))
+    return;
+  /* allocated and live bytes of each kind, then the totals */
+  int const n = 2 * (MemoryUsage::KINDS + 1);
+  double mb[n];
+  double total[2] = {0, 0};
+  for (int i = 0; i < MemoryUsage::KINDS; ++i) {
+    mb[2 * i] = u.getAllocated(i) / (1024. * 1024.);
+    mb[2 * i + 1] = u.getLive(i) / (1024. * 1024.);
+    total[0] += mb[2 * i];
+    total[1] += mb[2 * i + 1];
+  }
+  mb[n - 2] = total[0];
+  mb[n - 1] = total[1];
+  double minMB[n];
+  double maxMB[n];
+  double avgMB[n];
+  for (int i = 0; i < n; ++i)
+    minMB[i] = maxMB[i] = avgMB[i] = mb[i];
+  PCU_Min_Doubles(minMB, n);
+  PCU_Max_Doubles(maxMB, n);
+  PCU_Add_Doubles(avgMB, n);
+  if (PCU_Comm_Self())
+    return;
+  int peers = PCU_Comm_Peers();
+  lion_oprint(1,"mesh memory in MB per part (min avg max), "
+      "allocated / live:\n");
+  for (int i = 0; i <= MemoryUsage::KINDS; ++i) {
+    char const* name = i < MemoryUsage::KINDS ?
+      MemoryUsage::names[i] : "total";
+    int a = 2 * i;
+    int l = a + 1;
+    lion_oprint(1,"  %-14s %9.3f %9.3f %9.3f / %9.3f %9.3f %9.3f\n", name,
+        minMB[a], avgMB[a] / peers, maxMB[a],
+        minMB[l], avgMB[l] / peers, maxMB[l]);
+  }
 }
 
 void warnAboutEmptyParts(Mesh* m)
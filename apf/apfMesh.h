@@ -93,6 +93,83 @@ typedef CopyArray Matches;
 /** \brief a set of DG copies */
 typedef CopyArray DgCopies;
 
+/** \brief direct view of the tag values of one entity type
+  \details slot i holds the values of the i'th entity of the
+  type in storage order, at byte offset i*stride from data.
+  Only slots with bit i of has set carry values; the rest
+  are holes or entities without this tag.
+  See apf::Mesh::getTagArray. */
+struct TagArray
+{
+  /** \brief required */
+  TagArray():data(0),has(0),stride(0),count(0) {}
+  /** \brief start of the first slot */
+  void* data;
+  /** \brief presence bitmap, one bit per slot */
+  unsigned char const* has;
+  /** \brief bytes from one slot to the next */
+  std::size_t stride;
+  /** \brief number of slots */
+  std::size_t count;
+  /** \brief returns true if slot i carries values */
+  bool hasValue(std::size_t i) const
+  {
+    return (has[i / 8] >> (i % 8)) & 1;
+  }
+  /** \brief returns the values in slot i as the tag's type */
+  template <class T>
+  T* get(std::size_t i) const
+  {
+    return reinterpret_cast<T*>(static_cast<char*>(data) + i * stride);
+  }
+};
+
+/** \brief bytes held by the data structures of a mesh part
+  \details allocated counts what each structure holds for each
+  entity type, live the part of that describing existing entities
+  and tag values. The rest is spare capacity and the slots
+  of destroyed entities.
+  See apf::Mesh::getMemoryUsage. */
+struct MemoryUsage
+{
+  /** \brief the structures being measured */
+  enum Kind
+  {
+    /** \brief downward and upward adjacency arrays */
+    ADJACENCY,
+    /** \brief free lists of entity slots */
+    FREE_LISTS,
+    /** \brief frozen adjacency snapshots */
+    FROZEN_ADJACENCY,
+    /** \brief vertex coordinates and parametric coordinates */
+    COORDINATES,
+    /** \brief model classification and residence */
+    CLASSIFICATION,
+    /** \brief all tags, including field data */
+    TAGS,
+    /** \brief remote copies */
+    REMOTES,
+    /** \brief ghost copies */
+    GHOSTS,
+    /** \brief periodic matches */
+    MATCHES,
+    /** \brief number of structures */
+    KINDS
+  };
+  /** \brief zeroes all counts */
+  MemoryUsage();
+  /** \brief bytes allocated per structure and apf::Mesh::Type */
+  std::size_t allocated[KINDS][8];
+  /** \brief bytes live per structure and apf::Mesh::Type */
+  std::size_t live[KINDS][8];
+  /** \brief bytes allocated by one structure over all types */
+  std::size_t getAllocated(int kind) const;
+  /** \brief bytes live in one structure over all types */
+  std::size_t getLive(int kind) const;
+  /** \brief a short name for each structure */
+  static char const* const names[KINDS];
+};
+
 /** \brief Interface to a mesh part
   \details This base class is the interface for almost all mesh
   operations in APF. Code that interacts with a mesh should do
@@ -348,6 +425,28 @@ class Mesh
       \returns an estimate of how many bytes are needed
       to store an entity of (type) */
     virtual double getElementBytes(int) {return 1.0;}
+    /** \brief get direct access to the tag values of one entity type
+      \details this lets kernels stream over all the values of a tag
+      without a virtual call per entity.
+      The view stays valid until entities are created or destroyed
+      or the tag is first attached to another entity of this type.
+      Values may be written through it, but presence bits must be
+      changed with setDoubleTag and friends.
+      \param type a value from apf::Mesh::Type
+      \returns false if this mesh does not store tags contiguously */
+    virtual bool getTagArray(MeshTag*, int, TagArray&) {return false;}
+    /** \brief measure the memory held by this mesh part
+      \returns false if this mesh does not keep such accounts */
+    virtual bool getMemoryUsage(MemoryUsage&) {return false;}
+    /** \brief get the parts this part exchanges with
+      \details these are the parts sharing or matching entities
+      with this one, as of the last acceptChanges.
+      Every part that answers true lists exactly the parts listing it,
+      so they can use PCU_Comm_Begin_Neighbors.
+      This does not communicate, the parts agree on the answer
+      during acceptChanges.
+      \returns false on all parts if this mesh does not know them */
+    virtual bool getNeighbors(Parts&) {return false;}
     /** \brief associate a field with this mesh
       \details most users don't need this, functions in apf.h
                automatically call it */
@@ -385,6 +484,12 @@ class Mesh
     GlobalNumbering* getGlobalNumbering(int i);
     /** \brief true if any associated fields use array storage */
     bool hasFrozenFields;
+    /** \brief incremented when entities or their copies may have changed
+      \details by Mesh2::acceptChanges where supported, which includes
+      the end of apf::migrate. Caches of shared entities such as
+      apf::CommPlan compare it to notice they are stale, without
+      communicating, so it must change on all ranks together. */
+    unsigned partitionVersion;
   protected:
     Field* coordinateField;
     std::vector<Field*> fields;
@@ -568,8 +673,15 @@ int countEntitiesOn(Mesh* m, ModelEntity* me, int dim);
            the default sharing is used if none is provided */
 int countOwned(Mesh* m, int dim, Sharing * shr = NULL);
 
-/** \brief print global mesh entity counts per dimension */
-void printStats(Mesh* m);
+/** \brief print global mesh entity counts per dimension
+  \param printMemory also call apf::printMemoryStats */
+void printStats(Mesh* m, bool printMemory = false);
+
+/** \brief print the minimum, average, and maximum over parts
+  of the memory held by each mesh structure
+  \details see apf::Mesh::getMemoryUsage. Prints nothing
+  if the mesh does not keep such accounts. */
+void printMemoryStats(Mesh* m);
 
 /** \brief print to stderr the number of empty parts, if any */
 void warnAboutEmptyParts(Mesh* m);
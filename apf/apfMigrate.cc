@@ -166,23 +166,17 @@ void packParts(int to, Parts& parts)
 {
   size_t n = parts.size();
   PCU_COMM_PACK(to,n);
+  int* p = PCU_COMM_RESERVE(to,int,n);
   APF_ITERATE(Parts,parts,it)
-  {
-    int p = *it;
-    PCU_COMM_PACK(to,p);
-  }
+    *(p++) = *it;
 }
 
 void unpackParts(Parts& parts)
 {
   size_t n;
   PCU_COMM_UNPACK(n);
-  for (size_t i=0;i<n;++i)
-  {
-    int p;
-    PCU_COMM_UNPACK(p);
-    parts.insert(p);
-  }
+  int const* p = PCU_COMM_EXTRACT(int,n);
+  parts.insert(p,p + n);
 }
 
 /* for every entity in the affected closure,
@@ -310,7 +304,7 @@ MeshEntity* unpackVertex(
   return m->createVertex(c,point,param);
 }
 
-static void packReference(
+static MeshEntity* getReference(
     Mesh2* m,
     int to,
     MeshEntity* e)
@@ -319,19 +313,12 @@ static void packReference(
   m->getRemotes(e,remotes);
   Copies::iterator found = remotes.find(to);
   if (found!=remotes.end())
-  {
-    MeshEntity* remote = found->second;
-    PCU_COMM_PACK(to,remote);
-  }
-  else
-  {
-    Copies ghosts;
-    m->getGhosts(e,ghosts);
-    found = ghosts.find(to);
-    PCU_ALWAYS_ASSERT(found!=ghosts.end());
-    MeshEntity* ghost = found->second;
-    PCU_COMM_PACK(to,ghost);
-  }
+    return found->second;
+  Copies ghosts;
+  m->getGhosts(e,ghosts);
+  found = ghosts.find(to);
+  PCU_ALWAYS_ASSERT(found!=ghosts.end());
+  return found->second;
 }
 
 static void packDownward(Mesh2* m, int to, MeshEntity* e)
@@ -340,8 +327,9 @@ static void packDownward(Mesh2* m, int to, MeshEntity* e)
   int d = getDimension(m, e);
   int n = m->getDownward(e,d-1,down);
   PCU_COMM_PACK(to,n);
+  MeshEntity** references = PCU_COMM_RESERVE(to,MeshEntity*,n);
   for (int i=0; i < n; ++i)
-    packReference(m,to,down[i]);
+    references[i] = getReference(m,to,down[i]);
 }
 
 static void unpackDownward(
@@ -349,8 +337,9 @@ static void unpackDownward(
 {
   int n;
   PCU_COMM_UNPACK(n);
+  MeshEntity* const* references = PCU_COMM_EXTRACT(MeshEntity*,n);
   for (int i=0; i < n; ++i)
-    PCU_COMM_UNPACK(entities[i]);
+    entities[i] = references[i];
 }
 
 static void packNonVertex(
@@ -391,17 +380,9 @@ static void packTags(
       int type = m->getTagType(tag);
       int size = m->getTagSize(tag);
       if (type == Mesh2::DOUBLE)
-      {
-        DynamicArray<double> d(size);
-        m->getDoubleTag(e,tag,&(d[0]));
-        PCU_Comm_Pack(to,&(d[0]),size*sizeof(double));
-      }
+        m->getDoubleTag(e,tag,PCU_COMM_RESERVE(to,double,size));
       if (type == Mesh2::INT)
-      {
-        DynamicArray<int> d(size);
-        m->getIntTag(e,tag,&(d[0]));
-        PCU_Comm_Pack(to,&(d[0]),size*sizeof(int));
-      }
+        m->getIntTag(e,tag,PCU_COMM_RESERVE(to,int,size));
     }
   }
 }
@@ -456,17 +437,9 @@ void unpackTags(
     int type = m->getTagType(tag);
     int size = m->getTagSize(tag);
     if (type == Mesh2::DOUBLE)
-    {
-      DynamicArray<double> d(size);
-      PCU_Comm_Unpack(&(d[0]),size*sizeof(double));
-      m->setDoubleTag(e,tag,&(d[0]));
-    }
+      m->setDoubleTag(e,tag,PCU_COMM_EXTRACT(double,size));
     if (type == Mesh2::INT)
-    {
-      DynamicArray<int> d(size);
-      PCU_Comm_Unpack(&(d[0]),size*sizeof(int));
-      m->setIntTag(e,tag,&(d[0]));
-    }
+      m->setIntTag(e,tag,PCU_COMM_EXTRACT(int,size));
   }
 }
 
@@ -846,13 +819,23 @@ static void migrate1(Mesh2* m, Migration* plan)
   getAffected(m,plan,affected);
   EntityVector senders[4];
   getSenders(m,affected,senders);
+  PCU_Profile_Push("reduceMatching");
   reduceMatchingToSenders(m,senders);
+  PCU_Profile_Pop();
+  PCU_Profile_Push("updateResidences");
   updateResidences(m,plan,affected);
+  PCU_Profile_Pop();
   delete plan;
+  PCU_Profile_Push("moveEntities");
   moveEntities(m,senders);
+  PCU_Profile_Pop();
+  PCU_Profile_Push("updateMatching");
   updateMatching(m,affected,senders);
+  PCU_Profile_Pop();
   deleteOldEntities(m,affected);
+  PCU_Profile_Push("acceptChanges");
   m->acceptChanges();
+  PCU_Profile_Pop();
 }
 
 const size_t maxMigrationLimit = 10*1000*1000;
@@ -896,10 +879,12 @@ static void migrate2(Mesh2* m, Migration* plan)
 
 void migrateSilent(Mesh2* m, Migration* plan)
 {
+  PCU_Profile_Push("migrate");
   if (PCU_Or(static_cast<size_t>(plan->count()) > migrationLimit))
     migrate2(m, plan);
   else
     migrate1(m, plan);
+  PCU_Profile_Pop();
 }
 
 void migrate(Mesh2* m, Migration* plan)
@@ -11,10 +11,13 @@
 #include "apfVector.h"
 #include "apfMatrix.h"
 #include <pcu_util.h>
+#include <pthread.h>
 
 namespace apf {
 
 static std::map<std::string, FieldShape*> registry;
+/* shapes register on first use, which may be on any thread */
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
 
 EntityShape::~EntityShape()
 {
@@ -30,6 +33,11 @@ void EntityShape::alignSharedNodes(Mesh* m,
   fail("unimplemented alignSharedNodes\n");
 }
 
+bool EntityShape::dependsOnEntity() const
+{
+  return true;
+}
+
 FieldShape::~FieldShape()
 {
 }
@@ -42,8 +50,10 @@ void FieldShape::getNodeXi(int, int, Vector3&)
 void FieldShape::registerSelf(const char* name_)
 {
   std::string name = name_;
+  pthread_mutex_lock(&registryLock);
   PCU_ALWAYS_ASSERT(registry.count(name) == 0);
   registry[name] = this;
+  pthread_mutex_unlock(&registryLock);
 }
 
 FieldShape* getShapeByName(const char* name)
@@ -63,9 +73,12 @@ FieldShape* getShapeByName(const char* name)
   getVoronoiShape(2,1);
   getIPFitShape(2,1);
   std::string s(name);
+  FieldShape* shape = 0;
+  pthread_mutex_lock(&registryLock);
   if (registry.count(s))
-    return registry[s];
-  return 0;
+    shape = registry[s];
+  pthread_mutex_unlock(&registryLock);
+  return shape;
 }
 
 class Linear : public FieldShape
@@ -87,6 +100,7 @@ class Linear : public FieldShape
         {
         }
         int countNodes() const {return 1;}
+        bool dependsOnEntity() const {return false;}
     };
     class Edge : public EntityShape
     {
@@ -106,6 +120,7 @@ class Linear : public FieldShape
           grads[1] = Vector3( 0.5,0,0);
         }
         int countNodes() const {return 2;}
+        bool dependsOnEntity() const {return false;}
     };
     class Triangle : public EntityShape
     {
@@ -127,6 +142,7 @@ class Linear : public FieldShape
           grads[2] = Vector3( 0, 1,0);
         }
         int countNodes() const {return 3;}
+        bool dependsOnEntity() const {return false;}
     };
     class Quad : public EntityShape
     {
@@ -159,6 +175,7 @@ class Linear : public FieldShape
           grads[3] = Vector3(-l1y, l0x,0)/4;
         }
         int countNodes() const {return 4;}
+        bool dependsOnEntity() const {return false;}
     };
     class Tetrahedron : public EntityShape
     {
@@ -182,6 +199,7 @@ class Linear : public FieldShape
           grads[3] = Vector3( 0, 0, 1);
         }
         int countNodes() const {return 4;}
+        bool dependsOnEntity() const {return false;}
     };
     class Prism : public EntityShape
     {
@@ -229,6 +247,7 @@ class Linear : public FieldShape
           grads[5] = tg[2] * up   + eg[1] * nt[2];
         }
         int countNodes() const {return 6;}
+        bool dependsOnEntity() const {return false;}
     };
     class Pyramid : public EntityShape
     {
@@ -266,6 +285,7 @@ class Linear : public FieldShape
           grads[4] = Vector3(0,0,0.5);
         }
         int countNodes() const {return 5;}
+        bool dependsOnEntity() const {return false;}
     };
     class Hexahedron : public EntityShape
     {
@@ -310,6 +330,7 @@ class Linear : public FieldShape
           grads[7] = Vector3(-l1y * l1z,  l0x * l1z,  l0x * l1y) / 8;
         }
         int countNodes() const {return 8;}
+        bool dependsOnEntity() const {return false;}
     };
     EntityShape* getEntityShape(int type)
     {
@@ -377,6 +398,7 @@ class QuadraticBase : public FieldShape
           grads[2] = Vector3(-2*xi[0],0,0);
         }
         int countNodes() const {return 3;}
+        bool dependsOnEntity() const {return false;}
     };
     class Triangle : public EntityShape
     {
@@ -407,6 +429,7 @@ class QuadraticBase : public FieldShape
           grads[5] = Vector3(-4*xi[1],4*(xi2-xi[1]),0);
         }
         int countNodes() const {return 6;}
+        bool dependsOnEntity() const {return false;}
     };
     class Tetrahedron : public EntityShape
     {
@@ -446,6 +469,7 @@ class QuadraticBase : public FieldShape
           grads[9] = Vector3(0,4*xi[2],4*xi[1]);
         }
         int countNodes() const {return 10;}
+        bool dependsOnEntity() const {return false;}
     };
     EntityShape* getEntityShape(int type)
     {
@@ -545,6 +569,7 @@ class LagrangeQuadratic : public QuadraticBase
               -2.0*n*(1-(e*e)), 0.0);
         }
         int countNodes() const {return 9;}
+        bool dependsOnEntity() const {return false;}
     };
     EntityShape* getEntityShape(int type)
     {
@@ -617,6 +642,7 @@ class SerendipityQuadratic : public QuadraticBase
         grads[7] = Vector3(xi[1]*xi[1]/2.0 - 0.5,   xi[0]*xi[1] - xi[1], 0.0);
       }
       int countNodes() const {return 8;}
+      bool dependsOnEntity() const {return false;}
     };
     EntityShape* getEntityShape(int type)
     {
@@ -662,6 +688,7 @@ class LagrangeCubic : public FieldShape
         {
         }
         int countNodes() const {return 1;}
+        bool dependsOnEntity() const {return false;}
     };
     class Edge : public EntityShape
     {
@@ -687,6 +714,7 @@ class LagrangeCubic : public FieldShape
           dN[3] = Vector3(27./16.*(-3.*xi*xi-2./3.*xi+1.), 0, 0);
         }
         int countNodes() const {return 4;}
+        bool dependsOnEntity() const {return false;}
     };
     class Triangle : public EntityShape
     {
@@ -731,6 +759,7 @@ class LagrangeCubic : public FieldShape
           dN[9] = (gl1*l2*l3+gl2*l1*l3+gl3*l1*l2)*27.;
         }
         int countNodes() const {return 10;}
+        bool dependsOnEntity() const {return false;}
         void alignSharedNodes(Mesh* m, MeshEntity* elem,
             MeshEntity* edge, int order[]) {
           int which, rotate;
@@ -812,6 +841,7 @@ class LagrangeCubic : public FieldShape
           dN[19] = (gl0*l2*l3 + gl2*l0*l3 + gl3*l0*l2)*27.;
         }
         int countNodes() const {return 20;}
+        bool dependsOnEntity() const {return false;}
         void alignSharedNodes(Mesh* m, MeshEntity* elem,
             MeshEntity* edge, int order[]) {
           int which, rotate;
@@ -934,6 +964,7 @@ class Constant : public FieldShape
           grads[0] = Vector3( 0, 0, 0);
         }
         int countNodes() const {return 1;}
+        bool dependsOnEntity() const {return false;}
         int getDimension() const {return D;}
     };
     EntityShape* getEntityShape(int type)
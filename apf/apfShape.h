@@ -65,8 +65,56 @@ class EntityShape
     help of apf::getAlignment */
     virtual void alignSharedNodes(Mesh* m,
         MeshEntity* elem, MeshEntity* shared, int order[]);
+/** \brief return true if values or gradients depend on the entity
+    \details shapes that only depend on xi return false,
+    which lets apf::getShapeTable tabulate them once
+    for every element. The default is true. */
+    virtual bool dependsOnEntity() const;
 };
 
+/** \brief Shape functions tabulated at integration points
+  \details holds the values and local gradients of one
+  apf::EntityShape at the points of one integration order.
+  Tables are built once by apf::getShapeTable and are
+  never modified or freed after that. */
+class ShapeTable
+{
+  public:
+    ShapeTable(EntityShape* s, int type, int order);
+/** \brief the number of integration points */
+    int countPoints() const {return points;}
+/** \brief the number of element nodes */
+    int countNodes() const {return nodes;}
+/** \brief parent element coordinates of a point */
+    Vector3 const& getPoint(int p) const {return xi[p];}
+/** \brief integration weight of a point */
+    double getWeight(int p) const {return weights[p];}
+/** \brief shape function values at a point, one per node */
+    double const* getValues(int p) const {return &values[p * nodes];}
+/** \brief local shape function gradients at a point,
+           one per node */
+    Vector3 const* getLocalGradients(int p) const
+    {
+      return &grads[p * nodes];
+    }
+  private:
+    int points;
+    int nodes;
+    NewArray<Vector3> xi;
+    NewArray<double> weights;
+    NewArray<double> values;
+    NewArray<Vector3> grads;
+};
+
+/** \brief Get the tabulation of a shape at integration points
+  \details tables are cached by (shape, type, order) and
+  are safe to look up from several threads.
+  \param type element type, select from apf::Mesh::Type
+  \param order the integration order, as in apf::getIntPoint
+  \returns NULL if the shape depends on the entity
+            or there is no integration of that order */
+ShapeTable const* getShapeTable(EntityShape* s, int type, int order);
+
 /** \brief Describes field distribution and shape functions
   \details these classes are typically singletons, one for
   each shape function scheme */
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2011 Scientific Computation Research Center
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "apfShape.h"
+#include "apfIntegrate.h"
+#include <pthread.h>
+#include <map>
+
+namespace apf {
+
+ShapeTable::ShapeTable(EntityShape* s, int type, int order)
+{
+  Integration const* in = getIntegration(type)->getAccurate(order);
+  points = in->countPoints();
+  nodes = s->countNodes();
+  xi.allocate(points);
+  weights.allocate(points);
+  values.allocate(points * nodes);
+  grads.allocate(points * nodes);
+  NewArray<double> v;
+  NewArray<Vector3> g;
+  for (int p = 0; p < points; ++p) {
+    IntegrationPoint const* ip = in->getPoint(p);
+    xi[p] = ip->param;
+    weights[p] = ip->weight;
+    s->getValues(0, 0, xi[p], v);
+    s->getLocalGradients(0, 0, xi[p], g);
+    for (int n = 0; n < nodes; ++n) {
+      values[p * nodes + n] = v[n];
+      /* vertex shapes leave their gradients empty */
+      if (g.allocated())
+        grads[p * nodes + n] = g[n];
+      else
+        grads[p * nodes + n] = Vector3(0,0,0);
+    }
+  }
+}
+
+struct ShapeTableKey
+{
+  EntityShape* shape;
+  int type;
+  int order;
+  bool operator<(ShapeTableKey const& other) const
+  {
+    if (shape != other.shape)
+      return shape < other.shape;
+    if (type != other.type)
+      return type < other.type;
+    return order < other.order;
+  }
+};
+
+/* tables outlive every element that points to them,
+   so they are only freed at exit */
+class ShapeTables
+{
+  public:
+    ShapeTables()
+    {
+      pthread_mutex_init(&lock, 0);
+    }
+    ~ShapeTables()
+    {
+      std::map<ShapeTableKey, ShapeTable*>::iterator it;
+      for (it = tables.begin(); it != tables.end(); ++it)
+        delete it->second;
+      pthread_mutex_destroy(&lock);
+    }
+    ShapeTable const* get(EntityShape* s, int type, int order)
+    {
+      ShapeTableKey key = {s, type, order};
+      pthread_mutex_lock(&lock);
+      ShapeTable*& t = tables[key];
+      if (!t)
+        t = new ShapeTable(s, type, order);
+      pthread_mutex_unlock(&lock);
+      return t;
+    }
+  private:
+    pthread_mutex_t lock;
+    std::map<ShapeTableKey, ShapeTable*> tables;
+};
+
+ShapeTable const* getShapeTable(EntityShape* s, int type, int order)
+{
+  static ShapeTables tables;
+  if (!s || s->dependsOnEntity())
+    return 0;
+  EntityIntegration const* ei = getIntegration(type);
+  if (!ei || !ei->getAccurate(order))
+    return 0;
+  return tables.get(s, type, order);
+}
+
+}//namespace apf
@@ -6,6 +6,7 @@
  */
 
 #include "apfTagData.h"
+#include "apf.h"
 #include "apfShape.h"
 
 #include <pcu_util.h>
@@ -60,6 +61,11 @@ MeshTag* TagData::makeOrFindTag(const char* name, int size)
 static const char* typePostfix[Mesh::TYPES] =
 {"ver","edg","tri","qua","tet","hex","pri","pyr"};
 
+const char* getTagDataPostfix(int type)
+{
+  return typePostfix[type];
+}
+
 void TagData::createTags(const char* name, int components)
 {
   PCU_ALWAYS_ASSERT(name);
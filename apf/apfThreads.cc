@@ -0,0 +1,63 @@
+/*
+ * Copyright 2011 Scientific Computation Research Center
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "apf.h"
+#include "apfThreads.h"
+#include <pcu_util.h>
+#include <pthread.h>
+
+namespace apf {
+
+static int loopThreads = 1;
+
+void setLoopThreads(int n)
+{
+  PCU_ALWAYS_ASSERT(n >= 1);
+  loopThreads = n;
+}
+
+int getLoopThreads()
+{
+  return loopThreads;
+}
+
+struct Range
+{
+  ThreadTask* task;
+  MeshEntity** begin;
+  MeshEntity** end;
+};
+
+static void* runRange(void* arg)
+{
+  Range* r = static_cast<Range*>(arg);
+  r->task->run(r->begin, r->end);
+  return 0;
+}
+
+void runThreads(std::vector<ThreadTask*> const& tasks,
+    std::vector<MeshEntity*>& entities)
+{
+  size_t n = tasks.size();
+  size_t m = entities.size();
+  MeshEntity** first = m ? &entities[0] : 0;
+  std::vector<Range> ranges(n);
+  for (size_t i = 0; i < n; ++i) {
+    ranges[i].task = tasks[i];
+    ranges[i].begin = first + (m * i) / n;
+    ranges[i].end = first + (m * (i + 1)) / n;
+  }
+  std::vector<pthread_t> threads(n);
+  for (size_t i = 1; i < n; ++i)
+    if (pthread_create(&threads[i], 0, runRange, &ranges[i]))
+      fail("runThreads could not start a thread");
+  runRange(&ranges[0]);
+  for (size_t i = 1; i < n; ++i)
+    pthread_join(threads[i], 0);
+}
+
+}
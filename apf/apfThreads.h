@@ -0,0 +1,34 @@
+/*
+ * Copyright 2011 Scientific Computation Research Center
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef APFTHREADS_H
+#define APFTHREADS_H
+
+#include <cstddef>
+#include <vector>
+
+namespace apf {
+
+class MeshEntity;
+
+/* the work of one thread in a threaded mesh loop */
+class ThreadTask
+{
+  public:
+    virtual ~ThreadTask() {}
+    virtual void run(MeshEntity** begin, MeshEntity** end) = 0;
+};
+
+/* splits the entities into as many contiguous ranges as there are
+   tasks, in order, and runs each task on its range. the first
+   task runs on the calling thread */
+void runThreads(std::vector<ThreadTask*> const& tasks,
+    std::vector<MeshEntity*>& entities);
+
+}
+
+#endif
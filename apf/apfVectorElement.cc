@@ -10,14 +10,39 @@
 
 namespace apf {
 
+static bool affineCaching = true;
+
+void setAffineCaching(bool on)
+{
+  affineCaching = on;
+}
+
+bool getAffineCaching()
+{
+  return affineCaching;
+}
+
 VectorElement::VectorElement(VectorField* f, MeshEntity* e):
   ElementOf<Vector3>(f,e)
 {
+  initAffine();
 }
 
 VectorElement::VectorElement(VectorField* f, VectorElement* p):
   ElementOf<Vector3>(f,p)
 {
+  initAffine();
+}
+
+void VectorElement::initAffine()
+{
+  int type = getType();
+  affine = affineCaching &&
+    field->getShape() == getLagrange(1) &&
+    (type == Mesh::EDGE || type == Mesh::TRIANGLE || type == Mesh::TET);
+  haveJacobian = false;
+  haveInverse = false;
+  dv = 0;
 }
 
 double VectorElement::div(Vector3 const& xi)
@@ -42,7 +67,7 @@ void VectorElement::curl(Vector3 const& xi, Vector3& c)
 }
 
 void VectorElement::gradHelper(
-    NewArray<Vector3>& nodalGradients,
+    Vector3 const* nodalGradients,
     Matrix3x3& g)
 {
   Vector3* nodeValues = getNodeValues();
@@ -55,14 +80,37 @@ void VectorElement::grad(Vector3 const& xi, Matrix3x3& g)
 {
   NewArray<Vector3> globalGradients;
   getGlobalGradients(xi,globalGradients);
-  gradHelper(globalGradients,g);
+  gradHelper(&globalGradients[0],g);
 }
 
 void VectorElement::getJacobian(Vector3 const& xi, Matrix3x3& J)
 {
-  NewArray<Vector3> localGradients;
-  this->shape->getLocalGradients(mesh, entity, xi, localGradients);
-  gradHelper(localGradients,J);
+  if (affine && haveJacobian) {
+    J = jacobian;
+    return;
+  }
+  NewArray<Vector3> buffer;
+  gradHelper(getLocalGradients(xi, buffer),J);
+  if (affine) {
+    jacobian = J;
+    dv = getJacobianDeterminant(J, getDimension());
+    haveJacobian = true;
+  }
+}
+
+void VectorElement::getJacobianInv(Vector3 const& xi, Matrix3x3& Jinv)
+{
+  if (affine && haveInverse) {
+    Jinv = jacobianInverse;
+    return;
+  }
+  Matrix3x3 J;
+  getJacobian(xi,J);
+  Jinv = getJacobianInverse(J, getDimension());
+  if (affine) {
+    jacobianInverse = Jinv;
+    haveInverse = true;
+  }
 }
 
 double getJacobianDeterminant(Matrix3x3 const& J, int dimension)
@@ -93,6 +141,8 @@ double getJacobianDeterminant(Matrix3x3 const& J, int dimension)
 
 double VectorElement::getDV(Vector3 const& xi)
 {
+  if (affine && haveJacobian)
+    return dv;
   Matrix3x3 J;
   getJacobian(xi,J);
   return getJacobianDeterminant(J,getDimension());
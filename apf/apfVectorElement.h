@@ -25,8 +25,18 @@ class VectorElement : public ElementOf<Vector3>
     void grad(Vector3 const& xi, Matrix3x3& g);
     void curl(Vector3 const& xi, Vector3& c);
     void getJacobian(Vector3 const& xi, Matrix3x3& J);
+    void getJacobianInv(Vector3 const& xi, Matrix3x3& Jinv);
     double getDV(Vector3 const& xi);
-    void gradHelper(NewArray<Vector3>& nodalGradients, Matrix3x3& g);
+    void gradHelper(Vector3 const* nodalGradients, Matrix3x3& g);
+  private:
+    void initAffine();
+    /* linear simplices have one Jacobian, computed on first use */
+    bool affine;
+    bool haveJacobian;
+    bool haveInverse;
+    Matrix3x3 jacobian;
+    Matrix3x3 jacobianInverse;
+    double dv;
 };
 
 double getJacobianDeterminant(Matrix3x3 const& J, int dimension);
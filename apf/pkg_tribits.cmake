@@ -36,6 +36,7 @@ set(APF_SOURCES
   apfAdjReorder.cc
   apfVtk.cc
   apfFieldData.cc
+  apfCommPlan.cc
   apfTagData.cc
   apfCoordData.cc
   apfArrayData.cc
@@ -48,6 +49,8 @@ set(APF_SOURCES
   apfBoundaryToElementXi.cc
   apfSimplexAngleCalcs.cc
   apfFile.cc
+  apfThreads.cc
+  apfShapeTable.cc
 )
 
 set(APF_HEADERS
@@ -67,7 +67,7 @@ int Grid::in(Indices is)
 
 BoxBuilder::BoxBuilder(int nx, int ny, int nz,
       double wx, double wy, double wz,
-      bool is):
+      bool is, MdsStorage storage):
   grid(nx + 1, ny + 1, nz + 1),
   mgrid(nx ? 3 : 1, ny ? 3 : 1, nz ? 3 : 1)
 {
@@ -78,7 +78,7 @@ BoxBuilder::BoxBuilder(int nx, int ny, int nz,
   is_simplex = is;
   formModelTable();
   gmi_model* gm = buildModel();
-  m = makeEmptyMdsMesh(gm, dim, false);
+  m = makeEmptyMdsMesh(gm, dim, false, storage);
   v.resize(grid.total());
   buildMeshAndModel();
 }
@@ -335,4 +335,13 @@ Mesh2* makeMdsBox(
   return bb.m;
 }
 
+Mesh2* makeMdsBox(
+    int nex, int ney, int nez,
+    double wx, double wy, double wz, bool is,
+    MdsStorage storage)
+{
+  BoxBuilder bb(nex, ney, nez, wx, wy, wz, is, storage);
+  return bb.m;
+}
+
 }
@@ -2,6 +2,7 @@
 #define APF_BOX_H
 
 #include <apfMesh2.h>
+#include "apfMDS.h"
 #include <gmi_base.h>
 
 namespace apf {
@@ -39,7 +40,7 @@ struct BoxBuilder
   std::vector<MeshEntity*> v;
   BoxBuilder(int nx, int ny, int nz,
       double wx, double wy, double wz,
-      bool is);
+      bool is, MdsStorage storage = MDS_STORAGE_HEAP);
   void formModelTable();
   void addModelUse(gmi_base* gb, agm_bdry ab, Indices di);
   gmi_model* buildModel();
@@ -73,6 +74,12 @@ struct BoxBuilder
 Mesh2* makeMdsBox(
     int nx, int ny, int nz, double wx, double wy, double wz, bool is);
 
+/** \brief create a box whose MDS arrays use the given storage
+  \details see apf::makeMdsBox and apf::MdsStorage */
+Mesh2* makeMdsBox(
+    int nx, int ny, int nz, double wx, double wy, double wz, bool is,
+    MdsStorage storage);
+
 }
 
 #endif
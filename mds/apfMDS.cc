@@ -16,14 +16,18 @@
 #include <apfMesh2.h>
 #include <apfConvert.h>
 #include <apfShape.h>
+#include <apf.h>
 #include <apfNumbering.h>
 #include <apfPartition.h>
 #include <apfFile.h>
 #include <cstring>
 #include <pcu_util.h>
+#include <reel.h>
 #include <cstdlib>
 #include <stdint.h>
 #include <limits>
+#include <string>
+#include <vector>
 
 extern "C" {
 
@@ -165,6 +169,8 @@ class MeshMDS : public Mesh2
       mesh = 0;
       isMatched = false;
       ownsModel = false;
+      knowsNeighbors = false;
+      smbVersion = 5;
     }
     MeshMDS(gmi_model* m, int d, bool isMatched_)
     {
@@ -173,6 +179,8 @@ class MeshMDS : public Mesh2
       mesh = mds_apf_create(m, d, cap);
       isMatched = isMatched_;
       ownsModel = true;
+      knowsNeighbors = false;
+      smbVersion = 5;
     }
     MeshMDS(gmi_model* m, Mesh* from)
     {
@@ -190,14 +198,19 @@ class MeshMDS : public Mesh2
       mesh = mds_apf_create(m,d,cap);
       isMatched = from->hasMatching();
       ownsModel = true;
+      knowsNeighbors = false;
+      smbVersion = 5;
       apf::convert(from,this);
     }
-    MeshMDS(gmi_model* m, const char* pathname)
+    MeshMDS(gmi_model* m, const char* pathname,
+        const char* const* keepTags = 0)
     {
       init(apf::getLagrange(1));
-      mesh = mds_read_smb(m, pathname, 0, this);
+      mesh = mds_read_smb(m, pathname, 0, keepTags, this);
       isMatched = PCU_Or(!mds_net_empty(&mesh->matches));
       ownsModel = true;
+      knowsNeighbors = false;
+      smbVersion = 5;
     }
     ~MeshMDS()
     {
@@ -394,29 +407,24 @@ class MeshMDS : public Mesh2
       for (size_t i = 0; i < p->ids.size(); ++i)
         residence.insert(p->ids[i]);
     }
-    MeshTag* createDoubleTag(const char* name, int size)
+    MeshTag* createTag(const char* name, int bytes, int type)
     {
       mds_tag* tag;
       PCU_ALWAYS_ASSERT(!mds_find_tag(&mesh->tags, name));
-      tag = mds_create_tag(&(mesh->tags),name,
-          sizeof(double)*size, Mesh::DOUBLE);
+      tag = mds_create_tag(&(mesh->tags),name,bytes,type);
       return reinterpret_cast<MeshTag*>(tag);
     }
+    MeshTag* createDoubleTag(const char* name, int size)
+    {
+      return createTag(name, sizeof(double)*size, Mesh::DOUBLE);
+    }
     MeshTag* createIntTag(const char* name, int size)
     {
-      mds_tag* tag;
-      PCU_ALWAYS_ASSERT(!mds_find_tag(&mesh->tags, name));
-      tag = mds_create_tag(&(mesh->tags),name,
-          sizeof(int)*size, Mesh::INT);
-      return reinterpret_cast<MeshTag*>(tag);
+      return createTag(name, sizeof(int)*size, Mesh::INT);
     }
     MeshTag* createLongTag(const char* name, int size)
     {
-      mds_tag* tag;
-      PCU_ALWAYS_ASSERT(!mds_find_tag(&mesh->tags, name));
-      tag = mds_create_tag(&(mesh->tags),name,
-          sizeof(long)*size, Mesh::LONG);
-      return reinterpret_cast<MeshTag*>(tag);
+      return createTag(name, sizeof(long)*size, Mesh::LONG);
     }
     MeshTag* findTag(const char* name)
     {
@@ -428,7 +436,7 @@ class MeshMDS : public Mesh2
     {
       mds_tag* tag;
       tag = reinterpret_cast<mds_tag*>(t);
-      mds_destroy_tag(&(mesh->tags),tag);
+      mds_destroy_tag(&(mesh->tags),tag,&(mesh->mds));
     }
     void getTags(DynamicArray<MeshTag*>& tags)
     {
@@ -490,7 +498,7 @@ class MeshMDS : public Mesh2
       mds_tag* tag;
       tag = reinterpret_cast<mds_tag*>(t);
       mds_id id = fromEnt(e);
-      mds_take_tag(tag,id);
+      mds_take_tag(tag,&(mesh->mds),id);
     }
     bool hasTag(MeshEntity* e, MeshTag* t)
     {
@@ -519,6 +527,45 @@ class MeshMDS : public Mesh2
       tag = reinterpret_cast<mds_tag*>(t);
       return tag->name;
     }
+    bool getTagArray(MeshTag* t, int type, TagArray& a)
+    {
+      mds_tag* tag;
+      tag = reinterpret_cast<mds_tag*>(t);
+      int mt = apf2mds(type);
+      a = TagArray();
+      a.stride = tag->bytes;
+      if (tag->sparse[mt])
+        return false;
+      if (!tag->has[mt])
+        return true;
+      a.data = tag->data[mt];
+      a.has = tag->has[mt];
+      a.count = mesh->mds.end[mt];
+      return true;
+    }
+    bool getMemoryUsage(MemoryUsage& u)
+    {
+      /* in the order of MemoryUsage::Kind */
+      static int const kinds[MemoryUsage::KINDS] =
+      {MDS_MEM_ADJACENCY
+      ,MDS_MEM_FREE
+      ,MDS_MEM_FROZEN
+      ,MDS_MEM_COORDINATES
+      ,MDS_MEM_CLASSIFICATION
+      ,MDS_MEM_TAGS
+      ,MDS_MEM_REMOTES
+      ,MDS_MEM_GHOSTS
+      ,MDS_MEM_MATCHES
+      };
+      mds_memory mem;
+      mds_apf_memory(mesh, &mem);
+      for (int k = 0; k < MemoryUsage::KINDS; ++k)
+      for (int t = 0; t < MDS_TYPES; ++t) {
+        u.allocated[k][mds2apf(t)] = mem.allocated[kinds[k]][t];
+        u.live[k][mds2apf(t)] = mem.live[kinds[k]][t];
+      }
+      return true;
+    }
     void renameTag(MeshTag* t, const char* newName)
     {
       mds_tag* tag;
@@ -539,11 +586,23 @@ class MeshMDS : public Mesh2
         if (mesh->mds.free[type][i] == MDS_LIVE)
           numLive++;
       }
-      int nWords = numLive / sizeof(uint16_t);
-      uint16_t* data = reinterpret_cast<uint16_t*>(tag->data[type]);
       uint32_t sum = 0;
-      while (nWords-- > 0)
-        sum += *(data++);
+      if (tag->sparse[type]) {
+        /* sum the words of the tagged entities in index order */
+        for (int i=0; i < mesh->mds.end[type]; ++i) {
+          mds_id e = mds_identify(type, i);
+          if (!mds_has_tag(tag, e))
+            continue;
+          uint16_t* data = static_cast<uint16_t*>(mds_get_tag(tag, e));
+          for (size_t j = 0; j < tag->bytes / sizeof(uint16_t); ++j)
+            sum += data[j];
+        }
+      } else {
+        int nWords = numLive / sizeof(uint16_t);
+        uint16_t* data = reinterpret_cast<uint16_t*>(tag->data[type]);
+        while (nWords-- > 0)
+          sum += *(data++);
+      }
       /* Use carries to compute 1's complement sum. */
       sum = (sum >> 16) + (sum & 0xFFFF);
       sum += sum >> 16;
@@ -558,9 +617,43 @@ class MeshMDS : public Mesh2
     {
       return mesh->user_model;
     }
+    /* updateOwners already communicates with all parts,
+       so the neighbor check adds one reduction alongside it */
     void acceptChanges()
     {
       updateOwners(this, pmodel);
+      findNeighbors();
+      ++partitionVersion;
+    }
+    /* the parts named by the partition model and the matches
+       list each other. ghost links are left out, so a mesh
+       with ghosts on any part does not claim to know its neighbors */
+    void findNeighbors()
+    {
+      neighbors.clear();
+      APF_ITERATE(PM, pmodel, it)
+        neighbors.insert(it->ids.begin(), it->ids.end());
+      neighbors.erase(getId());
+      mds_net* matches = &mesh->matches;
+      for (int t = 0; t < MDS_TYPES; ++t) {
+        if (!matches->data[t])
+          continue;
+        for (mds_id i = 0; i < mesh->mds.end[t]; ++i) {
+          mds_copies* c = matches->data[t][i];
+          if (c)
+            for (int j = 0; j < c->n; ++j)
+              neighbors.insert(c->c[j].p);
+        }
+      }
+      knowsNeighbors = PCU_Min_Int(mds_net_empty(&mesh->ghosts));
+      neighborComm = PCU_Get_Comm();
+    }
+    bool getNeighbors(Parts& parts)
+    {
+      if (!knowsNeighbors || neighborComm != PCU_Get_Comm())
+        return false;
+      parts = neighbors;
+      return true;
     }
 
     void migrate(Migration* plan)
@@ -574,7 +667,7 @@ class MeshMDS : public Mesh2
     void writeNative(const char* fileName)
     {
       double t0 = PCU_Time();
-      mesh = mds_write_smb(mesh, fileName, 0, this);
+      mesh = mds_write_smb(mesh, fileName, 0, smbVersion, this);
       double t1 = PCU_Time();
       if (!PCU_Comm_Self())
         lion_oprint(1,"mesh %s written in %f seconds\n", fileName, t1 - t0);
@@ -738,7 +831,9 @@ class MeshMDS : public Mesh2
     }
     void clear_()
     {
+      int storage = mesh->mds.storage;
       mesh = mds_apf_create(mesh->user_model, mesh->mds.d, mesh->mds.n);
+      mds_apf_set_storage(mesh, storage);
     }
     double getElementBytes(int type)
     {
@@ -758,6 +853,10 @@ class MeshMDS : public Mesh2
     PM pmodel;
     bool isMatched;
     bool ownsModel;
+    Parts neighbors;
+    bool knowsNeighbors;
+    MPI_Comm neighborComm;
+    int smbVersion;
 };
 
 Mesh2* makeEmptyMdsMesh(gmi_model* model, int dim, bool isMatched)
@@ -767,6 +866,33 @@ Mesh2* makeEmptyMdsMesh(gmi_model* model, int dim, bool isMatched)
   return m;
 }
 
+Mesh2* makeEmptyMdsMesh(gmi_model* model, int dim, bool isMatched,
+    MdsStorage storage)
+{
+  Mesh2* m = makeEmptyMdsMesh(model, dim, isMatched);
+  setMdsStorage(m, storage);
+  return m;
+}
+
+void setMdsStorage(Mesh2* mesh, MdsStorage storage)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(mesh);
+  mds_apf_set_storage(m->mesh,
+      storage == MDS_STORAGE_PAGED ? MDS_PAGED : MDS_HEAP);
+}
+
+void setMdsPagedReservation(size_t bytes)
+{
+  mds_paged_reservation = bytes;
+}
+
+void setMdsTagSparse(Mesh2* mesh, MeshTag* tag, bool sparse)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(mesh);
+  mds_set_tag_policy(reinterpret_cast<mds_tag*>(tag), &m->mesh->mds,
+      sparse ? MDS_TAG_AUTO : MDS_TAG_DENSE);
+}
+
 Mesh2* createMdsMesh(gmi_model* model, Mesh* from)
 {
   return new MeshMDS(model, from);
@@ -779,9 +905,64 @@ Mesh2* loadSerialMdsMesh(gmi_model* model, const char* meshfile)
 }
 
 Mesh2* loadMdsMesh(gmi_model* model, const char* meshfile)
+{
+  return loadMdsMesh(model, meshfile, 0);
+}
+
+static bool isListed(const char* const* names, const char* name)
+{
+  for (; *names; ++names)
+    if (!strcmp(*names, name))
+      return true;
+  return false;
+}
+
+/* fields and numberings are stored as one tag per entity type
+   named by apf::TagData, so listing a field keeps all of those.
+   curved meshes keep their coordinates the same way, and those
+   are always kept */
+static std::vector<const char*> expandTagNames(const char* const* names,
+    std::vector<std::string>& storage)
+{
+  std::vector<std::string> fields;
+  for (const char* const* n = names; *n; ++n)
+    fields.push_back(*n);
+  fields.push_back("coordinates");
+  for (size_t i = 0; i < fields.size(); ++i) {
+    storage.push_back(fields[i]);
+    for (int t = 0; t < Mesh::TYPES; ++t)
+      storage.push_back(fields[i] + '_' + getTagDataPostfix(t));
+  }
+  std::vector<const char*> expanded;
+  for (size_t i = 0; i < storage.size(); ++i)
+    expanded.push_back(storage[i].c_str());
+  expanded.push_back(0);
+  return expanded;
+}
+
+/* the file metadata recreates every field and numbering,
+   drop the ones whose data was not loaded */
+static void dropUnlisted(Mesh2* m, const char* const* names)
+{
+  for (int i = m->countFields() - 1; i >= 0; --i)
+    if (!isListed(names, getName(m->getField(i))))
+      destroyField(m->getField(i));
+  for (int i = m->countNumberings() - 1; i >= 0; --i)
+    if (!isListed(names, getName(m->getNumbering(i))))
+      destroyNumbering(m->getNumbering(i));
+}
+
+Mesh2* loadMdsMesh(gmi_model* model, const char* meshfile,
+    const char* const* tags)
 {
   double t0 = PCU_Time();
-  Mesh2* m = new MeshMDS(model, meshfile);
+  std::vector<std::string> storage;
+  std::vector<const char*> keep;
+  if (tags)
+    keep = expandTagNames(tags, storage);
+  Mesh2* m = new MeshMDS(model, meshfile, tags ? &keep[0] : 0);
+  if (tags)
+    dropUnlisted(m, tags);
   initResidence(m, m->getDimension());
   stitchMesh(m);
   m->acceptChanges();
@@ -793,11 +974,86 @@ Mesh2* loadMdsMesh(gmi_model* model, const char* meshfile)
   return m;
 }
 
+MemoryUsage getMdsMemoryUsage(Mesh2* m)
+{
+  MemoryUsage u;
+  m->getMemoryUsage(u);
+  return u;
+}
+
+void setMdsSmbVersion(Mesh2* in, int version)
+{
+  mds_check_smb_version(version);
+  static_cast<MeshMDS*>(in)->smbVersion = version;
+}
+
+int getMdsSmbVersion(Mesh2* in)
+{
+  return static_cast<MeshMDS*>(in)->smbVersion;
+}
+
+void writeMdsArchive(Mesh2* in, const char* path, int files)
+{
+  double t0 = PCU_Time();
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  m->mesh = mds_write_smb_archive(m->mesh, path, files, m->smbVersion, m);
+  double t1 = PCU_Time();
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"mesh %s written in %f seconds\n", path, t1 - t0);
+}
+
+static Mesh2* loadArchiveParts(gmi_model* model, const char* path)
+{
+  MeshMDS* m = new MeshMDS();
+  m->init(apf::getLagrange(1));
+  m->mesh = mds_read_smb_archive(model, path, m);
+  m->isMatched = PCU_Or(!mds_net_empty(&m->mesh->matches));
+  m->ownsModel = true;
+  initResidence(m, m->getDimension());
+  stitchMesh(m);
+  m->acceptChanges();
+  return m;
+}
+
+Mesh2* loadMdsArchive(gmi_model* model, const char* path)
+{
+  double t0 = PCU_Time();
+  int parts = mds_count_smb_archive(path);
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  if (parts > peers)
+    reel_fail("MDS: archive %s has %d parts, load it on at least that many"
+        " ranks and use Parma_ShrinkPartition to reduce them\n",
+        path, parts);
+  Mesh2* m = 0;
+  if (parts == peers) {
+    m = loadArchiveParts(model, path);
+  } else {
+    /* the ranks that keep parts after apf::expandMdsMesh read them */
+    Contract contract(parts, peers);
+    bool isOriginal = contract.isValid(self);
+    MPI_Comm all = PCU_Get_Comm();
+    MPI_Comm group;
+    MPI_Comm_split(all, isOriginal, isOriginal ? contract(self) : 0,
+        &group);
+    PCU_Switch_Comm(group);
+    if (isOriginal)
+      m = loadArchiveParts(model, path);
+    PCU_Switch_Comm(all);
+    MPI_Comm_free(&group);
+    m = expandMdsMesh(m, model, parts);
+  }
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"mesh %s loaded in %f seconds\n", path, PCU_Time() - t0);
+  printStats(m);
+  warnAboutEmptyParts(m);
+  return m;
+}
+
 Mesh2* loadMdsMesh(const char* modelfile, const char* meshfile)
 {
   double t0 = PCU_Time();
-  static gmi_model* model;
-  model = gmi_load(modelfile);
+  gmi_model* model = gmi_load(modelfile);
   if (!PCU_Comm_Self())
     lion_oprint(1,"model %s loaded in %f seconds\n", modelfile, PCU_Time() - t0);
 
@@ -820,6 +1076,45 @@ void reorderMdsMesh(Mesh2* mesh, MeshTag* t)
     lion_oprint(1,"mesh reordered in %f seconds\n", PCU_Time()-t0);
 }
 
+void reorderMdsMesh(Mesh2* mesh, MdsOrdering ordering)
+{
+  double t0 = PCU_Time();
+  MeshMDS* m = static_cast<MeshMDS*>(mesh);
+  mds_tag* nums = 0;
+  switch (ordering) {
+    case MDS_ORDER_BFS:
+      nums = mds_number_verts_bfs(m->mesh);
+      break;
+    case MDS_ORDER_RCM:
+      nums = mds_number_verts_rcm(m->mesh);
+      break;
+    case MDS_ORDER_HILBERT:
+      nums = mds_number_verts_sfc(m->mesh, MDS_HILBERT);
+      mds_number_elems_sfc(m->mesh, nums, MDS_HILBERT);
+      break;
+    case MDS_ORDER_MORTON:
+      nums = mds_number_verts_sfc(m->mesh, MDS_MORTON);
+      mds_number_elems_sfc(m->mesh, nums, MDS_MORTON);
+      break;
+  }
+  PCU_ALWAYS_ASSERT(nums);
+  if (ordering == MDS_ORDER_HILBERT || ordering == MDS_ORDER_MORTON)
+    m->mesh = mds_reorder_elems(m->mesh, 0, nums);
+  else
+    m->mesh = mds_reorder(m->mesh, 0, nums);
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"mesh reordered in %f seconds\n", PCU_Time()-t0);
+}
+
+void compactMdsMesh(Mesh2* mesh)
+{
+  double t0 = PCU_Time();
+  MeshMDS* m = static_cast<MeshMDS*>(mesh);
+  mds_compact(m->mesh);
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"mesh compacted in %f seconds\n", PCU_Time()-t0);
+}
+
 Mesh2* expandMdsMesh(Mesh2* m, gmi_model* g, int inputPartCount)
 {
   double t0 = PCU_Time();
@@ -1105,6 +1400,34 @@ void changeMdsDimension(Mesh2* in, int d)
   return mds_change_dimension(&(m->mesh->mds), d);
 }
 
+std::size_t freezeMdsAdjacency(Mesh2* in, int from, int to)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  return mds_freeze(&(m->mesh->mds), from, to);
+}
+
+std::size_t freezeMdsMesh(Mesh2* in)
+{
+  std::size_t bytes = 0;
+  int d = in->getDimension();
+  for (int from = 0; from <= d; ++from)
+  for (int to = 0; to <= d; ++to)
+    bytes += freezeMdsAdjacency(in, from, to);
+  return bytes;
+}
+
+void thawMdsMesh(Mesh2* in)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  mds_thaw(&(m->mesh->mds));
+}
+
+std::size_t getMdsFrozenBytes(Mesh2* in)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  return mds_frozen_bytes(&(m->mesh->mds));
+}
+
 int getMdsIndex(Mesh2* in, MeshEntity* e)
 {
   MeshMDS* m = static_cast<MeshMDS*>(in);
@@ -1155,7 +1478,7 @@ Mesh2* loadMdsPart(gmi_model* model, const char* meshfile)
 {
   MeshMDS* m = new MeshMDS();
   m->init(apf::getLagrange(1));
-  m->mesh = mds_read_smb(model, meshfile, 1, m);
+  m->mesh = mds_read_smb(model, meshfile, 1, 0, m);
   m->isMatched = false;
   m->ownsModel = true;
   initResidence(m, m->getDimension());
@@ -1165,7 +1488,7 @@ Mesh2* loadMdsPart(gmi_model* model, const char* meshfile)
 void writeMdsPart(Mesh2* in, const char* meshfile)
 {
   MeshMDS* m = static_cast<MeshMDS*>(in);
-  m->mesh = mds_write_smb(m->mesh, meshfile, 1, m);
+  m->mesh = mds_write_smb(m->mesh, meshfile, 1, m->smbVersion, m);
 }
 
 
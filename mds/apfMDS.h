@@ -31,6 +31,7 @@
   \brief Interface to the compact Mesh Data Structure */
 
 #include <map>
+#include <cstddef>
 
 struct gmi_model;
 
@@ -41,6 +42,7 @@ class Mesh2;
 class MeshTag;
 class MeshEntity;
 class Migration;
+struct MemoryUsage;
 
 /** \brief a map from global ids to vertex objects */
 typedef std::map<int, MeshEntity*> GlobalToVert;
@@ -52,6 +54,54 @@ typedef std::map<int, MeshEntity*> GlobalToVert;
   \param isMatched whether or not there will be matched entities */
 Mesh2* makeEmptyMdsMesh(gmi_model* model, int dim, bool isMatched);
 
+/** \brief backends for the entity-indexed MDS arrays */
+enum MdsStorage
+{
+  /** \brief malloc'ed arrays that grow by realloc (the default) */
+  MDS_STORAGE_HEAP,
+  /** \brief arrays that each reserve a range of virtual memory
+    (see apf::setMdsPagedReservation) and grow in place inside it,
+    so that they keep their address and a growing mesh never holds
+    two copies of an array. Only the pages in use are resident.
+    An array that outgrows its range is remapped to a larger one
+    without copying. This is for address stability: it does not
+    lower peak memory or time where realloc already grows large
+    blocks by remapping, as glibc does. Falls back to the heap
+    where the OS cannot reserve memory */
+  MDS_STORAGE_PAGED
+};
+
+/** \brief create an empty MDS part using the given array storage
+  \details meant for meshes that will grow a lot after creation,
+  for example by mesh adaptation.
+  See apf::makeEmptyMdsMesh(gmi_model*,int,bool) */
+Mesh2* makeEmptyMdsMesh(gmi_model* model, int dim, bool isMatched,
+    MdsStorage storage);
+
+/** \brief move all MDS arrays of an existing mesh to the given storage
+  \details this is useful before adapting a mesh that was loaded
+  from a file. The storage is kept by apf::reorderMdsMesh. */
+void setMdsStorage(Mesh2* mesh, MdsStorage storage);
+
+/** \brief set the virtual memory each new paged MDS array reserves
+  \details the default is 4GB. Arrays that grow past their range
+  move once to a range twice their size, so this only needs
+  to be larger than the arrays expected to keep their address.
+  The setting applies to all meshes of the process. */
+void setMdsPagedReservation(size_t bytes);
+
+/** \brief choose between sparse and dense storage for an MDS tag
+  \details tags keep one array slot per entity by default.
+  Passing true lets entity types where only a small fraction
+  of entities carry the tag keep its values in a hash table,
+  switching to arrays when the table would outgrow them
+  (and back as values are removed). While a type is kept in
+  a table, apf::Mesh::getTagArray fails for it.
+  Passing false returns the tag to arrays.
+  The choice is saved in SMB version 6 files (see
+  apf::setMdsSmbVersion). Tags read from version 5 files use arrays. */
+void setMdsTagSparse(Mesh2* mesh, MeshTag* tag, bool sparse);
+
 /** \brief load an MDS mesh and model from file
   \param modelfile will be passed to gmi_load to get the model
   \note gmi_register_mesh and gmi_register_null need to be
@@ -76,6 +126,57 @@ Mesh2* loadMdsMesh(const char* modelfile, const char* meshfile);
                   resulting object will do the same in reverse. */
 Mesh2* loadMdsMesh(gmi_model* model, const char* meshfile);
 
+/** \brief load an MDS mesh, reading only some of its tags
+  \param tags a NULL-terminated list of the names of tags, fields,
+              and numberings to load. NULL loads everything.
+  \details the data of unlisted tags is skipped over in the file
+           and they do not appear on the resulting mesh.
+           This saves time and memory when a file carries large
+           fields that the caller does not need.
+           The coordinates of curved meshes are always loaded. */
+Mesh2* loadMdsMesh(gmi_model* model, const char* meshfile,
+    const char* const* tags);
+
+/** \brief choose the SMB format version that apf::Mesh::writeNative
+           and apf::writeMdsArchive write for this mesh
+  \param version 5 (the default), which every SMB reader accepts,
+                 or 6, which stores the bulk arrays raw in the byte
+                 order of the writer so that readers on machines of
+                 the same byte order load them straight from a
+                 mapping of the file. Both versions can be read.
+  \details the choice belongs to the mesh, so parts run by
+           different threads of one process do not affect
+           each other. Meshes loaded from files start at 5. */
+void setMdsSmbVersion(Mesh2* m, int version);
+
+/** \brief get the version set by apf::setMdsSmbVersion */
+int getMdsSmbVersion(Mesh2* m);
+
+/** \brief write an MDS mesh to a few shared files
+  \param path a path ending in ".smba". If it is "something.smba",
+              the files "somethingN.smba" are written.
+  \param files the number of files, each holding the parts
+               of a contiguous range of ranks
+  \details unlike apf::Mesh::writeNative, which writes one file
+           per part, this packs the parts behind an index of their
+           offsets and writes them with collective MPI-IO, which
+           keeps the file count low at large rank counts */
+void writeMdsArchive(Mesh2* m, const char* path, int files);
+
+/** \brief load a mesh written by apf::writeMdsArchive
+  \details this can run on any number of ranks at least equal to
+           the number of parts written. When there are more ranks,
+           the parts are read by the ranks that apf::expandMdsMesh
+           keeps and then expanded to all ranks, leaving the
+           extra parts empty for a partitioner to fill. */
+Mesh2* loadMdsArchive(gmi_model* model, const char* path);
+
+/** \brief measure the memory held by each MDS structure
+  \details returns bytes allocated and live per structure and
+           entity type on this part, see apf::MemoryUsage.
+           apf::printMemoryStats summarizes them over all parts. */
+MemoryUsage getMdsMemoryUsage(Mesh2* m);
+
 // make a serial mesh on all processes - no pmodel & remote link setup
 Mesh2* loadSerialMdsMesh(gmi_model* model, const char* meshfile);
 
@@ -99,6 +200,40 @@ Mesh2* createMdsMesh(gmi_model* model, Mesh* from);
            there are no gaps in the MDS arrays after this */
 void reorderMdsMesh(Mesh2* mesh, MeshTag* t = 0);
 
+/** \brief remove the gaps left in MDS arrays by mesh modification
+  \details unlike apf::reorderMdsMesh, this keeps the current entity
+  order and does not build a second copy of the mesh.
+  Live entities are moved down over the gaps within the existing
+  allocations, including tags, coordinates and remote copies,
+  and the allocations are then shrunk to the live entity counts,
+  so peak memory stays close to the size of the live mesh.
+  This is a collective call, since remote copies are renumbered.
+  As with reordering, all MeshEntity pointers are invalidated. */
+void compactMdsMesh(Mesh2* mesh);
+
+/** \brief built-in orderings for apf::reorderMdsMesh */
+enum MdsOrdering {
+  /** \brief breadth-first traversal of the vertex graph
+    starting from a vertex on a model vertex, the default */
+  MDS_ORDER_BFS,
+  /** \brief reverse Cuthill-McKee ordering of the vertex graph,
+    which minimizes the bandwidth of vertex-based sparse matrices */
+  MDS_ORDER_RCM,
+  /** \brief Hilbert curve ordering of vertices and elements
+    by their coordinates and centroids */
+  MDS_ORDER_HILBERT,
+  /** \brief Morton (Z-order) curve ordering of vertices and elements
+    by their coordinates and centroids */
+  MDS_ORDER_MORTON
+};
+
+/** \brief apply one of the built-in orderings
+  \details vertices are ordered as requested. For the space-filling
+  curve orderings, elements are ordered along the same curve by their
+  centroids. All other entities are ordered by traversing adjacencies
+  from the sorted vertices, as with apf::reorderMdsMesh(Mesh2*,MeshTag*) */
+void reorderMdsMesh(Mesh2* mesh, MdsOrdering ordering);
+
 Mesh2* repeatMdsMesh(Mesh2* m, gmi_model* g, Migration* plan, int factor);
 Mesh2* expandMdsMesh(Mesh2* m, gmi_model* g, int inputPartCount);
 
@@ -176,6 +311,29 @@ void derive2DMdlFromManifold(Mesh2* mesh, bool* isModelVert,
   (when reducing a high dimensional mesh to a lower one) */
 void changeMdsDimension(Mesh2* in, int d);
 
+/** \brief snapshot one adjacency pair into compact read-only arrays
+  \details after this call, getAdjacent, getUp, and related queries
+  from entities of dimension (from) to dimension (to) are served from
+  a contiguous compressed sparse row array instead of walking
+  the MDS linked lists or deriving second-order adjacencies.
+  The snapshot is discarded automatically as soon as the
+  mesh topology is modified.
+  \returns the number of bytes allocated for this pair */
+std::size_t freezeMdsAdjacency(Mesh2* in, int from, int to);
+
+/** \brief snapshot all upward and downward adjacency pairs
+  \details see apf::freezeMdsAdjacency.
+  This only touches the local part and does not communicate.
+  \returns the number of bytes allocated by all snapshots
+           on this part */
+std::size_t freezeMdsMesh(Mesh2* in);
+
+/** \brief discard all adjacency snapshots of an MDS mesh */
+void thawMdsMesh(Mesh2* in);
+
+/** \brief returns the bytes currently used by adjacency snapshots */
+std::size_t getMdsFrozenBytes(Mesh2* in);
+
 /** \brief returns the dimension-unique index for this entity
  \details this function only works when the arrays have no gaps,
  so call apf::reorderMdsMesh after any mesh modification. */
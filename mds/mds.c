@@ -17,22 +17,8 @@
 #include <reel.h>
 #include <lionPrint.h>
 
-static void* mds_realloc(void* p, size_t n)
-{
-  if ((!p)&&(!n))
-    return NULL;
-  if (n)
-    p = realloc(p,n);
-  else {
-    free(p);
-    p = NULL;
-  }
-  if ((!p) && (n))
-    reel_fail("MDS ran out of memory!\n");
-  return p;
-}
-
-#define REALLOC(p,n) ((p)=mds_realloc(p,(n)*sizeof(*(p))))
+#define REALLOC(m,p,n) \
+  ((p)=mds_resize_array(p,(n)*sizeof(*(p)),(m)->storage))
 #define ZERO(o) memset(&(o),0,sizeof(o))
 
 int const mds_dim[MDS_TYPES] =
@@ -188,7 +174,7 @@ static void resize_down(struct mds* m, int from, int to,
   for (t = 0; t < MDS_TYPES; ++t)
     if (mds_dim[t] == from) {
       deg = mds_degree[t][to];
-      REALLOC(m->down[to][t],new_cap[t] * deg);
+      REALLOC(m,m->down[to][t],new_cap[t] * deg);
     }
 }
 
@@ -202,9 +188,9 @@ static void resize_up(struct mds* m, int from, int to,
   for (t = 0; t < MDS_TYPES; ++t) {
     if (mds_dim[t] == to) {
       deg = mds_degree[t][from];
-      REALLOC(m->up[from][t],new_cap[t] * deg);
+      REALLOC(m,m->up[from][t],new_cap[t] * deg);
     } else if (mds_dim[t] == from) {
-      REALLOC(m->first_up[to][t],new_cap[t]);
+      REALLOC(m,m->first_up[to][t],new_cap[t]);
       for (i = old_cap[t]; i < new_cap[t]; ++i) {
         PCU_ALWAYS_ASSERT(m->first_up[to][t]);
         m->first_up[to][t][i] = MDS_NONE;
@@ -236,6 +222,7 @@ static void alloc_adjacency(struct mds* m, int from_dim, int to_dim)
 void mds_remove_adjacency(struct mds* m, int from_dim, int to_dim)
 {
   mds_id zero_cap[MDS_TYPES] = {0};
+  mds_thaw(m);
   resize_adjacency(m,from_dim,to_dim,m->cap,zero_cap);
   m->mrm[from_dim][to_dim] = 0;
 }
@@ -253,7 +240,7 @@ static void resize_free(struct mds* m)
 {
   int t;
   for (t = 0; t < MDS_TYPES; ++t)
-    REALLOC(m->free[t],m->cap[t]);
+    REALLOC(m,m->free[t],m->cap[t]);
 }
 
 static void resize(struct mds* m, mds_id old_cap[MDS_TYPES])
@@ -285,10 +272,92 @@ void mds_destroy(struct mds* m)
   mds_id old_cap[MDS_TYPES];
   for (i = 0; i < MDS_TYPES; ++i)
     old_cap[i] = m->cap[i];
+  mds_thaw(m);
   ZERO(m->cap);
   resize(m,old_cap);
 }
 
+void mds_set_storage(struct mds* m, int storage)
+{
+  int i,j;
+  int t;
+  int from;
+  mds_id* cap = m->cap;
+  from = m->storage;
+  m->storage = storage;
+  for (i = 0; i <= 3; ++i)
+  for (j = 0; j <= 3; ++j) {
+    if (!m->mrm[i][j])
+      continue;
+    for (t = 0; t < MDS_TYPES; ++t) {
+      if (i < j && mds_dim[t] == j)
+        m->up[i][t] = mds_move_array(m->up[i][t],
+            cap[t] * mds_degree[t][i] * sizeof(mds_id), from, storage);
+      else if (i < j && mds_dim[t] == i)
+        m->first_up[j][t] = mds_move_array(m->first_up[j][t],
+            cap[t] * sizeof(mds_id), from, storage);
+      else if (i > j && mds_dim[t] == i)
+        m->down[j][t] = mds_move_array(m->down[j][t],
+            cap[t] * mds_degree[t][j] * sizeof(mds_id), from, storage);
+    }
+  }
+  for (t = 0; t < MDS_TYPES; ++t)
+    m->free[t] = mds_move_array(m->free[t], cap[t] * sizeof(mds_id),
+        from, storage);
+}
+
+void mds_measure(struct mds* m, struct mds_memory* mem)
+{
+  int i,j;
+  int t;
+  size_t deg;
+  size_t* alloc;
+  size_t* live;
+  alloc = mem->allocated[MDS_MEM_ADJACENCY];
+  live = mem->live[MDS_MEM_ADJACENCY];
+  for (i = 0; i <= 3; ++i)
+  for (j = 0; j <= 3; ++j) {
+    if (!m->mrm[i][j])
+      continue;
+    for (t = 0; t < MDS_TYPES; ++t) {
+      if (i < j && mds_dim[t] == j) {
+        deg = mds_degree[t][i];
+        if (m->up[i][t])
+          alloc[t] += m->cap[t] * deg * sizeof(mds_id);
+        live[t] += m->n[t] * deg * sizeof(mds_id);
+      } else if (i < j && mds_dim[t] == i) {
+        if (m->first_up[j][t])
+          alloc[t] += m->cap[t] * sizeof(mds_id);
+        live[t] += m->n[t] * sizeof(mds_id);
+      } else if (i > j && mds_dim[t] == i) {
+        deg = mds_degree[t][j];
+        if (m->down[j][t])
+          alloc[t] += m->cap[t] * deg * sizeof(mds_id);
+        live[t] += m->n[t] * deg * sizeof(mds_id);
+      }
+    }
+  }
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (m->free[t])
+      mem->allocated[MDS_MEM_FREE][t] += m->cap[t] * sizeof(mds_id);
+    mem->live[MDS_MEM_FREE][t] += m->n[t] * sizeof(mds_id);
+  }
+  mds_frozen_memory(m, mem->allocated[MDS_MEM_FROZEN]);
+  mds_frozen_memory(m, mem->live[MDS_MEM_FROZEN]);
+}
+
+void mds_shrink(struct mds* m)
+{
+  int t;
+  mds_id old_cap[MDS_TYPES];
+  for (t = 0; t < MDS_TYPES; ++t) {
+    PCU_ALWAYS_ASSERT(m->end[t] == m->n[t]);
+    old_cap[t] = m->cap[t];
+    m->cap[t] = m->n[t];
+  }
+  resize(m,old_cap);
+}
+
 #define ID(t,i) ((i)*MDS_TYPES + (t))
 #define TYPE(id) ((id) % MDS_TYPES)
 #define INDEX(id) ((id) / MDS_TYPES)
@@ -606,6 +675,7 @@ static void unrelate_ent(struct mds* m, mds_id e)
 void mds_destroy_entity(struct mds* m, mds_id e)
 {
   check_ent(m,e);
+  mds_thaw(m);
   if (TYPE(e) != MDS_VERTEX)
     unrelate_ent(m,e);
   free_ent(m,e);
@@ -621,6 +691,7 @@ void mds_hack_adjacent(struct mds* m, mds_id up, int i, mds_id down)
   mds_id od;
   check_ent(m, up);
   check_ent(m, down);
+  mds_thaw(m);
   ut = TYPE(up);
   ui = INDEX(up);
   dd = mds_dim[ut] - 1;
@@ -674,6 +745,7 @@ mds_id mds_create_entity(struct mds* m, int t, mds_id* from)
 {
   PCU_ALWAYS_ASSERT(0 <= t);
   PCU_ALWAYS_ASSERT(t < MDS_TYPES);
+  mds_thaw(m);
   if (t == MDS_VERTEX)
     return alloc_ent(m, t);
   return add_ent(m, t, from);
@@ -732,6 +804,8 @@ void mds_get_adjacent(struct mds* m, mds_id e, int d, struct mds_set* s)
     return;
   }
   check_ent(m,e);
+  if (m->frozen && mds_get_frozen(m,e,d,s))
+    return;
   e_dim = mds_dim[TYPE(e)];
   if ((e_dim == d) || m->mrm[e_dim][d]) {
     look(m,e,d,s);
@@ -781,6 +855,7 @@ void mds_add_adjacency(struct mds* m, int from_dim, int to_dim)
 {
   mds_id e;
   struct mds_set adj;
+  mds_thaw(m);
   alloc_adjacency(m,from_dim,to_dim);
   if (from_dim < to_dim)
     for (e = mds_begin(m,to_dim);
@@ -833,6 +908,7 @@ static void decrease_dimension(struct mds* m)
 
 void mds_change_dimension(struct mds* m, int d)
 {
+  mds_thaw(m);
   while (m->d < d)
     increase_dimension(m);
   while (m->d > d)
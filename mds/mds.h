@@ -12,6 +12,7 @@
 #define MDS_H
 
 #include "mds_config.h"
+#include <stddef.h>
 
 enum {
   MDS_VERTEX,
@@ -30,8 +31,17 @@ typedef MDS_ID_TYPE mds_id;
 #define MDS_NONE -1
 #define MDS_LIVE -2
 
+struct mds_frozen;
+
+/* backends for entity-indexed arrays, see mds_alloc.c */
+enum {
+  MDS_HEAP,
+  MDS_PAGED
+};
+
 struct mds {
   int d;
+  int storage;
   mds_id n[MDS_TYPES];
   mds_id cap[MDS_TYPES];
   mds_id end[MDS_TYPES];
@@ -41,6 +51,29 @@ struct mds {
   mds_id* first_up[4][MDS_TYPES];
   mds_id* free[MDS_TYPES];
   mds_id first_free[MDS_TYPES];
+  struct mds_frozen* frozen;
+};
+
+/* structures whose memory is reported by mds_apf_memory */
+enum {
+  MDS_MEM_ADJACENCY,
+  MDS_MEM_FREE,
+  MDS_MEM_FROZEN,
+  MDS_MEM_COORDINATES,
+  MDS_MEM_CLASSIFICATION,
+  MDS_MEM_TAGS,
+  MDS_MEM_REMOTES,
+  MDS_MEM_GHOSTS,
+  MDS_MEM_MATCHES,
+  MDS_MEM_KINDS
+};
+
+/* bytes per structure and entity type. allocated is what the arrays
+   hold, live is the part of it describing existing entities, the
+   rest being spare capacity and slots of destroyed entities */
+struct mds_memory {
+  size_t allocated[MDS_MEM_KINDS][MDS_TYPES];
+  size_t live[MDS_MEM_KINDS][MDS_TYPES];
 };
 
 struct mds_set {
@@ -54,6 +87,9 @@ extern int const* mds_types[MDS_TYPES][4];
 
 void mds_create(struct mds* m, int d, mds_id cap[MDS_TYPES]);
 void mds_destroy(struct mds* m);
+void mds_shrink(struct mds* m);
+void mds_measure(struct mds* m, struct mds_memory* mem);
+void mds_set_storage(struct mds* m, int storage);
 mds_id mds_create_entity(struct mds* m, int type, mds_id *from);
 void mds_destroy_entity(struct mds* m, mds_id e);
 int mds_type(mds_id e);
@@ -72,4 +108,18 @@ void mds_change_dimension(struct mds* m, int d);
 
 void mds_hack_adjacent(struct mds* m, mds_id up, int i, mds_id down);
 
+size_t mds_freeze(struct mds* m, int from_dim, int to_dim);
+void mds_thaw(struct mds* m);
+int mds_is_frozen(struct mds* m, int from_dim, int to_dim);
+size_t mds_frozen_bytes(struct mds* m);
+void mds_frozen_memory(struct mds* m, size_t bytes[MDS_TYPES]);
+int mds_get_frozen(struct mds* m, mds_id e, int d, struct mds_set* s);
+
+void* mds_resize_array(void* p, size_t bytes, int storage);
+void* mds_calloc_array(size_t bytes, int storage);
+void mds_free_array(void* p, int storage);
+void* mds_move_array(void* p, size_t bytes, int from, int to);
+
+extern size_t mds_paged_reservation;
+
 #endif
@@ -0,0 +1,199 @@
+/******************************************************************************
+
+  Copyright 2014 Scientific Computation Research Center,
+      Rensselaer Polytechnic Institute. All rights reserved.
+
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sys/mman.h>
+#endif
+#include "mds.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pcu_util.h>
+#include <reel.h>
+
+/* Entity-indexed MDS arrays come from one of two backends, chosen
+   by the storage the caller passes in (the storage of the mesh that
+   owns the array).
+
+   MDS_HEAP arrays are plain malloc'ed blocks that grow by realloc,
+   which may copy the whole array and briefly hold both copies
+   (glibc remaps large blocks instead).
+
+   MDS_PAGED arrays each reserve a range of address space when they
+   are created (mds_paged_reservation bytes), with no access and no
+   memory behind it. Growing makes more of the range writable, so
+   the array does not move, its data is never copied, and pages only
+   become resident once they are touched. Shrinking gives the pages
+   past the new end back to the system. An array that outgrows its
+   range is remapped into one twice as large as it needs, which
+   moves it once without copying. The first bytes of each range
+   remember its size. */
+
+size_t mds_paged_reservation = (size_t)1 << 32;
+
+static void fail(void)
+{
+  reel_fail("MDS ran out of memory!\n");
+}
+
+static void* heap_resize(void* p, size_t bytes)
+{
+  p = realloc(p, bytes);
+  if (!p)
+    fail();
+  return p;
+}
+
+#ifdef __linux__
+
+#include <unistd.h>
+
+/* fresh mappings are already zero */
+#define PAGED_IS_ZERO 1
+
+/* keeps the array as aligned as malloc would */
+#define PAGED_HEADER 64
+
+static size_t round_to_pages(size_t bytes)
+{
+  size_t page = sysconf(_SC_PAGESIZE);
+  return ((bytes + page - 1) / page) * page;
+}
+
+static size_t* paged_base(void* p)
+{
+  return (size_t*)((char*)p - PAGED_HEADER);
+}
+
+static size_t* paged_reserve(size_t reserved)
+{
+  void* base;
+  base = mmap(NULL, reserved, PROT_NONE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED)
+    fail();
+  return base;
+}
+
+/* the whole range is writable before this, which makes it one
+   mapping that mremap can take */
+static size_t* paged_move(size_t* base, size_t reserved, size_t used)
+{
+  size_t grown;
+  void* moved;
+  grown = round_to_pages(2 * used);
+  moved = mremap(base, reserved, grown, MREMAP_MAYMOVE);
+  if (moved == MAP_FAILED)
+    fail();
+  base = moved;
+  *base = grown;
+  return base;
+}
+
+static void* paged_resize(void* p, size_t bytes)
+{
+  size_t* base;
+  size_t reserved;
+  size_t used;
+  used = round_to_pages(bytes + PAGED_HEADER);
+  if (!p) {
+    reserved = round_to_pages(mds_paged_reservation);
+    if (reserved < used)
+      reserved = round_to_pages(2 * used);
+    base = paged_reserve(reserved);
+    if (mprotect(base, used, PROT_READ | PROT_WRITE))
+      fail();
+    *base = reserved;
+    return (char*)base + PAGED_HEADER;
+  }
+  base = paged_base(p);
+  reserved = *base;
+  if (used > reserved) {
+    if (mprotect(base, reserved, PROT_READ | PROT_WRITE))
+      fail();
+    base = paged_move(base, reserved, used);
+    reserved = *base;
+  }
+  if (mprotect(base, used, PROT_READ | PROT_WRITE))
+    fail();
+  if (used < reserved) {
+    /* releases any pages a larger size had touched,
+       this is cheap over the parts that were never touched */
+    madvise((char*)base + used, reserved - used, MADV_DONTNEED);
+    mprotect((char*)base + used, reserved - used, PROT_NONE);
+  }
+  return (char*)base + PAGED_HEADER;
+}
+
+static void paged_free(void* p)
+{
+  size_t* base = paged_base(p);
+  munmap(base, *base);
+}
+
+#else
+
+/* without reserving address space there is no way to grow
+   in place, so paged arrays fall back to the heap */
+#define PAGED_IS_ZERO 0
+
+static void* paged_resize(void* p, size_t bytes)
+{
+  return heap_resize(p, bytes);
+}
+
+static void paged_free(void* p)
+{
+  free(p);
+}
+
+#endif
+
+void* mds_resize_array(void* p, size_t bytes, int storage)
+{
+  if (!bytes) {
+    mds_free_array(p, storage);
+    return NULL;
+  }
+  if (storage != MDS_PAGED)
+    return heap_resize(p, bytes);
+  return paged_resize(p, bytes);
+}
+
+void* mds_calloc_array(size_t bytes, int storage)
+{
+  void* p;
+  p = mds_resize_array(NULL, bytes, storage);
+  if (p && !(storage == MDS_PAGED && PAGED_IS_ZERO))
+    memset(p, 0, bytes);
+  return p;
+}
+
+void mds_free_array(void* p, int storage)
+{
+  if (!p)
+    return;
+  if (storage != MDS_PAGED)
+    free(p);
+  else
+    paged_free(p);
+}
+
+void* mds_move_array(void* p, size_t bytes, int from, int to)
+{
+  void* q;
+  if (!p || from == to)
+    return p;
+  q = mds_resize_array(NULL, bytes, to);
+  if (q)
+    memcpy(q, p, bytes);
+  mds_free_array(p, from);
+  return q;
+}
@@ -10,6 +10,7 @@
 
 #include "mds_apf.h"
 #include <stdlib.h>
+#include <string.h>
 #include <pcu_util.h>
 #include <PCU.h>
 
@@ -23,13 +24,17 @@ struct mds_apf* mds_apf_create(struct gmi_model* model, int d,
   m = malloc(sizeof(*m));
   mds_create(&(m->mds),d,cap);
   mds_create_tags(&(m->tags));
-  m->point = malloc(cap[MDS_VERTEX] * sizeof(*(m->point)));
-  m->param = malloc(cap[MDS_VERTEX] * sizeof(*(m->param)));
+  m->point = mds_resize_array(NULL,
+      cap[MDS_VERTEX] * sizeof(*(m->point)), MDS_HEAP);
+  m->param = mds_resize_array(NULL,
+      cap[MDS_VERTEX] * sizeof(*(m->param)), MDS_HEAP);
   for (t = 0; t < MDS_TYPES; ++t)
-    m->model[t] = malloc(cap[t] * sizeof(*(m->model[t])));
+    m->model[t] = mds_resize_array(NULL,
+        cap[t] * sizeof(*(m->model[t])), MDS_HEAP);
   m->user_model = model;
   for (t = 0; t < MDS_TYPES; ++t)
-    m->parts[t] = calloc(cap[t], sizeof(*(m->parts[t])));
+    m->parts[t] = mds_calloc_array(
+        cap[t] * sizeof(*(m->parts[t])), MDS_HEAP);
   mds_create_net(&m->remotes);
 //seol
   mds_create_net(&m->ghosts);
@@ -45,16 +50,39 @@ void mds_apf_destroy(struct mds_apf* m)
   mds_destroy_net(&m->ghosts, &m->mds);
   mds_destroy_net(&m->remotes, &m->mds);
   for (t = 0; t < MDS_TYPES; ++t)
-    free(m->model[t]);
+    mds_free_array(m->model[t], m->mds.storage);
   for (t = 0; t < MDS_TYPES; ++t)
-    free(m->parts[t]);
-  free(m->point);
-  free(m->param);
-  mds_destroy_tags(&(m->tags));
+    mds_free_array(m->parts[t], m->mds.storage);
+  mds_free_array(m->point, m->mds.storage);
+  mds_free_array(m->param, m->mds.storage);
+  mds_destroy_tags(&(m->tags), &(m->mds));
   mds_destroy(&(m->mds));
   free(m);
 }
 
+void mds_apf_set_storage(struct mds_apf* m, int storage)
+{
+  int t;
+  mds_id* cap = m->mds.cap;
+  int from = m->mds.storage;
+  m->point = mds_move_array(m->point,
+      cap[MDS_VERTEX] * sizeof(*(m->point)), from, storage);
+  m->param = mds_move_array(m->param,
+      cap[MDS_VERTEX] * sizeof(*(m->param)), from, storage);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    m->model[t] = mds_move_array(m->model[t],
+        cap[t] * sizeof(*(m->model[t])), from, storage);
+    m->parts[t] = mds_move_array(m->parts[t],
+        cap[t] * sizeof(*(m->parts[t])), from, storage);
+  }
+  mds_move_tags(&m->tags, &m->mds, storage);
+  mds_move_net(&m->remotes, &m->mds, storage);
+  mds_move_net(&m->ghosts, &m->mds, storage);
+  mds_move_net(&m->matches, &m->mds, storage);
+  /* last, the arrays above are moved away from the old storage */
+  mds_set_storage(&m->mds, storage);
+}
+
 double* mds_apf_point(struct mds_apf* m, mds_id e)
 {
   return m->point[mds_index(e)];
@@ -91,13 +119,15 @@ mds_id mds_apf_create_entity(
         old_cap[t] = m->mds.cap[t];
     mds_grow_tags(&(m->tags),&(m->mds),old_cap);
     if (type == MDS_VERTEX) {
-      m->point = realloc(m->point,m->mds.cap[type] * sizeof(*(m->point)));
-      m->param = realloc(m->param,m->mds.cap[type] * sizeof(*(m->param)));
+      m->point = mds_resize_array(m->point,
+          m->mds.cap[type] * sizeof(*(m->point)), m->mds.storage);
+      m->param = mds_resize_array(m->param,
+          m->mds.cap[type] * sizeof(*(m->param)), m->mds.storage);
     }
-    m->model[type] = realloc(m->model[type],
-        m->mds.cap[type] * sizeof(*(m->model[type])));
-    m->parts[type] = realloc(m->parts[type],
-        m->mds.cap[type] * sizeof(*(m->parts[type])));
+    m->model[type] = mds_resize_array(m->model[type],
+        m->mds.cap[type] * sizeof(*(m->model[type])), m->mds.storage);
+    m->parts[type] = mds_resize_array(m->parts[type],
+        m->mds.cap[type] * sizeof(*(m->parts[type])), m->mds.storage);
     mds_grow_net(&m->remotes, &m->mds, old_cap); 
     mds_grow_net(&m->ghosts, &m->mds, old_cap); //seol
     mds_grow_net(&m->matches, &m->mds, old_cap);
@@ -116,7 +146,7 @@ void mds_apf_destroy_entity(struct mds_apf* m, mds_id e)
   struct mds_tag* t;
   for (t = m->tags.first; t; t = t->next)
     if (mds_has_tag(t,e))
-      mds_take_tag(t,e);
+      mds_take_tag(t,&m->mds,e);
   mds_set_copies(&m->remotes, &m->mds, e, NULL);
   mds_set_copies(&m->ghosts, &m->mds, e, NULL); //seol
   mds_set_copies(&m->matches, &m->mds, e, NULL);
@@ -346,3 +376,32 @@ void mds_derive_model(struct mds_apf* m)
     }
   }
 }
+
+void mds_apf_memory(struct mds_apf* m, struct mds_memory* mem)
+{
+  int t;
+  mds_id n;
+  memset(mem, 0, sizeof(*mem));
+  mds_measure(&m->mds, mem);
+  n = m->mds.n[MDS_VERTEX];
+  if (m->point)
+    mem->allocated[MDS_MEM_COORDINATES][MDS_VERTEX] = m->mds.cap[MDS_VERTEX] *
+      (sizeof(*(m->point)) + sizeof(*(m->param)));
+  mem->live[MDS_MEM_COORDINATES][MDS_VERTEX] =
+    n * (sizeof(*(m->point)) + sizeof(*(m->param)));
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (m->model[t])
+      mem->allocated[MDS_MEM_CLASSIFICATION][t] = m->mds.cap[t] *
+        (sizeof(*(m->model[t])) + sizeof(*(m->parts[t])));
+    mem->live[MDS_MEM_CLASSIFICATION][t] = m->mds.n[t] *
+      (sizeof(*(m->model[t])) + sizeof(*(m->parts[t])));
+  }
+  mds_tags_memory(&m->tags, &m->mds, mem->allocated[MDS_MEM_TAGS],
+      mem->live[MDS_MEM_TAGS]);
+  mds_net_memory(&m->remotes, &m->mds, mem->allocated[MDS_MEM_REMOTES],
+      mem->live[MDS_MEM_REMOTES]);
+  mds_net_memory(&m->ghosts, &m->mds, mem->allocated[MDS_MEM_GHOSTS],
+      mem->live[MDS_MEM_GHOSTS]);
+  mds_net_memory(&m->matches, &m->mds, mem->allocated[MDS_MEM_MATCHES],
+      mem->live[MDS_MEM_MATCHES]);
+}
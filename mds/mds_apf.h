@@ -43,6 +43,8 @@ struct mds_apf {
 struct mds_apf* mds_apf_create(struct gmi_model* model, int d,
     mds_id cap[MDS_TYPES]);
 void mds_apf_destroy(struct mds_apf* m);
+void mds_apf_memory(struct mds_apf* m, struct mds_memory* mem);
+void mds_apf_set_storage(struct mds_apf* m, int storage);
 double* mds_apf_point(struct mds_apf* m, mds_id e);
 double* mds_apf_param(struct mds_apf* m, mds_id e);
 struct gmi_ent* mds_apf_model(struct mds_apf* m, mds_id e);
@@ -54,18 +56,44 @@ void mds_apf_destroy_entity(struct mds_apf* m, mds_id e);
 void* mds_get_part(struct mds_apf* m, mds_id e);
 void mds_set_part(struct mds_apf* m, mds_id e, void* p);
 
+enum {
+  MDS_HILBERT,
+  MDS_MORTON
+};
+
 struct mds_tag* mds_number_verts_bfs(struct mds_apf* m);
+struct mds_tag* mds_number_verts_rcm(struct mds_apf* m);
+struct mds_tag* mds_number_verts_sfc(struct mds_apf* m, int curve);
+void mds_number_elems_sfc(struct mds_apf* m, struct mds_tag* tag, int curve);
 struct mds_apf* mds_reorder(struct mds_apf* m, int ignore_peers,
     struct mds_tag* vert_numbers);
+/* like mds_reorder, but the elements already carry their numbers
+   from mds_number_elems_sfc and only the rest are derived */
+struct mds_apf* mds_reorder_elems(struct mds_apf* m, int ignore_peers,
+    struct mds_tag* numbers);
+void mds_compact(struct mds_apf* m);
 
 struct gmi_ent* mds_find_model(struct mds_apf* m, int dim, int id);
 int mds_model_dim(struct mds_apf* m, struct gmi_ent* model);
 int mds_model_id(struct mds_apf* m, struct gmi_ent* model);
 
+/* keep_tags is a NULL-terminated list of the names of tags to load,
+   the data of all other tags is skipped. NULL loads every tag */
 struct mds_apf* mds_read_smb(struct gmi_model* model, const char* pathname,
-    int ignore_peers, void* apf_mesh);
+    int ignore_peers, const char* const* keep_tags, void* apf_mesh);
+/* version is the SMB version to write, 5 or 6 */
 struct mds_apf* mds_write_smb(struct mds_apf* m, const char* pathname,
-    int ignore_peers, void* apf_mesh);
+    int ignore_peers, int version, void* apf_mesh);
+/* fails unless version is one mds_write_smb can write */
+void mds_check_smb_version(int version);
+/* the archive "name.smba" packs the SMB data of all parts into
+   the files nameN.smba, written and read collectively with MPI-IO.
+   Reading requires as many ranks as there were parts */
+struct mds_apf* mds_write_smb_archive(struct mds_apf* m, const char* pathname,
+    int files, int version, void* apf_mesh);
+struct mds_apf* mds_read_smb_archive(struct gmi_model* model,
+    const char* pathname, void* apf_mesh);
+int mds_count_smb_archive(const char* pathname);
 
 void mds_verify(struct mds_apf* m);
 void mds_verify_residence(struct mds_apf* m, mds_id e);
@@ -0,0 +1,330 @@
+/******************************************************************************
+
+  Copyright 2014 Scientific Computation Research Center,
+      Rensselaer Polytechnic Institute. All rights reserved.
+
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+
+#include "mds_apf.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pcu_util.h>
+#include <PCU.h>
+
+/* In-place alternative to mds_reorder's rebuild:
+   live entities keep their relative order and slide down
+   over the holes, so every new index is at most the old one.
+   Processing old indices in increasing order then lets every
+   array be permuted within its own allocation, after which
+   the allocations are shrunk to the live entity counts.
+   The new index of every old one is kept in new_of[type],
+   which is passed down to each step. */
+
+static void number_live(struct mds* m, mds_id* new_of[MDS_TYPES])
+{
+  int t;
+  mds_id i;
+  mds_id j;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    new_of[t] = malloc(m->end[t] * sizeof(mds_id));
+    j = 0;
+    for (i = 0; i < m->end[t]; ++i)
+      if (m->free[t][i] == MDS_LIVE)
+        new_of[t][i] = j++;
+      else
+        new_of[t][i] = MDS_NONE;
+    PCU_ALWAYS_ASSERT(j == m->n[t]);
+  }
+}
+
+static void free_numbers(mds_id* new_of[MDS_TYPES])
+{
+  int t;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    free(new_of[t]);
+    new_of[t] = NULL;
+  }
+}
+
+static mds_id map_ent(mds_id* new_of[MDS_TYPES], mds_id e)
+{
+  if (e == MDS_NONE)
+    return e;
+  return mds_identify(mds_type(e), new_of[mds_type(e)][mds_index(e)]);
+}
+
+/* up-list nodes are identified by (up entity index * degree + slot) */
+static mds_id map_node(mds_id* new_of[MDS_TYPES], mds_id node, int dim)
+{
+  int t;
+  int deg;
+  mds_id i;
+  if (node == MDS_NONE)
+    return node;
+  t = mds_type(node);
+  deg = mds_degree[t][dim];
+  i = mds_index(node);
+  return mds_identify(t, new_of[t][i / deg] * deg + i % deg);
+}
+
+static void move_slots(mds_id* new_of[MDS_TYPES], void* a, size_t bytes,
+    int t, mds_id end)
+{
+  char* p = a;
+  mds_id i;
+  mds_id j;
+  if (!p)
+    return;
+  for (i = 0; i < end; ++i) {
+    j = new_of[t][i];
+    if (j != MDS_NONE && j != i)
+      memcpy(p + j * bytes, p + i * bytes, bytes);
+  }
+}
+
+static void move_bits(mds_id* new_of[MDS_TYPES], unsigned char* has,
+    int t, mds_id end)
+{
+  mds_id i;
+  mds_id j;
+  int bit;
+  if (!has)
+    return;
+  for (i = 0; i < end; ++i) {
+    j = new_of[t][i];
+    if (j == MDS_NONE)
+      continue;
+    bit = (has[i / 8] >> (i % 8)) & 1;
+    has[j / 8] &= ~(1 << (j % 8));
+    has[j / 8] |= (bit << (j % 8));
+  }
+  for (i = j = 0; i < end; ++i)
+    if (new_of[t][i] != MDS_NONE)
+      ++j;
+  for (i = j; i < end; ++i)
+    has[i / 8] &= ~(1 << (i % 8));
+}
+
+static void compact_down(struct mds* m, mds_id* new_of[MDS_TYPES],
+    int from, int to)
+{
+  int t;
+  int deg;
+  mds_id i;
+  mds_id* a;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (mds_dim[t] != from)
+      continue;
+    deg = mds_degree[t][to];
+    a = m->down[to][t];
+    move_slots(new_of, a, deg * sizeof(mds_id), t, m->end[t]);
+    for (i = 0; i < m->n[t] * deg; ++i)
+      a[i] = map_ent(new_of, a[i]);
+  }
+}
+
+static void compact_up(struct mds* m, mds_id* new_of[MDS_TYPES],
+    int from, int to)
+{
+  int t;
+  int deg;
+  mds_id i;
+  mds_id* a;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (mds_dim[t] == to) {
+      deg = mds_degree[t][from];
+      a = m->up[from][t];
+      move_slots(new_of, a, deg * sizeof(mds_id), t, m->end[t]);
+      for (i = 0; i < m->n[t] * deg; ++i)
+        a[i] = map_node(new_of, a[i], from);
+    } else if (mds_dim[t] == from) {
+      a = m->first_up[to][t];
+      move_slots(new_of, a, sizeof(mds_id), t, m->end[t]);
+      for (i = 0; i < m->n[t]; ++i)
+        a[i] = map_node(new_of, a[i], from);
+    }
+  }
+}
+
+static void compact_topology(struct mds* m, mds_id* new_of[MDS_TYPES])
+{
+  int i, j;
+  int t;
+  mds_id k;
+  for (i = 0; i <= 3; ++i)
+  for (j = 0; j <= 3; ++j)
+    if (m->mrm[i][j]) {
+      if (i < j)
+        compact_up(m, new_of, i, j);
+      else
+        compact_down(m, new_of, i, j);
+    }
+  for (t = 0; t < MDS_TYPES; ++t) {
+    for (k = 0; k < m->n[t]; ++k)
+      m->free[t][k] = MDS_LIVE;
+    m->end[t] = m->n[t];
+    m->first_free[t] = MDS_NONE;
+  }
+}
+
+static void compact_tags(struct mds_tags* ts, struct mds* m,
+    mds_id* new_of[MDS_TYPES])
+{
+  struct mds_tag* tag;
+  int t;
+  for (tag = ts->first; tag; tag = tag->next)
+    for (t = 0; t < MDS_TYPES; ++t) {
+      move_slots(new_of, tag->data[t], tag->bytes, t, m->end[t]);
+      move_bits(new_of, tag->has[t], t, m->end[t]);
+    }
+  for (t = 0; t < MDS_TYPES; ++t)
+    mds_renumber_sparse_tags(ts, t, new_of[t]);
+}
+
+static void compact_net(struct mds_net* net, struct mds* m,
+    mds_id* new_of[MDS_TYPES])
+{
+  int t;
+  mds_id i;
+  mds_id j;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (!net->data[t])
+      continue;
+    for (i = 0; i < m->end[t]; ++i) {
+      j = new_of[t][i];
+      if (j == MDS_NONE || j == i)
+        continue;
+      net->data[t][j] = net->data[t][i];
+      net->data[t][i] = NULL;
+    }
+  }
+}
+
+/* updated copies are temporarily encoded as negative ids
+   so that one copy is never matched by two messages */
+static mds_id hide(mds_id e)
+{
+  return -e - 2;
+}
+
+static void recv_peer_ids(struct mds_net* net)
+{
+  mds_id e;
+  mds_id old_e;
+  mds_id new_e;
+  struct mds_copies* cs;
+  int from;
+  int i;
+  from = PCU_Comm_Sender();
+  PCU_COMM_UNPACK(e);
+  PCU_COMM_UNPACK(old_e);
+  PCU_COMM_UNPACK(new_e);
+  cs = mds_get_copies(net, e);
+  PCU_ALWAYS_ASSERT(cs);
+  for (i = 0; i < cs->n; ++i)
+    if (cs->c[i].p == from && cs->c[i].e == old_e) {
+      cs->c[i].e = hide(new_e);
+      return;
+    }
+  abort();
+}
+
+static void update_peer_ids(struct mds_net* net, struct mds* m,
+    mds_id* new_of[MDS_TYPES])
+{
+  int t;
+  mds_id i;
+  mds_id e;
+  mds_id ne;
+  int j;
+  struct mds_copies* cs;
+  PCU_Comm_Begin();
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (!net->data[t])
+      continue;
+    for (i = 0; i < m->end[t]; ++i) {
+      cs = net->data[t][i];
+      if (!cs)
+        continue;
+      e = mds_identify(t, i);
+      ne = map_ent(new_of, e);
+      for (j = 0; j < cs->n; ++j) {
+        PCU_COMM_PACK(cs->c[j].p, cs->c[j].e);
+        PCU_COMM_PACK(cs->c[j].p, e);
+        PCU_COMM_PACK(cs->c[j].p, ne);
+      }
+    }
+  }
+  PCU_Comm_Send();
+  while (PCU_Comm_Receive())
+    recv_peer_ids(net);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (!net->data[t])
+      continue;
+    for (i = 0; i < m->end[t]; ++i) {
+      cs = net->data[t][i];
+      if (!cs)
+        continue;
+      for (j = 0; j < cs->n; ++j) {
+        PCU_ALWAYS_ASSERT(cs->c[j].e < MDS_NONE);
+        cs->c[j].e = hide(cs->c[j].e);
+      }
+    }
+  }
+}
+
+static void shrink_apf(struct mds_apf* m, mds_id old_cap[MDS_TYPES])
+{
+  int t;
+  mds_id* cap = m->mds.cap;
+  int s = m->mds.storage;
+  m->point = mds_resize_array(m->point,
+      cap[MDS_VERTEX] * sizeof(*(m->point)), s);
+  m->param = mds_resize_array(m->param,
+      cap[MDS_VERTEX] * sizeof(*(m->param)), s);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    m->model[t] = mds_resize_array(m->model[t],
+        cap[t] * sizeof(*(m->model[t])), s);
+    m->parts[t] = mds_resize_array(m->parts[t],
+        cap[t] * sizeof(*(m->parts[t])), s);
+  }
+  mds_grow_tags(&m->tags, &m->mds, old_cap);
+  mds_grow_net(&m->remotes, &m->mds, old_cap);
+  mds_grow_net(&m->ghosts, &m->mds, old_cap);
+  mds_grow_net(&m->matches, &m->mds, old_cap);
+}
+
+void mds_compact(struct mds_apf* m)
+{
+  struct mds* mds = &m->mds;
+  mds_id* end = mds->end;
+  mds_id* new_of[MDS_TYPES];
+  mds_id old_cap[MDS_TYPES];
+  int t;
+  mds_thaw(mds);
+  number_live(mds, new_of);
+  update_peer_ids(&m->remotes, mds, new_of);
+  update_peer_ids(&m->ghosts, mds, new_of);
+  update_peer_ids(&m->matches, mds, new_of);
+  move_slots(new_of, m->point, sizeof(*(m->point)),
+      MDS_VERTEX, end[MDS_VERTEX]);
+  move_slots(new_of, m->param, sizeof(*(m->param)),
+      MDS_VERTEX, end[MDS_VERTEX]);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    move_slots(new_of, m->model[t], sizeof(*(m->model[t])), t, end[t]);
+    move_slots(new_of, m->parts[t], sizeof(*(m->parts[t])), t, end[t]);
+  }
+  compact_tags(&m->tags, mds, new_of);
+  compact_net(&m->remotes, mds, new_of);
+  compact_net(&m->ghosts, mds, new_of);
+  compact_net(&m->matches, mds, new_of);
+  compact_topology(mds, new_of);
+  free_numbers(new_of);
+  for (t = 0; t < MDS_TYPES; ++t)
+    old_cap[t] = mds->cap[t];
+  mds_shrink(mds);
+  shrink_apf(m, old_cap);
+}
@@ -0,0 +1,179 @@
+/******************************************************************************
+
+  Copyright 2014 Scientific Computation Research Center,
+      Rensselaer Polytechnic Institute. All rights reserved.
+
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+
+#include "mds.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pcu_util.h>
+#include <reel.h>
+
+/* compressed sparse row snapshot of one adjacency pair.
+   for an entity of type t and index i, its adjacent
+   entities are adj[t][offset[t][i]] through adj[t][offset[t][i + 1] - 1].
+   dead entities have an empty range. */
+struct mds_csr {
+  mds_id* offset[MDS_TYPES];
+  mds_id* adj[MDS_TYPES];
+};
+
+struct mds_frozen {
+  struct mds_csr* csr[4][4];
+  size_t bytes;
+};
+
+static void* csr_malloc(size_t n)
+{
+  void* p;
+  if (!n)
+    return NULL;
+  p = malloc(n);
+  if (!p)
+    reel_fail("MDS ran out of memory while freezing adjacencies!\n");
+  return p;
+}
+
+static int is_live(struct mds* m, int t, mds_id i)
+{
+  return m->free[t][i] == MDS_LIVE;
+}
+
+static size_t build_type(struct mds* m, struct mds_csr* c,
+    int t, int to_dim)
+{
+  mds_id i;
+  mds_id k;
+  int j;
+  struct mds_set s;
+  mds_id* off;
+  off = csr_malloc((m->end[t] + 1) * sizeof(mds_id));
+  off[0] = 0;
+  for (i = 0; i < m->end[t]; ++i) {
+    off[i + 1] = off[i];
+    if (!is_live(m, t, i))
+      continue;
+    mds_get_adjacent(m, mds_identify(t, i), to_dim, &s);
+    off[i + 1] += s.n;
+  }
+  c->offset[t] = off;
+  c->adj[t] = csr_malloc(off[m->end[t]] * sizeof(mds_id));
+  for (i = 0; i < m->end[t]; ++i) {
+    if (!is_live(m, t, i))
+      continue;
+    mds_get_adjacent(m, mds_identify(t, i), to_dim, &s);
+    k = off[i];
+    for (j = 0; j < s.n; ++j)
+      c->adj[t][k + j] = s.e[j];
+  }
+  return (m->end[t] + 1 + off[m->end[t]]) * sizeof(mds_id);
+}
+
+static void free_csr(struct mds_csr* c)
+{
+  int t;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    free(c->offset[t]);
+    free(c->adj[t]);
+  }
+  free(c);
+}
+
+size_t mds_freeze(struct mds* m, int from_dim, int to_dim)
+{
+  struct mds_csr* c;
+  int t;
+  size_t bytes;
+  PCU_ALWAYS_ASSERT(0 <= from_dim && from_dim <= m->d);
+  PCU_ALWAYS_ASSERT(0 <= to_dim && to_dim <= m->d);
+  if (from_dim == to_dim)
+    return 0;
+  if (mds_is_frozen(m, from_dim, to_dim))
+    return 0;
+  if (!m->frozen) {
+    m->frozen = csr_malloc(sizeof(*(m->frozen)));
+    memset(m->frozen, 0, sizeof(*(m->frozen)));
+  }
+  c = csr_malloc(sizeof(*c));
+  memset(c, 0, sizeof(*c));
+  bytes = sizeof(*c);
+  for (t = 0; t < MDS_TYPES; ++t)
+    if (mds_dim[t] == from_dim)
+      bytes += build_type(m, c, t, to_dim);
+  /* only publish the snapshot once it is complete,
+     since building it goes through mds_get_adjacent */
+  m->frozen->csr[from_dim][to_dim] = c;
+  m->frozen->bytes += bytes;
+  return bytes;
+}
+
+void mds_thaw(struct mds* m)
+{
+  int i, j;
+  if (!m->frozen)
+    return;
+  for (i = 0; i < 4; ++i)
+  for (j = 0; j < 4; ++j)
+    if (m->frozen->csr[i][j])
+      free_csr(m->frozen->csr[i][j]);
+  free(m->frozen);
+  m->frozen = NULL;
+}
+
+int mds_is_frozen(struct mds* m, int from_dim, int to_dim)
+{
+  return m->frozen && m->frozen->csr[from_dim][to_dim];
+}
+
+size_t mds_frozen_bytes(struct mds* m)
+{
+  if (!m->frozen)
+    return 0;
+  return m->frozen->bytes + sizeof(*(m->frozen));
+}
+
+/* adds the bytes of the snapshots of each type's adjacencies */
+void mds_frozen_memory(struct mds* m, size_t bytes[MDS_TYPES])
+{
+  int i, j;
+  int t;
+  struct mds_csr* c;
+  if (!m->frozen)
+    return;
+  for (i = 0; i < 4; ++i)
+  for (j = 0; j < 4; ++j) {
+    c = m->frozen->csr[i][j];
+    if (!c)
+      continue;
+    for (t = 0; t < MDS_TYPES; ++t)
+      if (c->offset[t])
+        bytes[t] += (m->end[t] + 1 + c->offset[t][m->end[t]])
+          * sizeof(mds_id);
+  }
+}
+
+int mds_get_frozen(struct mds* m, mds_id e, int d, struct mds_set* s)
+{
+  struct mds_csr* c;
+  int t;
+  mds_id i;
+  mds_id* first;
+  mds_id n;
+  int j;
+  t = mds_type(e);
+  c = m->frozen->csr[mds_dim[t]][d];
+  if (!c)
+    return 0;
+  i = mds_index(e);
+  first = c->adj[t] + c->offset[t][i];
+  n = c->offset[t][i + 1] - c->offset[t][i];
+  s->n = n;
+  for (j = 0; j < n; ++j)
+    s->e[j] = first[j];
+  return 1;
+}
@@ -27,7 +27,7 @@ void mds_destroy_net(struct mds_net* net, struct mds* m)
     if (net->data[t])
       for (i = 0; i < m->cap[t]; ++i)
         free(net->data[t][i]);
-    free(net->data[t]);
+    mds_free_array(net->data[t], m->storage);
   }
 }
 
@@ -49,7 +49,8 @@ void mds_set_copies(struct mds_net* net, struct mds* m, mds_id e,
   i = mds_index(e);
   if (!net->data[t]) {
     if (c)
-      net->data[t] = calloc(m->cap[t], sizeof(*(net->data[t])));
+      net->data[t] = mds_calloc_array(
+          m->cap[t] * sizeof(*(net->data[t])), m->storage);
     else
       return;
   }
@@ -62,7 +63,7 @@ void mds_set_copies(struct mds_net* net, struct mds* m, mds_id e,
   free(*p);
   *p = c;
   if (!net->n[t]) {
-    free(net->data[t]);
+    mds_free_array(net->data[t], m->storage);
     net->data[t] = NULL;
   }
 }
@@ -84,13 +85,21 @@ void mds_grow_net(
   mds_id i;
   for (t = 0; t < MDS_TYPES; ++t)
     if (net->data[t]) {
-      net->data[t] = realloc(net->data[t],
-          m->cap[t] * sizeof(struct mds_copies*));
+      net->data[t] = mds_resize_array(net->data[t],
+          m->cap[t] * sizeof(struct mds_copies*), m->storage);
       for (i = old_cap[t]; i < m->cap[t]; ++i)
         net->data[t][i] = NULL;
     }
 }
 
+void mds_move_net(struct mds_net* net, struct mds* m, int storage)
+{
+  int t;
+  for (t = 0; t < MDS_TYPES; ++t)
+    net->data[t] = mds_move_array(net->data[t],
+        m->cap[t] * sizeof(struct mds_copies*), m->storage, storage);
+}
+
 static int find_place(struct mds_copies* cs, int p)
 {
   int i;
@@ -280,6 +289,29 @@ void mds_free_links(struct mds_links* ln)
   free(ln->l);
 }
 
+void mds_net_memory(struct mds_net* net, struct mds* m,
+    size_t allocated[MDS_TYPES], size_t live[MDS_TYPES])
+{
+  int t;
+  mds_id i;
+  struct mds_copies* c;
+  size_t bytes;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (!net->data[t])
+      continue;
+    allocated[t] += m->cap[t] * sizeof(struct mds_copies*);
+    live[t] += net->n[t] * sizeof(struct mds_copies*);
+    for (i = 0; i < m->end[t]; ++i) {
+      c = net->data[t][i];
+      if (!c)
+        continue;
+      bytes = sizeof(struct mds_copies) + (c->n - 1) * sizeof(struct mds_copy);
+      allocated[t] += bytes;
+      live[t] += bytes;
+    }
+  }
+}
+
 int mds_net_empty(struct mds_net* net)
 {
   int t;
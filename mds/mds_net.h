@@ -46,6 +46,7 @@ void mds_grow_net(
     struct mds_net* net,
     struct mds* m,
     mds_id old_cap[MDS_TYPES]);
+void mds_move_net(struct mds_net* net, struct mds* m, int storage);
 
 void mds_add_copy(struct mds_net* net, struct mds* m, mds_id e,
     struct mds_copy c);
@@ -57,6 +58,8 @@ void mds_set_type_links(struct mds_net* net, struct mds* m,
 void mds_free_links(struct mds_links* ln);
 
 int mds_net_empty(struct mds_net* net);
+void mds_net_memory(struct mds_net* net, struct mds* m,
+    size_t allocated[MDS_TYPES], size_t live[MDS_TYPES]);
 
 void mds_get_local_matches(struct mds_net* net, struct mds* m,
                          int t, struct mds_links* ln);
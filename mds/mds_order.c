@@ -134,6 +134,328 @@ struct mds_tag* mds_number_verts_bfs(struct mds_apf* m)
   return tag;
 }
 
+static int vert_degree(struct mds* m, mds_id v)
+{
+  struct mds_set edges;
+  mds_get_adjacent(m, v, 1, &edges);
+  return edges.n;
+}
+
+/* breadth-first search over the vertices not yet ordered,
+   returning the lowest degree vertex in the last level
+   and the number of levels */
+static mds_id last_level(struct mds* m, mds_id v, char* ordered,
+    int* level, mds_id* q, int* levels)
+{
+  mds_id first, end, i;
+  mds_id best;
+  int best_deg, deg;
+  int j;
+  struct mds_set adj;
+  mds_id u;
+  q[0] = v;
+  level[mds_index(v)] = 0;
+  first = 0;
+  end = 1;
+  while (first < end) {
+    v = q[first++];
+    mds_get_adjacent(m, v, 1, &adj);
+    for (j = 0; j < adj.n; ++j) {
+      u = other_vert(m, adj.e[j], v);
+      if (ordered[mds_index(u)] || level[mds_index(u)] != -1)
+        continue;
+      level[mds_index(u)] = level[mds_index(v)] + 1;
+      q[end++] = u;
+    }
+  }
+  *levels = level[mds_index(q[end - 1])];
+  best = q[end - 1];
+  best_deg = vert_degree(m, best);
+  for (i = end - 1; i >= 0 && level[mds_index(q[i])] == *levels; --i) {
+    deg = vert_degree(m, q[i]);
+    if (deg < best_deg) {
+      best_deg = deg;
+      best = q[i];
+    }
+  }
+  for (i = 0; i < end; ++i)
+    level[mds_index(q[i])] = -1;
+  return best;
+}
+
+/* the George-Liu heuristic for a pseudo-peripheral vertex */
+static mds_id find_peripheral(struct mds* m, mds_id v, char* ordered,
+    int* level, mds_id* q)
+{
+  int levels = -1;
+  int next_levels;
+  mds_id u;
+  for (;;) {
+    u = last_level(m, v, ordered, level, q, &next_levels);
+    if (next_levels <= levels)
+      return v;
+    levels = next_levels;
+    v = u;
+  }
+}
+
+static void sort_by_degree(struct mds* m, mds_id* e, int n)
+{
+  int i, j;
+  int deg[MDS_SET_MAX];
+  int d;
+  mds_id x;
+  for (i = 0; i < n; ++i)
+    deg[i] = vert_degree(m, e[i]);
+  for (i = 1; i < n; ++i) {
+    x = e[i];
+    d = deg[i];
+    for (j = i; j > 0 && deg[j - 1] > d; --j) {
+      e[j] = e[j - 1];
+      deg[j] = deg[j - 1];
+    }
+    e[j] = x;
+    deg[j] = d;
+  }
+}
+
+/* appends the Cuthill-McKee order of the component containing v */
+static mds_id cuthill_mckee(struct mds* m, mds_id v, char* ordered,
+    mds_id* order, mds_id k)
+{
+  mds_id first;
+  struct mds_set adj;
+  struct mds_set next;
+  mds_id u;
+  int j;
+  ordered[mds_index(v)] = 1;
+  order[k++] = v;
+  for (first = k - 1; first < k; ++first) {
+    v = order[first];
+    mds_get_adjacent(m, v, 1, &adj);
+    next.n = 0;
+    for (j = 0; j < adj.n; ++j) {
+      u = other_vert(m, adj.e[j], v);
+      if (ordered[mds_index(u)])
+        continue;
+      ordered[mds_index(u)] = 1;
+      next.e[next.n++] = u;
+    }
+    sort_by_degree(m, next.e, next.n);
+    for (j = 0; j < next.n; ++j)
+      order[k++] = next.e[j];
+  }
+  return k;
+}
+
+struct mds_tag* mds_number_verts_rcm(struct mds_apf* m)
+{
+  struct mds_tag* tag;
+  mds_id nv;
+  mds_id cap;
+  mds_id i;
+  mds_id k;
+  mds_id v;
+  char* ordered;
+  int* level;
+  mds_id* q;
+  mds_id* order;
+  int* l;
+  PCU_ALWAYS_ASSERT(m->mds.n[MDS_VERTEX] < INT_MAX);
+  tag = mds_create_tag(&m->tags, "mds_number", sizeof(int), 1);
+  nv = m->mds.n[MDS_VERTEX];
+  cap = m->mds.end[MDS_VERTEX];
+  ordered = calloc(cap, 1);
+  level = malloc(cap * sizeof(int));
+  for (i = 0; i < cap; ++i)
+    level[i] = -1;
+  q = malloc(nv * sizeof(mds_id));
+  order = malloc(nv * sizeof(mds_id));
+  k = 0;
+  for (v = mds_begin(&m->mds, 0); v != MDS_NONE; v = mds_next(&m->mds, v))
+    if (!ordered[mds_index(v)])
+      k = cuthill_mckee(&m->mds,
+          find_peripheral(&m->mds, v, ordered, level, q),
+          ordered, order, k);
+  PCU_ALWAYS_ASSERT(k == nv);
+  for (i = 0; i < nv; ++i) {
+    mds_give_tag(tag, &m->mds, order[i]);
+    l = mds_get_tag(tag, order[i]);
+    *l = nv - 1 - i;
+  }
+  free(order);
+  free(q);
+  free(level);
+  free(ordered);
+  return tag;
+}
+
+typedef unsigned long long sfc_key;
+
+struct sfc_item {
+  sfc_key key;
+  mds_id e;
+};
+
+struct sfc_box {
+  int n;
+  int bits;
+  double min[3];
+  double scale;
+};
+
+static void make_sfc_box(struct mds_apf* m, struct sfc_box* b)
+{
+  mds_id v;
+  double max[3];
+  double* x;
+  double w;
+  int i;
+  b->n = m->mds.d < 1 ? 1 : m->mds.d;
+  b->bits = 63 / b->n;
+  if (b->bits > 31)
+    b->bits = 31;
+  for (i = 0; i < 3; ++i) {
+    b->min[i] = 0;
+    max[i] = 0;
+  }
+  v = mds_begin(&m->mds, 0);
+  if (v != MDS_NONE)
+    for (i = 0; i < 3; ++i)
+      b->min[i] = max[i] = mds_apf_point(m, v)[i];
+  for (; v != MDS_NONE; v = mds_next(&m->mds, v)) {
+    x = mds_apf_point(m, v);
+    for (i = 0; i < 3; ++i) {
+      if (x[i] < b->min[i])
+        b->min[i] = x[i];
+      if (x[i] > max[i])
+        max[i] = x[i];
+    }
+  }
+  w = 0;
+  for (i = 0; i < b->n; ++i)
+    if (max[i] - b->min[i] > w)
+      w = max[i] - b->min[i];
+  b->scale = w > 0 ? ((double)((1u << b->bits) - 1)) / w : 0;
+}
+
+/* J. Skilling, "Programming the Hilbert curve",
+   AIP Conference Proceedings 707, 2004 */
+static void hilbert_transpose(unsigned* x, int n, int bits)
+{
+  unsigned p, q, t;
+  int i;
+  for (q = 1u << (bits - 1); q > 1; q >>= 1) {
+    p = q - 1;
+    for (i = 0; i < n; ++i)
+      if (x[i] & q)
+        x[0] ^= p;
+      else {
+        t = (x[0] ^ x[i]) & p;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+  }
+  for (i = 1; i < n; ++i)
+    x[i] ^= x[i - 1];
+  t = 0;
+  for (q = 1u << (bits - 1); q > 1; q >>= 1)
+    if (x[n - 1] & q)
+      t ^= q - 1;
+  for (i = 0; i < n; ++i)
+    x[i] ^= t;
+}
+
+static sfc_key sfc_encode(struct sfc_box* b, double const* point, int curve)
+{
+  unsigned x[3];
+  sfc_key key;
+  int i, j;
+  for (i = 0; i < b->n; ++i)
+    x[i] = (unsigned)((point[i] - b->min[i]) * b->scale);
+  if (curve == MDS_HILBERT)
+    hilbert_transpose(x, b->n, b->bits);
+  key = 0;
+  for (j = b->bits - 1; j >= 0; --j)
+    for (i = 0; i < b->n; ++i)
+      key = (key << 1) | ((x[i] >> j) & 1);
+  return key;
+}
+
+static int compare_sfc(const void* a, const void* b)
+{
+  struct sfc_item const* x = a;
+  struct sfc_item const* y = b;
+  if (x->key != y->key)
+    return x->key < y->key ? -1 : 1;
+  return (x->e > y->e) - (x->e < y->e);
+}
+
+static void centroid(struct mds_apf* m, mds_id e, double* c)
+{
+  struct mds_set vs;
+  double* x;
+  int i, j;
+  mds_get_adjacent(&m->mds, e, 0, &vs);
+  c[0] = c[1] = c[2] = 0;
+  for (i = 0; i < vs.n; ++i) {
+    x = mds_apf_point(m, vs.e[i]);
+    for (j = 0; j < 3; ++j)
+      c[j] += x[j] / vs.n;
+  }
+}
+
+static void number_by_sfc(struct mds_apf* m, struct mds_tag* tag,
+    int dim, int curve)
+{
+  struct sfc_box b;
+  struct sfc_item* items;
+  mds_id n;
+  mds_id i;
+  mds_id e;
+  double c[3];
+  int label[MDS_TYPES] = {0};
+  int* l;
+  make_sfc_box(m, &b);
+  n = 0;
+  for (i = 0; i < MDS_TYPES; ++i)
+    if (mds_dim[i] == dim)
+      n += m->mds.n[i];
+  items = malloc(n * sizeof(*items));
+  n = 0;
+  for (e = mds_begin(&m->mds, dim); e != MDS_NONE;
+       e = mds_next(&m->mds, e)) {
+    centroid(m, e, c);
+    items[n].key = sfc_encode(&b, c, curve);
+    items[n].e = e;
+    ++n;
+  }
+  qsort(items, n, sizeof(*items), compare_sfc);
+  for (i = 0; i < n; ++i) {
+    e = items[i].e;
+    PCU_ALWAYS_ASSERT(label[mds_type(e)] < INT_MAX);
+    mds_give_tag(tag, &m->mds, e);
+    l = mds_get_tag(tag, e);
+    *l = label[mds_type(e)]++;
+  }
+  free(items);
+}
+
+struct mds_tag* mds_number_verts_sfc(struct mds_apf* m, int curve)
+{
+  struct mds_tag* tag;
+  PCU_ALWAYS_ASSERT(m->mds.n[MDS_VERTEX] < INT_MAX);
+  tag = mds_create_tag(&m->tags, "mds_number", sizeof(int), 1);
+  number_by_sfc(m, tag, 0, curve);
+  return tag;
+}
+
+void mds_number_elems_sfc(struct mds_apf* m, struct mds_tag* tag, int curve)
+{
+  if (m->mds.d > 0)
+    number_by_sfc(m, tag, m->mds.d, curve);
+}
+
 static mds_id* sort_verts(struct mds_apf* m, struct mds_tag* tag)
 {
   mds_id v;
@@ -165,13 +487,17 @@ static void number_ents_of_type(struct mds* m,
   }
 }
 
-static void number_other_ents(struct mds_apf* m, struct mds_tag* tag)
+/* entities of dimension skip_dim were numbered ahead of time
+   (see mds_number_elems_sfc), pass -1 to number all of them */
+static void number_other_ents(struct mds_apf* m, struct mds_tag* tag,
+    int skip_dim)
 {
   mds_id* sorted_verts;
   int type;
   sorted_verts = sort_verts(m, tag);
   for (type = MDS_VERTEX + 1; type < MDS_TYPES; ++type)
-    number_ents_of_type(&m->mds, sorted_verts, tag, type);
+    if (mds_dim[type] != skip_dim)
+      number_ents_of_type(&m->mds, sorted_verts, tag, type);
   free(sorted_verts);
 }
 
@@ -326,6 +652,7 @@ static void rebuild_tags(
     nt = mds_create_tag(&(m2->tags),
         t->name,t->bytes,t->user_type);
     mds_swap_tag_structs(&m->tags, &t, &m2->tags, &nt);
+    nt->policy = t->policy;
     for (d = 0; d <= m2->mds.d; ++d) {
       for (ne = mds_begin(&(m2->mds),d);
            ne != MDS_NONE;
@@ -387,6 +714,7 @@ static struct mds_apf* rebuild(
   struct mds_apf* m2;
   struct mds_tag* old_of;
   m2 = mds_apf_create(m->user_model, m->mds.d, m->mds.n);
+  mds_apf_set_storage(m2, m->mds.storage);
   old_of = invert(&m->mds, m2, new_of);
   rebuild_verts(m, m2, old_of);
   rebuild_ents(m, m2, old_of, new_of);
@@ -401,7 +729,7 @@ static struct mds_apf* rebuild(
                 &m2->matches, &m2->mds,
                 new_of);
   }
-  mds_destroy_tag(&m2->tags, old_of);
+  mds_destroy_tag(&m2->tags, old_of, &m2->mds);
   return m2;
 }
 
@@ -411,8 +739,18 @@ struct mds_apf* mds_reorder(struct mds_apf* m, int ignore_peers,
   struct mds_tag* tag;
   struct mds_apf* m2;
   tag = vert_numbers;
-  number_other_ents(m, tag);
+  number_other_ents(m, tag, -1);
   m2 = rebuild(m, tag, ignore_peers);
   mds_apf_destroy(m);
   return m2;
 }
+
+struct mds_apf* mds_reorder_elems(struct mds_apf* m, int ignore_peers,
+    struct mds_tag* numbers)
+{
+  struct mds_apf* m2;
+  number_other_ents(m, numbers, m->mds.d);
+  m2 = rebuild(m, numbers, ignore_peers);
+  mds_apf_destroy(m);
+  return m2;
+}
@@ -9,6 +9,7 @@
 *******************************************************************************/
 
 #include "mds_apf.h"
+#include "mds_smb_raw.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -22,7 +23,8 @@
 #include <sys/stat.h> /*using POSIX mkdir call for SMB "foo/" path*/
 #include <errno.h> /* for checking the error from mkdir */
 
-enum { SMB_VERSION = 5 };
+/* see mds_smb_raw.h for what version 6 changed */
+enum { SMB_VERSION = 6 };
 
 enum {
   SMB_VERT,
@@ -131,11 +133,10 @@ static void read_header(struct pcu_file* f, unsigned* version, unsigned* dim,
         "the # of mesh partitions != the # of MPI ranks");
 }
 
-static void write_header(struct pcu_file* f, unsigned dim,
-    int ignore_peers)
+static void write_header(struct pcu_file* f, unsigned version,
+    unsigned dim, int ignore_peers)
 {
   unsigned magic = 0;
-  unsigned version = SMB_VERSION;
   unsigned np;
   PCU_WRITE_UNSIGNED(f, magic);
   PCU_WRITE_UNSIGNED(f, version);
@@ -154,9 +155,10 @@ static void make_verts(struct mds_apf* m)
     mds_create_entity(&m->mds, MDS_VERTEX, NULL);
 }
 
-static void read_conn(struct pcu_file* f, struct mds_apf* m)
+static void read_conn(struct pcu_file* f, struct mds_apf* m, int form)
 {
-  unsigned* conn;
+  unsigned const* conn;
+  void* tmp;
   struct mds_set down;
   int const* dt;
   mds_id cap;
@@ -171,19 +173,18 @@ static void read_conn(struct pcu_file* f, struct mds_apf* m)
     cap = m->mds.cap[type_mds];
     dt = mds_types[type_mds][mds_dim[type_mds] - 1];
     size = down.n * cap;
-    conn = malloc(size * sizeof(*conn));
-    pcu_read_unsigneds(f, conn, size);
+    conn = mds_smb_read_unsigneds(f, form, size, &tmp);
     for (j = 0; j < cap; ++j) {
       for (k = 0; k < down.n; ++k)
         down.e[k] = mds_identify(dt[k], conn[j * down.n + k]);
       mds_create_entity(&m->mds, type_mds, down.e);
     }
-    free(conn);
+    free(tmp);
     PCU_ALWAYS_ASSERT(m->mds.n[type_mds] == m->mds.cap[type_mds]);
   }
 }
 
-static void write_conn(struct pcu_file* f, struct mds_apf* m)
+static void write_conn(struct pcu_file* f, struct mds_apf* m, int form)
 {
   unsigned* conn;
   struct mds_set down;
@@ -205,7 +206,7 @@ static void write_conn(struct pcu_file* f, struct mds_apf* m)
       for (k = 0; k < down.n; ++k)
         conn[j * down.n + k] = mds_index(down.e[k]);
     }
-    pcu_write_unsigneds(f, conn, size);
+    mds_smb_write_unsigneds(f, form, conn, size);
     free(conn);
   }
 }
@@ -230,29 +231,29 @@ static void write_remotes(struct pcu_file* f, struct mds_apf* m,
   mds_free_links(&ln);
 }
 
-static void read_class(struct pcu_file* f, struct mds_apf* m)
+static void read_class(struct pcu_file* f, struct mds_apf* m, int form)
 {
   mds_id cap;
   size_t size;
   int type_mds;
-  unsigned* class;
+  unsigned const* class;
+  void* tmp;
   int i,j;
   for (i = 0; i < SMB_TYPES; ++i) {
     type_mds = smb2mds(i);
     cap = m->mds.cap[type_mds];
     size = 2 * cap;
-    class = malloc(size * sizeof(*class));
-    pcu_read_unsigneds(f, class, size);
+    class = mds_smb_read_unsigneds(f, form, size, &tmp);
     for (j = 0; j < cap; ++j) {
       m->model[type_mds][j] =
         mds_find_model(m, class[2 * j + 1], class[2 * j]);
       PCU_ALWAYS_ASSERT(m->model[type_mds][j]);
     }
-    free(class);
+    free(tmp);
   }
 }
 
-static void write_class(struct pcu_file* f, struct mds_apf* m)
+static void write_class(struct pcu_file* f, struct mds_apf* m, int form)
 {
   mds_id end;
   size_t size;
@@ -270,14 +271,17 @@ static void write_class(struct pcu_file* f, struct mds_apf* m)
       class[2 * j + 1] = mds_model_dim(m, model);
       class[2 * j] = mds_model_id(m, model);
     }
-    pcu_write_unsigneds(f, class, size);
+    mds_smb_write_unsigneds(f, form, class, size);
     free(class);
   }
 }
 
-static struct mds_tag* read_tag_header(struct pcu_file* f, struct mds_apf* m)
+/* version 6 headers also carry the storage policy of the tag,
+   which read_tags applies once the values are in */
+static struct mds_tag* read_tag_header(struct pcu_file* f, struct mds_apf* m,
+    int form, int* policy)
 {
-  unsigned type, count;
+  unsigned type, count, p;
   char* name;
   struct mds_tag* t;
   int type_apf[2];
@@ -290,15 +294,21 @@ static struct mds_tag* read_tag_header(struct pcu_file* f, struct mds_apf* m)
   PCU_ALWAYS_ASSERT(SMB_INT == type || SMB_DBL == type);
   PCU_READ_UNSIGNED(f, count);
   pcu_read_string(f, &name);
+  *policy = MDS_TAG_DENSE;
+  if (form != SMB_PORTABLE) {
+    PCU_READ_UNSIGNED(f, p);
+    PCU_ALWAYS_ASSERT(p == MDS_TAG_DENSE || p == MDS_TAG_AUTO);
+    *policy = p;
+  }
   t = mds_create_tag(&m->tags, name,
       count * bytes[type], type_apf[type]);
   free(name);
   return t;
 }
 
-static void write_tag_header(struct pcu_file* f, struct mds_tag* t)
+static void write_tag_header(struct pcu_file* f, struct mds_tag* t, int form)
 {
-  unsigned type, count;
+  unsigned type, count, policy;
   int type_smb[2];
   size_t bytes[2];
   type_smb[mds_apf_int] = SMB_INT;
@@ -310,6 +320,10 @@ static void write_tag_header(struct pcu_file* f, struct mds_tag* t)
   PCU_WRITE_UNSIGNED(f, type);
   PCU_WRITE_UNSIGNED(f, count);
   pcu_write_string(f, t->name);
+  if (form != SMB_PORTABLE) {
+    policy = t->policy;
+    PCU_WRITE_UNSIGNED(f, policy);
+  }
 }
 
 static void read_int_tag(struct pcu_file* f, struct mds_apf* m,
@@ -350,40 +364,6 @@ static mds_id count_tagged(struct mds_apf* m, struct mds_tag* tag, int t)
   return count;
 }
 
-static void write_int_tag(struct pcu_file* f, struct mds_apf* m,
-                          struct mds_tag* tag, unsigned count, int t)
-{
-  unsigned* ids;
-  unsigned* tmp;
-  int size;
-  unsigned i;
-  int j;
-  unsigned k;
-  mds_id e;
-  int* p;
-  unsigned* q;
-  ids = malloc(count * sizeof(*ids));
-  size = tag->bytes / sizeof(int);
-  tmp = malloc(size * count * sizeof(*tmp));
-  k = 0;
-  for (i = 0; i < (unsigned)(m->mds.end[t]); ++i) {
-    e = mds_identify(t, i);
-    if (!mds_has_tag(tag, e))
-      continue;
-    ids[k] = i;
-    p = mds_get_tag(tag, e);
-    q = tmp + k * size;
-    for (j = 0; j < size; ++j)
-      q[j] = p[j];
-    ++k;
-  }
-  PCU_ALWAYS_ASSERT(k == count);
-  pcu_write_unsigneds(f, ids, count);
-  pcu_write_unsigneds(f, tmp, size * count);
-  free(tmp);
-  free(ids);
-}
-
 static void read_dbl_tag(struct pcu_file* f, struct mds_apf* m,
     struct mds_tag* tag, unsigned count, int t)
 {
@@ -410,69 +390,124 @@ static void read_dbl_tag(struct pcu_file* f, struct mds_apf* m,
   free(ids);
 }
 
-static void write_dbl_tag(struct pcu_file* f, struct mds_apf* m,
-                          struct mds_tag* tag, unsigned count, int t)
+static void write_tag(struct pcu_file* f, struct mds_apf* m, int form,
+    struct mds_tag* tag, unsigned count, int t)
 {
   unsigned* ids;
-  double* tmp;
-  int size;
+  char* values;
+  mds_id end;
   unsigned i;
-  int j;
   unsigned k;
   mds_id e;
-  double* p;
-  double* q;
+  end = m->mds.end[t];
+  if (form != SMB_PORTABLE && count && count == (unsigned)end &&
+      tag->data[t]) {
+    mds_smb_write_raw(f, tag->data[t], end * tag->bytes);
+    return;
+  }
   ids = malloc(count * sizeof(*ids));
-  size = tag->bytes / sizeof(double);
-  tmp = malloc(size * count * sizeof(*tmp));
+  values = malloc(count * tag->bytes);
   k = 0;
-  for (i = 0; i < (unsigned)(m->mds.end[t]); ++i) {
+  for (i = 0; i < (unsigned)end; ++i) {
     e = mds_identify(t, i);
     if (!mds_has_tag(tag, e))
       continue;
     ids[k] = i;
-    p = mds_get_tag(tag, e);
-    q = tmp + k * size;
-    for (j = 0; j < size; ++j)
-      q[j] = p[j];
+    memcpy(values + k * tag->bytes, mds_get_tag(tag, e), tag->bytes);
     ++k;
   }
   PCU_ALWAYS_ASSERT(k == count);
-  pcu_write_unsigneds(f, ids, count);
-  pcu_write_doubles(f, tmp, size * count);
-  free(tmp);
+  if (form == SMB_PORTABLE) {
+    pcu_write_unsigneds(f, ids, count);
+    if (tag->user_type == mds_apf_int)
+      pcu_write_unsigneds(f, (unsigned*)values,
+          count * tag->bytes / sizeof(unsigned));
+    else
+      pcu_write_doubles(f, (double*)values,
+          count * tag->bytes / sizeof(double));
+  } else {
+    if (count != (unsigned)end)
+      mds_smb_write_raw(f, ids, count * sizeof(*ids));
+    mds_smb_write_raw(f, values, count * tag->bytes);
+  }
+  free(values);
   free(ids);
 }
 
-static void read_tags(struct pcu_file* f, struct mds_apf* m)
+/* moves past the data of a tag that is not being loaded,
+   following the same layout mds_smb_read_raw_tag and friends expect */
+static void skip_tag(struct pcu_file* f, struct mds_apf* m, int form,
+    struct mds_tag* tag, unsigned count, int t)
+{
+  if (form == SMB_PORTABLE) {
+    pcu_fskip(f, count * (sizeof(unsigned) + tag->bytes));
+    return;
+  }
+  if (!(count && count == (unsigned)(m->mds.end[t]))) {
+    pcu_fskip(f, mds_smb_padding(f));
+    pcu_fskip(f, count * sizeof(unsigned));
+  }
+  pcu_fskip(f, mds_smb_padding(f));
+  pcu_fskip(f, (size_t)count * tag->bytes);
+}
+
+static int is_kept(const char* const* keep, const char* name)
+{
+  if (!keep)
+    return 1;
+  for (; *keep; ++keep)
+    if (!strcmp(*keep, name))
+      return 1;
+  return 0;
+}
+
+static void read_tags(struct pcu_file* f, struct mds_apf* m, int form,
+    const char* const* keep)
 {
   unsigned n;
   unsigned* sizes;
   struct mds_tag** tags;
+  int* kept;
+  int* policies;
   unsigned i,j;
   int type_mds;
   PCU_READ_UNSIGNED(f,n);
   PCU_ALWAYS_ASSERT(n < MAX_TAGS);
   tags = malloc(n * sizeof(*tags));
+  kept = malloc(n * sizeof(*kept));
+  policies = malloc(n * sizeof(*policies));
   sizes = malloc(n * sizeof(*sizes));
-  for (i = 0; i < n; ++i)
-    tags[i] = read_tag_header(f, m);
+  for (i = 0; i < n; ++i) {
+    tags[i] = read_tag_header(f, m, form, &policies[i]);
+    kept[i] = is_kept(keep, tags[i]->name);
+  }
   for (i = 0; i < SMB_TYPES; ++i) {
     pcu_read_unsigneds(f, sizes, n);
     type_mds = smb2mds(i);
     for (j = 0; j < n; ++j) {
       if (sizeof(mds_id) == 4) PCU_ALWAYS_ASSERT(sizes[j] < MAX_ENTITIES);
-      if (tags[j]->user_type == mds_apf_int)
+      if (!kept[j])
+        skip_tag(f, m, form, tags[j], sizes[j], type_mds);
+      else if (form != SMB_PORTABLE)
+        mds_smb_read_raw_tag(f, m, form, tags[j], sizes[j], type_mds);
+      else if (tags[j]->user_type == mds_apf_int)
         read_int_tag(f, m, tags[j], sizes[j], type_mds);
       else
         read_dbl_tag(f, m, tags[j], sizes[j], type_mds);
     }
   }
+  for (i = 0; i < n; ++i)
+    if (!kept[i])
+      mds_destroy_tag(&m->tags, tags[i], &m->mds);
+    else if (policies[i] != MDS_TAG_DENSE)
+      mds_set_tag_policy(tags[i], &m->mds, policies[i]);
   free(tags);
+  free(kept);
+  free(policies);
   free(sizes);
 }
 
-static void write_tags(struct pcu_file* f, struct mds_apf* m)
+static void write_tags(struct pcu_file* f, struct mds_apf* m, int form)
 {
   unsigned n;
   unsigned* sizes;
@@ -487,7 +522,7 @@ static void write_tags(struct pcu_file* f, struct mds_apf* m)
   sizes = malloc(n * sizeof(*sizes));
   for (t = m->tags.first; t; t = t->next)
     if (t->user_type != mds_apf_long)
-      write_tag_header(f, t);
+      write_tag_header(f, t, form);
   for (i = 0; i < SMB_TYPES; ++i) {
     type_mds = smb2mds(i);
     j = 0;
@@ -498,12 +533,9 @@ static void write_tags(struct pcu_file* f, struct mds_apf* m)
     }
     pcu_write_unsigneds(f, sizes, n);
     j = 0;
-    for (t = m->tags.first; t; t = t->next) {
-      if (t->user_type == mds_apf_int)
-        write_int_tag(f, m, t, sizes[j++], type_mds);
-      else if (t->user_type == mds_apf_double)
-        write_dbl_tag(f, m, t, sizes[j++], type_mds);
-    }
+    for (t = m->tags.first; t; t = t->next)
+      if (t->user_type != mds_apf_long)
+        write_tag(f, m, form, t, sizes[j++], type_mds);
   }
   free(sizes);
 }
@@ -557,11 +589,10 @@ static void write_matches(struct pcu_file* f, struct mds_apf* m,
     write_type_matches(f, m, smb2mds(t), ignore_peers);
 }
 
-static struct mds_apf* read_smb(struct gmi_model* model, const char* filename,
-    int zip, int ignore_peers, void* apf_mesh)
+static struct mds_apf* read_smb(struct gmi_model* model, struct pcu_file* f,
+    int ignore_peers, const char* const* keep_tags, void* apf_mesh)
 {
   struct mds_apf* m;
-  struct pcu_file* f;
   unsigned version;
   unsigned dim;
   unsigned n[SMB_TYPES];
@@ -569,8 +600,7 @@ static struct mds_apf* read_smb(struct gmi_model* model, const char* filename,
   int i;
   unsigned tmp;
   unsigned pi, pj;
-  f = pcu_fopen(filename, 0, zip);
-  PCU_ALWAYS_ASSERT(f);
+  int form = SMB_PORTABLE;
   read_header(f, &version, &dim, ignore_peers);
   pcu_read_unsigneds(f, n, SMB_TYPES);
   for (i = 0; i < MDS_TYPES; ++i) {
@@ -578,12 +608,14 @@ static struct mds_apf* read_smb(struct gmi_model* model, const char* filename,
     if (sizeof(mds_id) == 4) PCU_ALWAYS_ASSERT(tmp < MAX_ENTITIES);
     cap[i] = tmp;
   }
+  if (version >= 6)
+    form = mds_smb_read_byte_order(f);
   m = mds_apf_create(model, dim, cap);
   make_verts(m);
-  read_conn(f, m);
-  pcu_read_doubles(f, &m->point[0][0], 3 * n[SMB_VERT]);
+  read_conn(f, m, form);
+  mds_smb_read_doubles(f, form, &m->point[0][0], 3 * n[SMB_VERT]);
   if (version >= 2) {
-    pcu_read_doubles(f, &m->param[0][0], 2 * n[SMB_VERT]);
+    mds_smb_read_doubles(f, form, &m->param[0][0], 2 * n[SMB_VERT]);
   } else {
 /* initialize parameteric coordinates to zero if they are not in the file */
     for (pi = 0; pi < n[SMB_VERT]; ++pi) {
@@ -591,47 +623,47 @@ static struct mds_apf* read_smb(struct gmi_model* model, const char* filename,
     }
   }
   read_remotes(f, m, ignore_peers);
-  read_class(f, m);
-  read_tags(f, m);
+  read_class(f, m, form);
+  read_tags(f, m, form, keep_tags);
   if (version >= 4)
     read_matches_new(f, m, ignore_peers);
   else if (version >= 3)
     read_matches_old(f, m, ignore_peers);
   if (version >= 5)
     mds_read_smb_meta(f, m, apf_mesh);
-  pcu_fclose(f);
   return m;
 }
 
-static void write_coords(struct pcu_file* f, struct mds_apf* m)
+static void write_coords(struct pcu_file* f, struct mds_apf* m, int form)
 {
   size_t count;
   count = m->mds.end[MDS_VERTEX] * 3;
-  pcu_write_doubles(f, &m->point[0][0], count);
+  mds_smb_write_doubles(f, form, &m->point[0][0], count);
   count = m->mds.end[MDS_VERTEX] * 2;
-  pcu_write_doubles(f, &m->param[0][0], count);
+  mds_smb_write_doubles(f, form, &m->param[0][0], count);
 }
 
-static void write_smb(struct mds_apf* m, const char* filename,
-    int zip, int ignore_peers, void* apf_mesh)
+static void write_smb(struct mds_apf* m, struct pcu_file* f,
+    int ignore_peers, int version, void* apf_mesh)
 {
-  struct pcu_file* f;
   unsigned n[SMB_TYPES] = {0};
   int i;
-  f = pcu_fopen(filename, 1, zip);
-  PCU_ALWAYS_ASSERT(f);
-  write_header(f, m->mds.d, ignore_peers);
+  int form = SMB_PORTABLE;
+  write_header(f, version, m->mds.d, ignore_peers);
   for (i = 0; i < MDS_TYPES; ++i)
     n[mds2smb(i)] = m->mds.end[i];
   pcu_write_unsigneds(f, n, SMB_TYPES);
-  write_conn(f, m);
-  write_coords(f, m);
+  if (version >= 6) {
+    form = SMB_NATIVE;
+    mds_smb_write_byte_order(f);
+  }
+  write_conn(f, m, form);
+  write_coords(f, m, form);
   write_remotes(f, m, ignore_peers);
-  write_class(f, m);
-  write_tags(f, m);
+  write_class(f, m, form);
+  write_tags(f, m, form);
   write_matches(f, m, ignore_peers);
   mds_write_smb_meta(f, apf_mesh);
-  pcu_fclose(f);
 }
 
 static int ends_with(const char* s, const char* w)
@@ -730,17 +762,62 @@ static char* handle_path(const char* in, int is_write, int* zip,
 }
 
 struct mds_apf* mds_read_smb(struct gmi_model* model, const char* pathname,
-    int ignore_peers, void* apf_mesh)
+    int ignore_peers, const char* const* keep_tags, void* apf_mesh)
 {
   char* filename;
   int zip;
   struct mds_apf* m;
+  struct pcu_file* f;
   filename = handle_path(pathname, 0, &zip, ignore_peers);
-  m = read_smb(model, filename, zip, ignore_peers, apf_mesh);
+  f = pcu_fopen(filename, 0, zip);
+  PCU_ALWAYS_ASSERT(f);
+  m = read_smb(model, f, ignore_peers, keep_tags, apf_mesh);
+  pcu_fclose(f);
   free(filename);
   return m;
 }
 
+/* "name.smba" stands for the files nameN.smba */
+static char* archive_prefix(const char* pathname)
+{
+  static const char* ext = ".smba";
+  char* prefix;
+  if (!ends_with(pathname, ext))
+    reel_fail("MDS: invalid smb archive path \"%s\"\n", pathname);
+  prefix = malloc(strlen(pathname) + 1);
+  strcpy(prefix, pathname);
+  remove_ext(prefix, ext);
+  return prefix;
+}
+
+int mds_count_smb_archive(const char* pathname)
+{
+  char* prefix;
+  int parts;
+  prefix = archive_prefix(pathname);
+  parts = pcu_count_aggregate(prefix, "smba");
+  free(prefix);
+  return parts;
+}
+
+struct mds_apf* mds_read_smb_archive(struct gmi_model* model,
+    const char* pathname, void* apf_mesh)
+{
+  char* prefix;
+  char* data;
+  size_t size;
+  struct pcu_file* f;
+  struct mds_apf* m;
+  prefix = archive_prefix(pathname);
+  data = pcu_read_aggregate(prefix, "smba", &size);
+  free(prefix);
+  f = pcu_fopen_memory(data, size);
+  m = read_smb(model, f, 0, NULL, apf_mesh);
+  pcu_fclose(f);
+  free(data);
+  return m;
+}
+
 static int is_compact(struct mds_apf* m)
 {
   int t;
@@ -750,12 +827,9 @@ static int is_compact(struct mds_apf* m)
   return 1;
 }
 
-struct mds_apf* mds_write_smb(struct mds_apf* m, const char* pathname,
-    int ignore_peers, void* apf_mesh)
+static struct mds_apf* make_compact(struct mds_apf* m, int ignore_peers)
 {
   const char* reorderWarning ="MDS: reordering before writing smb files\n";
-  char* filename;
-  int zip;
   if (ignore_peers && (!is_compact(m))) {
     if(!PCU_Comm_Self()) lion_eprint(1, "%s", reorderWarning);
     m = mds_reorder(m, 1, mds_number_verts_bfs(m));
@@ -764,9 +838,48 @@ struct mds_apf* mds_write_smb(struct mds_apf* m, const char* pathname,
     if(!PCU_Comm_Self()) lion_eprint(1, "%s", reorderWarning);
     m = mds_reorder(m, 0, mds_number_verts_bfs(m));
   }
+  return m;
+}
+
+void mds_check_smb_version(int version)
+{
+  if (version != 5 && version != SMB_VERSION)
+    reel_fail("MDS: can not write smb version %d\n", version);
+}
+
+struct mds_apf* mds_write_smb(struct mds_apf* m, const char* pathname,
+    int ignore_peers, int version, void* apf_mesh)
+{
+  char* filename;
+  int zip;
+  struct pcu_file* f;
+  mds_check_smb_version(version);
+  m = make_compact(m, ignore_peers);
   filename = handle_path(pathname, 1, &zip, ignore_peers);
-  write_smb(m, filename, zip, ignore_peers, apf_mesh);
+  f = pcu_fopen(filename, 1, zip);
+  PCU_ALWAYS_ASSERT(f);
+  write_smb(m, f, ignore_peers, version, apf_mesh);
+  pcu_fclose(f);
   free(filename);
   return m;
 }
 
+struct mds_apf* mds_write_smb_archive(struct mds_apf* m, const char* pathname,
+    int files, int version, void* apf_mesh)
+{
+  char* prefix;
+  char* data = NULL;
+  size_t size = 0;
+  struct pcu_file* f;
+  mds_check_smb_version(version);
+  prefix = archive_prefix(pathname);
+  m = make_compact(m, 0);
+  f = pcu_fopen_buffer(&data, &size);
+  write_smb(m, f, 0, version, apf_mesh);
+  pcu_fclose(f);
+  pcu_write_aggregate(prefix, "smba", files, data, size);
+  free(data);
+  free(prefix);
+  return m;
+}
+
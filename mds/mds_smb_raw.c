@@ -0,0 +1,168 @@
+/****************************************************************************** 
+
+  Copyright 2014 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+
+#include "mds_smb_raw.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pcu_io.h>
+#include <reel.h>
+
+#define SMB_BYTE_ORDER 0x01020304u
+#define SMB_ALIGN 8
+
+size_t mds_smb_padding(struct pcu_file* f)
+{
+  return (SMB_ALIGN - pcu_ftell(f) % SMB_ALIGN) % SMB_ALIGN;
+}
+
+static void align_read(struct pcu_file* f)
+{
+  char pad[SMB_ALIGN];
+  pcu_read(f, pad, mds_smb_padding(f));
+}
+
+static void align_write(struct pcu_file* f)
+{
+  char pad[SMB_ALIGN] = {0};
+  pcu_write(f, pad, mds_smb_padding(f));
+}
+
+static void swap_words(void* p, size_t word, size_t n)
+{
+  if (word == sizeof(unsigned))
+    pcu_swap_unsigneds(p, n);
+  else
+    pcu_swap_doubles(p, n);
+}
+
+/* returns (n) raw words of (word) bytes. The result points into
+   the mapped file when possible, otherwise into a buffer also
+   returned in (tmp) which the caller frees */
+void const* mds_smb_read_raw(struct pcu_file* f, int form,
+    size_t word, size_t n, void** tmp)
+{
+  void const* p = NULL;
+  align_read(f);
+  *tmp = NULL;
+  if (form == SMB_NATIVE)
+    p = pcu_fview(f, word * n);
+  if (p)
+    return p;
+  *tmp = malloc(word * n);
+  pcu_read(f, *tmp, word * n);
+  if (form == SMB_SWAPPED)
+    swap_words(*tmp, word, n);
+  return *tmp;
+}
+
+void mds_smb_write_raw(struct pcu_file* f, void const* p, size_t bytes)
+{
+  align_write(f);
+  pcu_write(f, p, bytes);
+}
+
+void mds_smb_write_unsigneds(struct pcu_file* f, int form,
+    unsigned* p, size_t n)
+{
+  if (form == SMB_PORTABLE)
+    pcu_write_unsigneds(f, p, n);
+  else
+    mds_smb_write_raw(f, p, n * sizeof(*p));
+}
+
+void mds_smb_write_doubles(struct pcu_file* f, int form,
+    double* p, size_t n)
+{
+  if (form == SMB_PORTABLE)
+    pcu_write_doubles(f, p, n);
+  else
+    mds_smb_write_raw(f, p, n * sizeof(*p));
+}
+
+unsigned const* mds_smb_read_unsigneds(struct pcu_file* f, int form,
+    size_t n, void** tmp)
+{
+  if (form != SMB_PORTABLE)
+    return mds_smb_read_raw(f, form, sizeof(unsigned), n, tmp);
+  *tmp = malloc(n * sizeof(unsigned));
+  pcu_read_unsigneds(f, *tmp, n);
+  return *tmp;
+}
+
+void mds_smb_read_doubles(struct pcu_file* f, int form,
+    double* p, size_t n)
+{
+  void const* v;
+  void* tmp;
+  if (form == SMB_PORTABLE) {
+    pcu_read_doubles(f, p, n);
+    return;
+  }
+  v = mds_smb_read_raw(f, form, sizeof(double), n, &tmp);
+  memcpy(p, v, n * sizeof(double));
+  free(tmp);
+}
+
+int mds_smb_read_byte_order(struct pcu_file* f)
+{
+  unsigned bom;
+  pcu_read(f, (char*)&bom, sizeof(bom));
+  if (bom == SMB_BYTE_ORDER)
+    return SMB_NATIVE;
+  pcu_swap_unsigneds(&bom, 1);
+  if (bom != SMB_BYTE_ORDER)
+    reel_fail("MDS: unknown byte order in smb file\n");
+  return SMB_SWAPPED;
+}
+
+void mds_smb_write_byte_order(struct pcu_file* f)
+{
+  unsigned bom = SMB_BYTE_ORDER;
+  pcu_write(f, (char const*)&bom, sizeof(bom));
+}
+
+static size_t tag_word(struct mds_tag* tag)
+{
+  if (tag->user_type == mds_apf_int)
+    return sizeof(int);
+  return sizeof(double);
+}
+
+/* when every entity of the type is tagged, the values are
+   stored alone in index order, otherwise they follow a list
+   of the tagged entity indices */
+void mds_smb_read_raw_tag(struct pcu_file* f, struct mds_apf* m, int form,
+    struct mds_tag* tag, unsigned count, int t)
+{
+  unsigned const* ids;
+  char const* values;
+  void* tmp[2];
+  size_t word;
+  unsigned i;
+  mds_id e;
+  word = tag_word(tag);
+  if (count && count == (unsigned)(m->mds.end[t])) {
+    values = mds_smb_read_raw(f, form, word, count * tag->bytes / word,
+        &tmp[0]);
+    mds_fill_tag(tag, &m->mds, t, values);
+    free(tmp[0]);
+    return;
+  }
+  ids = mds_smb_read_raw(f, form, sizeof(unsigned), count, &tmp[0]);
+  values = mds_smb_read_raw(f, form, word, count * tag->bytes / word, &tmp[1]);
+  for (i = 0; i < count; ++i) {
+    e = mds_identify(t, ids[i]);
+    mds_give_tag(tag, &m->mds, e);
+    memcpy(mds_get_tag(tag, e), values + i * tag->bytes, tag->bytes);
+  }
+  free(tmp[0]);
+  free(tmp[1]);
+}
+
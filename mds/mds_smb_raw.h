@@ -0,0 +1,51 @@
+/****************************************************************************** 
+
+  Copyright 2014 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef MDS_SMB_RAW_H
+#define MDS_SMB_RAW_H
+
+#include "mds_apf.h"
+
+struct pcu_file;
+
+/* Up to version 5, every array is a big-endian stream.
+   Since version 6, the bulk arrays (connectivity, coordinates,
+   classification and tag values) are stored raw in the byte order
+   of the writer, each aligned to 8 bytes in the file,
+   so that a reader on a machine of the same byte order can use
+   them straight out of a read-only mapping of the file,
+   and tag headers record whether the tag may be kept sparse.
+   Version 5 is written unless version 6 is asked for, so that
+   older readers keep working.
+
+   The form of a file says which of these its arrays are. */
+enum {
+  SMB_PORTABLE,
+  SMB_NATIVE,
+  SMB_SWAPPED
+};
+
+size_t mds_smb_padding(struct pcu_file* f);
+void const* mds_smb_read_raw(struct pcu_file* f, int form,
+    size_t word, size_t n, void** tmp);
+void mds_smb_write_raw(struct pcu_file* f, void const* p, size_t bytes);
+void mds_smb_write_unsigneds(struct pcu_file* f, int form,
+    unsigned* p, size_t n);
+void mds_smb_write_doubles(struct pcu_file* f, int form,
+    double* p, size_t n);
+unsigned const* mds_smb_read_unsigneds(struct pcu_file* f, int form,
+    size_t n, void** tmp);
+void mds_smb_read_doubles(struct pcu_file* f, int form,
+    double* p, size_t n);
+int mds_smb_read_byte_order(struct pcu_file* f);
+void mds_smb_write_byte_order(struct pcu_file* f);
+void mds_smb_read_raw_tag(struct pcu_file* f, struct mds_apf* m, int form,
+    struct mds_tag* tag, unsigned count, int t);
+
+#endif
@@ -11,16 +11,201 @@
 #include "mds_tag.h"
 #include <stdlib.h>
 #include <string.h>
+#include <pcu_util.h>
+
+#define MIN_SPARSE_CAP 16
 
 void mds_create_tags(struct mds_tags* ts)
 {
   ts->first = NULL;
 }
 
-void mds_destroy_tags(struct mds_tags* ts)
+void mds_destroy_tags(struct mds_tags* ts, struct mds* m)
 {
   while (ts->first)
-    mds_destroy_tag(ts,ts->first);
+    mds_destroy_tag(ts,ts->first,m);
+}
+
+/* Sparse storage is a linear-probing hash table keyed by entity
+   index, kept at most half full. Removal shifts later entries of
+   the same probe run back instead of leaving tombstones. */
+
+static mds_id home_slot(struct mds_sparse* s, mds_id i)
+{
+  return (mds_id)(((unsigned long)i * 2654435761ul) & (s->cap - 1));
+}
+
+static mds_id next_slot(struct mds_sparse* s, mds_id k)
+{
+  return (k + 1) & (s->cap - 1);
+}
+
+static struct mds_sparse* make_sparse(int bytes, mds_id cap)
+{
+  struct mds_sparse* s;
+  mds_id k;
+  s = malloc(sizeof(*s));
+  s->n = 0;
+  s->cap = cap;
+  s->keys = malloc(cap * sizeof(mds_id));
+  s->values = malloc(cap * bytes);
+  for (k = 0; k < cap; ++k)
+    s->keys[k] = MDS_NONE;
+  return s;
+}
+
+static void free_sparse(struct mds_sparse* s)
+{
+  if (!s)
+    return;
+  free(s->keys);
+  free(s->values);
+  free(s);
+}
+
+static mds_id find_sparse(struct mds_sparse* s, mds_id i)
+{
+  mds_id k;
+  for (k = home_slot(s, i); s->keys[k] != MDS_NONE; k = next_slot(s, k))
+    if (s->keys[k] == i)
+      return k;
+  return MDS_NONE;
+}
+
+/* caller ensures i is absent and there is room */
+static mds_id insert_sparse(struct mds_sparse* s, mds_id i)
+{
+  mds_id k;
+  for (k = home_slot(s, i); s->keys[k] != MDS_NONE; k = next_slot(s, k));
+  s->keys[k] = i;
+  ++s->n;
+  return k;
+}
+
+static void remove_sparse(struct mds_sparse* s, int bytes, mds_id k)
+{
+  mds_id j;
+  mds_id h;
+  for (j = next_slot(s, k); s->keys[j] != MDS_NONE; j = next_slot(s, j)) {
+    h = home_slot(s, s->keys[j]);
+    /* entries whose home lies cyclically in (k,j] stay put */
+    if (k <= j ? (k < h && h <= j) : (k < h || h <= j))
+      continue;
+    s->keys[k] = s->keys[j];
+    memcpy(s->values + k * bytes, s->values + j * bytes, bytes);
+    k = j;
+  }
+  s->keys[k] = MDS_NONE;
+  --s->n;
+}
+
+/* rebuild into a table of a new size, optionally renumbering keys */
+static struct mds_sparse* rehash_sparse(struct mds_sparse* s, int bytes,
+    mds_id cap, mds_id* new_of)
+{
+  struct mds_sparse* s2;
+  mds_id k;
+  mds_id k2;
+  mds_id i;
+  s2 = make_sparse(bytes, cap);
+  for (k = 0; k < s->cap; ++k) {
+    i = s->keys[k];
+    if (i == MDS_NONE)
+      continue;
+    if (new_of)
+      i = new_of[i];
+    k2 = insert_sparse(s2, i);
+    memcpy(s2->values + k2 * bytes, s->values + k * bytes, bytes);
+  }
+  free_sparse(s);
+  return s2;
+}
+
+static size_t dense_bytes(struct mds_tag* tag, mds_id cap)
+{
+  return cap * tag->bytes + (cap / 8) + 1;
+}
+
+static size_t sparse_bytes(struct mds_tag* tag, mds_id cap)
+{
+  return cap * (tag->bytes + sizeof(mds_id));
+}
+
+static mds_id sparse_cap_for(mds_id n)
+{
+  mds_id cap = MIN_SPARSE_CAP;
+  while (cap < 2 * n)
+    cap *= 2;
+  return cap;
+}
+
+static void alloc_dense(struct mds_tag* tag, struct mds* m, int t)
+{
+  tag->has[t] = mds_calloc_array((m->cap[t] / 8) + 1, m->storage);
+  tag->data[t] = mds_resize_array(NULL,
+      tag->bytes * m->cap[t], m->storage);
+  tag->count[t] = 0;
+}
+
+static void set_bit(unsigned char* has, mds_id i)
+{
+  has[i / 8] |= (1 << (i % 8));
+}
+
+static int get_bit(unsigned char* has, mds_id i)
+{
+  return (has[i / 8] >> (i % 8)) & 1;
+}
+
+static void promote(struct mds_tag* tag, struct mds* m, int t)
+{
+  struct mds_sparse* s = tag->sparse[t];
+  mds_id k;
+  mds_id i;
+  alloc_dense(tag, m, t);
+  for (k = 0; k < s->cap; ++k) {
+    i = s->keys[k];
+    if (i == MDS_NONE)
+      continue;
+    set_bit(tag->has[t], i);
+    memcpy(tag->data[t] + i * tag->bytes,
+           s->values + k * tag->bytes, tag->bytes);
+  }
+  tag->count[t] = s->n;
+  free_sparse(s);
+  tag->sparse[t] = NULL;
+}
+
+static void demote(struct mds_tag* tag, struct mds* m, int t)
+{
+  struct mds_sparse* s = NULL;
+  mds_id i;
+  mds_id k;
+  if (tag->count[t]) {
+    s = make_sparse(tag->bytes, sparse_cap_for(tag->count[t]));
+    for (i = 0; i < m->end[t]; ++i) {
+      if (!get_bit(tag->has[t], i))
+        continue;
+      k = insert_sparse(s, i);
+      memcpy(s->values + k * tag->bytes,
+             tag->data[t] + i * tag->bytes, tag->bytes);
+    }
+  }
+  mds_free_array(tag->has[t], m->storage);
+  mds_free_array(tag->data[t], m->storage);
+  tag->has[t] = NULL;
+  tag->data[t] = NULL;
+  tag->count[t] = 0;
+  tag->sparse[t] = s;
+}
+
+/* the hash pays off while it is at most half the size of
+   the dense arrays, which leaves room before switching back */
+static int should_demote(struct mds_tag* tag, struct mds* m, int t)
+{
+  return tag->policy == MDS_TAG_AUTO &&
+    2 * sparse_bytes(tag, sparse_cap_for(tag->count[t]))
+    <= dense_bytes(tag, m->cap[t]);
 }
 
 static void grow_tag(
@@ -36,11 +221,11 @@ static void grow_tag(
       continue;
     has[0] = (old_cap[t] / 8) + 1;
     has[1] = (m->cap[t] / 8) + 1;
-    tag->has[t] = realloc(tag->has[t], has[1]);
+    tag->has[t] = mds_resize_array(tag->has[t], has[1], m->storage);
     for (i = has[0]; i < has[1]; ++i)
       tag->has[t][i] = 0;
-    tag->data[t] = realloc(tag->data[t],
-        tag->bytes * m->cap[t]);
+    tag->data[t] = mds_resize_array(tag->data[t],
+        tag->bytes * m->cap[t], m->storage);
   }
 }
 
@@ -54,6 +239,19 @@ void mds_grow_tags(
     grow_tag(t,m,old_cap);
 }
 
+void mds_move_tags(struct mds_tags* ts, struct mds* m, int storage)
+{
+  struct mds_tag* tag;
+  int t;
+  for (tag = ts->first; tag; tag = tag->next)
+    for (t = 0; t < MDS_TYPES; ++t) {
+      tag->has[t] = mds_move_array(tag->has[t],
+          (m->cap[t] / 8) + 1, m->storage, storage);
+      tag->data[t] = mds_move_array(tag->data[t],
+          tag->bytes * m->cap[t], m->storage, storage);
+    }
+}
+
 struct mds_tag* mds_create_tag(
     struct mds_tags* ts,
     const char* name,
@@ -67,28 +265,40 @@ struct mds_tag* mds_create_tag(
   ts->first = t;
   t->bytes = bytes;
   t->user_type = user_type;
+  t->policy = MDS_TAG_DENSE;
   l = strlen(name);
   t->name = malloc(l + 1);
   strcpy(t->name,name);
   return t;
 }
 
-void mds_destroy_tag(struct mds_tags* ts, struct mds_tag* t)
+void mds_destroy_tag(struct mds_tags* ts, struct mds_tag* t,
+    struct mds* m)
 {
   struct mds_tag** p;
   int i;
   for (p = &(ts->first); *p != t; p = &((*p)->next));
   *p = (*p)->next;
   for (i = 0; i < MDS_TYPES; ++i)
-    free(t->data[i]);
+    mds_free_array(t->data[i], m->storage);
+  for (i = 0; i < MDS_TYPES; ++i)
+    mds_free_array(t->has[i], m->storage);
   for (i = 0; i < MDS_TYPES; ++i)
-    free(t->has[i]);
+    free_sparse(t->sparse[i]);
   free(t->name);
   free(t);
 }
 
 void* mds_get_tag(struct mds_tag* tag, mds_id e)
 {
+  struct mds_sparse* s;
+  mds_id k;
+  s = tag->sparse[mds_type(e)];
+  if (s) {
+    k = find_sparse(s, mds_index(e));
+    PCU_ALWAYS_ASSERT(k != MDS_NONE);
+    return s->values + tag->bytes * k;
+  }
   return tag->data[mds_type(e)] + tag->bytes * mds_index(e);
 }
 
@@ -109,6 +319,8 @@ int mds_has_tag(struct mds_tag* tag, mds_id e)
   int b;
   unsigned char v;
   t = mds_type(e);
+  if (tag->sparse[t])
+    return find_sparse(tag->sparse[t], mds_index(e)) != MDS_NONE;
   if ( ! tag->has[t])
     return 0;
   i = mds_index(e);
@@ -118,6 +330,34 @@ int mds_has_tag(struct mds_tag* tag, mds_id e)
   return v != 0;
 }
 
+/* returns 0 if the type had to switch to dense storage instead */
+static int give_sparse(struct mds_tag* tag, struct mds* m, mds_id e)
+{
+  int t;
+  mds_id i;
+  mds_id cap;
+  struct mds_sparse* s;
+  t = mds_type(e);
+  i = mds_index(e);
+  s = tag->sparse[t];
+  if (s && find_sparse(s, i) != MDS_NONE)
+    return 1;
+  cap = s ? s->cap : MIN_SPARSE_CAP;
+  if (s && 2 * (s->n + 1) > s->cap)
+    cap *= 2;
+  if (sparse_bytes(tag, cap) > dense_bytes(tag, m->cap[t])) {
+    if (s)
+      promote(tag, m, t);
+    return 0;
+  }
+  if (!s)
+    s = tag->sparse[t] = make_sparse(tag->bytes, cap);
+  else if (cap != s->cap)
+    s = tag->sparse[t] = rehash_sparse(s, tag->bytes, cap, NULL);
+  insert_sparse(s, i);
+  return 1;
+}
+
 void mds_give_tag(struct mds_tag* tag, struct mds* m, mds_id e)
 {
   int t;
@@ -126,32 +366,96 @@ void mds_give_tag(struct mds_tag* tag, struct mds* m, mds_id e)
   int b;
   unsigned char* has;
   t = mds_type(e);
-  if ( ! tag->has[t]) {
-    tag->has[t] = calloc((m->cap[t] / 8) + 1, 1);
-    tag->data[t] = malloc(tag->bytes * m->cap[t]);
-  }
+  if (tag->sparse[t] ||
+      (!tag->has[t] && tag->policy == MDS_TAG_AUTO))
+    if (give_sparse(tag, m, e))
+      return;
+  if ( ! tag->has[t])
+    alloc_dense(tag, m, t);
   i = mds_index(e);
   c = i / 8;
   b = i % 8;
   has = tag->has[t] + c;
+  /* giving an entity its tag again writes nothing, so threads
+     may rewrite values entities already have */
+  if (*has & (1<<b))
+    return;
+  ++tag->count[t];
   *has |= (1<<b);
 }
 
-void mds_take_tag(struct mds_tag* tag, mds_id e)
+void mds_take_tag(struct mds_tag* tag, struct mds* m, mds_id e)
 {
   int t;
   mds_id i;
   mds_id c;
   int b;
+  mds_id k;
   unsigned char* has;
   t = mds_type(e);
   i = mds_index(e);
+  if (tag->sparse[t]) {
+    k = find_sparse(tag->sparse[t], i);
+    if (k == MDS_NONE)
+      return;
+    remove_sparse(tag->sparse[t], tag->bytes, k);
+    if (!tag->sparse[t]->n) {
+      free_sparse(tag->sparse[t]);
+      tag->sparse[t] = NULL;
+    }
+    return;
+  }
   c = i / 8;
   b = i % 8;
   if (!tag->has[t])
     return;
   has = tag->has[t] + c;
+  if (*has & (1 << b))
+    --tag->count[t];
   *has &= ~(1 << b);
+  if (should_demote(tag, m, t))
+    demote(tag, m, t);
+}
+
+/* gives the tag to entities 0 to end-1 of type t at once,
+   with their values packed in index order */
+void mds_fill_tag(struct mds_tag* tag, struct mds* m, int t,
+    void const* values)
+{
+  mds_id end = m->end[t];
+  if (tag->sparse[t]) {
+    free_sparse(tag->sparse[t]);
+    tag->sparse[t] = NULL;
+  }
+  if (!tag->has[t])
+    alloc_dense(tag, m, t);
+  memset(tag->has[t], 0xFF, end / 8);
+  if (end % 8)
+    tag->has[t][end / 8] |= (1 << (end % 8)) - 1;
+  tag->count[t] = end;
+  memcpy(tag->data[t], values, end * tag->bytes);
+}
+
+void mds_set_tag_policy(struct mds_tag* tag, struct mds* m, int policy)
+{
+  int t;
+  tag->policy = policy;
+  for (t = 0; t < MDS_TYPES; ++t)
+    if (policy == MDS_TAG_DENSE && tag->sparse[t])
+      promote(tag, m, t);
+    else if (tag->has[t] && should_demote(tag, m, t))
+      demote(tag, m, t);
+}
+
+void mds_renumber_sparse_tags(struct mds_tags* ts, int t, mds_id* new_of)
+{
+  struct mds_tag* tag;
+  struct mds_sparse* s;
+  for (tag = ts->first; tag; tag = tag->next) {
+    s = tag->sparse[t];
+    if (s)
+      tag->sparse[t] = rehash_sparse(s, tag->bytes, s->cap, new_of);
+  }
 }
 
 void mds_rename_tag(struct mds_tag* tag, const char* newName)
@@ -198,3 +502,23 @@ void mds_swap_tag_structs(struct mds_tags* as, struct mds_tag** a,
   *a = *b;
   *b = tmp_p;
 }
+
+void mds_tags_memory(struct mds_tags* ts, struct mds* m,
+    size_t allocated[MDS_TYPES], size_t live[MDS_TYPES])
+{
+  struct mds_tag* tag;
+  struct mds_sparse* s;
+  int t;
+  for (tag = ts->first; tag; tag = tag->next)
+    for (t = 0; t < MDS_TYPES; ++t) {
+      if (tag->has[t])
+        allocated[t] += dense_bytes(tag, m->cap[t]);
+      s = tag->sparse[t];
+      if (s) {
+        allocated[t] += sizeof(*s) + sparse_bytes(tag, s->cap);
+        live[t] += sparse_bytes(tag, s->n);
+      } else {
+        live[t] += tag->count[t] * (size_t)tag->bytes;
+      }
+    }
+}
@@ -13,12 +13,32 @@
 
 #include "mds.h"
 
+/* storage policies for a tag */
+enum {
+  /* one value slot per entity of each type the tag touches */
+  MDS_TAG_DENSE,
+  /* types where few entities carry the tag are kept in a hash
+     table instead, switching as the fill ratio changes */
+  MDS_TAG_AUTO
+};
+
+/* open-addressing hash of entity index to value */
+struct mds_sparse {
+  mds_id n;
+  mds_id cap;
+  mds_id* keys;
+  char* values;
+};
+
 struct mds_tag {
   struct mds_tag* next;
   int bytes;
   int user_type;
+  int policy;
   char* data[MDS_TYPES];
   unsigned char* has[MDS_TYPES];
+  struct mds_sparse* sparse[MDS_TYPES];
+  mds_id count[MDS_TYPES];
   char* name;
 };
 
@@ -27,23 +47,31 @@ struct mds_tags {
 };
 
 void mds_create_tags(struct mds_tags* ts);
-void mds_destroy_tags(struct mds_tags* ts);
+void mds_destroy_tags(struct mds_tags* ts, struct mds* m);
 void mds_grow_tags(
     struct mds_tags* ts,
     struct mds* m,
     mds_id old_cap[MDS_TYPES]);
+void mds_move_tags(struct mds_tags* ts, struct mds* m, int storage);
 struct mds_tag* mds_create_tag(
     struct mds_tags* ts,
     const char* name,
     int bytes,
     int user_type);
-void mds_destroy_tag(struct mds_tags* ts, struct mds_tag* t);
+void mds_destroy_tag(struct mds_tags* ts, struct mds_tag* t,
+    struct mds* m);
 void* mds_get_tag(struct mds_tag* tag, mds_id e);
 struct mds_tag* mds_find_tag(struct mds_tags* ts, const char* name);
 int mds_has_tag(struct mds_tag* tag, mds_id e);
 void mds_give_tag(struct mds_tag* tag, struct mds* m, mds_id e);
-void mds_take_tag(struct mds_tag* tag, mds_id e);
+void mds_take_tag(struct mds_tag* tag, struct mds* m, mds_id e);
+void mds_fill_tag(struct mds_tag* tag, struct mds* m, int t,
+    void const* values);
+void mds_set_tag_policy(struct mds_tag* tag, struct mds* m, int policy);
+void mds_renumber_sparse_tags(struct mds_tags* ts, int t, mds_id* new_of);
 void mds_rename_tag(struct mds_tag* tag, const char* newName);
+void mds_tags_memory(struct mds_tags* ts, struct mds* m,
+    size_t allocated[MDS_TYPES], size_t live[MDS_TYPES]);
 
 void mds_swap_tag_structs(struct mds_tags* as, struct mds_tag** a,
     struct mds_tags* bs, struct mds_tag** b);
@@ -10,10 +10,14 @@ include_directories(${CMAKE_CURRENT_BINARY_DIR})
 #Sources & Headers
 set(MDS_SOURCES
   mds.c
+  mds_csr.c
   mds_apf.c
+  mds_compact.c
+  mds_alloc.c
   mds_net.c
   mds_order.c
   mds_smb.c
+  mds_smb_raw.c
   mds_tag.c
   apfMDS.cc
   apfPM.cc
@@ -35,10 +35,15 @@ int PCU_Comm_Peers(void);
 
 /*recommended message passing API*/
 void PCU_Comm_Begin(void);
+void PCU_Comm_Begin_Neighbors(int const* ranks, int n);
 int PCU_Comm_Pack(int to_rank, const void* data, size_t size);
 #define PCU_COMM_PACK(to_rank,object)\
 PCU_Comm_Pack(to_rank,&(object),sizeof(object))
+void* PCU_Comm_Reserve(int to_rank, size_t count, size_t size);
+#define PCU_COMM_RESERVE(to_rank,type,count)\
+((type*)PCU_Comm_Reserve(to_rank,count,sizeof(type)))
 int PCU_Comm_Send(void);
+bool PCU_Comm_Test(void);
 bool PCU_Comm_Receive(void);
 bool PCU_Comm_Listen(void);
 int PCU_Comm_Sender(void);
@@ -51,6 +56,18 @@ PCU_Comm_Unpack(&(object),sizeof(object))
   above API on/off*/
 void PCU_Comm_Order(bool on);
 
+/*selects MPI or point-to-point collectives*/
+void PCU_Native_Collectives(bool on);
+
+/*communication profiling*/
+void PCU_Profile_Enable(const char* trace_prefix);
+void PCU_Profile_Push(const char* label);
+void PCU_Profile_Pop(void);
+
+/*limits and reports the message buffers kept between phases*/
+void PCU_Comm_Pool_Limit(size_t bytes);
+void PCU_Comm_Pool_Stats(size_t* retained, size_t* reused, size_t* missed);
+
 /*collective operations*/
 void PCU_Barrier(void);
 void PCU_Add_Doubles(double* p, size_t n);
@@ -84,6 +101,12 @@ int PCU_And(int c);
 int PCU_Proc_Self(void);
 int PCU_Proc_Peers(void);
 
+/*several threads (and parts) per process*/
+typedef void* PCU_Thrd_Func(void*);
+void PCU_Thrd_Run(int nthreads, PCU_Thrd_Func* function, void** in_out);
+int PCU_Thrd_Self(void);
+int PCU_Thrd_Peers(void);
+
 /*IPComMan replacement API*/
 int PCU_Comm_Write(int to_rank, const void* data, size_t size);
 #define PCU_COMM_WRITE(to,data) \
@@ -105,6 +128,9 @@ int PCU_Comm_Packed(int to_rank, size_t* size);
 int PCU_Comm_From(int* from_rank);
 int PCU_Comm_Received(size_t* size);
 void* PCU_Comm_Extract(size_t size);
+void* PCU_Comm_Extract_Array(size_t count, size_t size);
+#define PCU_COMM_EXTRACT(type,count)\
+((type*)PCU_Comm_Extract_Array(count,sizeof(type)))
 int PCU_Comm_Rank(int* rank);
 int PCU_Comm_Size(int* size);
 
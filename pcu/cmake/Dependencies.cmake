@@ -1,3 +1,4 @@
 TRIBITS_PACKAGE_DEFINE_DEPENDENCIES(
+  LIB_REQUIRED_PACKAGES SCOREClion
   LIB_REQUIRED_TPLS MPI
   )
@@ -35,6 +35,8 @@
 #include "pcu_msg.h"
 #include "pcu_pmpi.h"
 #include "pcu_order.h"
+#include "pcu_prof.h"
+#include "pcu_thrd.h"
 #include "noto_malloc.h"
 #include "reel.h"
 #include <sys/types.h> /*required for mode_t for mkdir on some systems*/
@@ -47,6 +49,8 @@ static pcu_msg global_pmsg;
 
 static pcu_msg* get_msg()
 {
+  if (pcu_thrd_msgs)
+    return &(pcu_thrd_msgs[pcu_thread_rank()]);
   return &global_pmsg;
 }
 
@@ -78,6 +82,11 @@ int PCU_Comm_Free(void)
 {
   if (global_state == uninit)
     reel_fail("Comm_Free called before Comm_Init");
+  if (pcu_thrd_msgs)
+    reel_fail("Comm_Free called by a thread of PCU_Thrd_Run");
+  if (pcu_prof_on)
+    pcu_prof_finish();
+  pcu_io_sync();
   if (global_pmsg.order)
     pcu_order_free(global_pmsg.order);
   pcu_free_msg(&global_pmsg);
@@ -123,7 +132,39 @@ void PCU_Comm_Begin(void)
 {
   if (global_state == uninit)
     reel_fail("Comm_Begin called before Comm_Init");
+  if (pcu_prof_on)
+    pcu_prof_begin_phase();
   pcu_msg_start(get_msg());
+  if (pcu_prof_on)
+    pcu_prof_started();
+}
+
+/** \brief Begins a PCU communication phase among known neighbors.
+  \details This is a replacement for PCU_Comm_Begin when each thread
+  knows the \a n ranks in \a ranks it will exchange messages with,
+  and thread \f$i\f$ lists \f$j\f$ exactly when \f$j\f$ lists \f$i\f$.
+  Packing for a rank that is not listed is an error.
+  The phase then proceeds as usual with PCU_Comm_Send and PCU_Comm_Listen,
+  but its end is detected by hearing once from every neighbor
+  instead of by a barrier, and it does not start with one either.
+  All threads must call this function, possibly with \a n = 0.
+*/
+void PCU_Comm_Begin_Neighbors(int const* ranks, int n)
+{
+  if (global_state == uninit)
+    reel_fail("Comm_Begin_Neighbors called before Comm_Init");
+  for (int i = 0; i < n; ++i)
+    if ((ranks[i] < 0)||(ranks[i] >= pcu_mpi_size()))
+      reel_fail("Invalid rank in Comm_Begin_Neighbors");
+  if (pcu_prof_on)
+    pcu_prof_begin_phase();
+  /* neighbor messages bypass the thread transport */
+  if (pcu_thrd_msgs)
+    pcu_msg_start(get_msg());
+  else
+    pcu_msg_start_neighbors(get_msg(), ranks, n);
+  if (pcu_prof_on)
+    pcu_prof_started();
 }
 
 /** \brief Packs data to be sent to \a to_rank.
@@ -142,6 +183,36 @@ int PCU_Comm_Pack(int to_rank, const void* data, size_t size)
   return PCU_SUCCESS;
 }
 
+/* arrays of elements of (size) bytes are aligned to the
+   largest power of two dividing it, which is a multiple of
+   the alignment of any type of that size, up to 16 bytes */
+static size_t array_alignment(size_t size)
+{
+  size_t align = size & (~size + 1);
+  if (!align || align > 16)
+    align = 16;
+  return align;
+}
+
+/** \brief Reserves space for \a count elements of \a size bytes
+  in the buffer being sent to \a to_rank.
+  \details This is a faster PCU_Comm_Pack for arrays: the receiving
+  thread is looked up once and the caller writes the elements
+  directly into the returned space, which is valid until the
+  next packing call.
+  The space is aligned for the elements, so the receiver must
+  unpack it with PCU_Comm_Extract_Array using the same \a size,
+  and may then read it in place. See also PCU_COMM_RESERVE.
+ */
+void* PCU_Comm_Reserve(int to_rank, size_t count, size_t size)
+{
+  if (global_state == uninit)
+    reel_fail("Comm_Reserve called before Comm_Init");
+  if ((to_rank < 0)||(to_rank >= pcu_mpi_size()))
+    reel_fail("Invalid rank in Comm_Reserve");
+  return pcu_msg_reserve(get_msg(),to_rank,count*size,array_alignment(size));
+}
+
 /** \brief Sends all buffers for this communication phase.
   \details This function should be called by all threads in the MPI job
   after calls to PCU_Comm_Pack or PCU_Comm_Write and before calls
@@ -153,10 +224,37 @@ int PCU_Comm_Send(void)
 {
   if (global_state == uninit)
     reel_fail("Comm_Send called before Comm_Init");
+  if (pcu_prof_on) {
+    size_t peers, bytes;
+    pcu_msg_sending(get_msg(), &peers, &bytes);
+    pcu_prof_sent(peers, bytes);
+  }
   pcu_msg_send(get_msg());
   return PCU_SUCCESS;
 }
 
+/** \brief Makes progress on this communication phase without blocking.
+  \details This may be called any number of times after PCU_Comm_Send
+  and before the first call to PCU_Comm_Listen or PCU_Comm_Receive,
+  typically between pieces of local work that do not depend on the
+  messages of this phase.
+  Messages that have arrived are received and kept until
+  PCU_Comm_Listen hands them out.
+  The result is true once this thread has received all the messages
+  of this phase, after which PCU_Comm_Listen will not wait.
+ */
+bool PCU_Comm_Test(void)
+{
+  if (global_state == uninit)
+    reel_fail("Comm_Test called before Comm_Init");
+  if (!pcu_prof_on)
+    return pcu_msg_test(get_msg());
+  double t0 = PCU_Time();
+  bool done = pcu_msg_test(get_msg());
+  pcu_prof_wait(t0);
+  return done;
+}
+
 /** \brief Tries to receive a buffer for this communication phase.
   \details Either this function or PCU_Comm_Read should be called at least
   once by all threads during the communication phase, after PCU_Comm_Send
@@ -168,14 +266,31 @@ int PCU_Comm_Send(void)
   Users should unpack all data from this buffer before calling this function
   again, because the previously received buffer is destroyed by the call.
  */
+static bool listen(pcu_msg* m)
+{
+  if (m->order)
+    return pcu_order_receive(m->order, m);
+  return pcu_msg_receive(m);
+}
+
 bool PCU_Comm_Listen(void)
 {
   if (global_state == uninit)
     reel_fail("Comm_Listen called before Comm_Init");
   pcu_msg* m = get_msg();
-  if (m->order)
-    return pcu_order_receive(m->order, m);
-  return pcu_msg_receive(m);
+  if (!pcu_prof_on)
+    return listen(m);
+  double t0 = PCU_Time();
+  bool received = listen(m);
+  pcu_prof_wait(t0);
+  if (!received) {
+    pcu_prof_end_phase();
+    return false;
+  }
+  size_t size;
+  PCU_Comm_Received(&size);
+  pcu_prof_received(size);
+  return true;
 }
 
 /** \brief Returns in * \a from_rank the sender of the current received buffer.
@@ -239,12 +354,64 @@ void PCU_Comm_Order(bool on)
   }
 }
 
+/** \brief Sets how many bytes of message buffers PCU keeps between phases.
+  \details Send and receive buffers are returned to a pool at the end
+  of each phase and reused by the following ones.
+  The pool keeps at most \a bytes (64MB by default), any excess
+  is freed immediately. Zero disables the pool.
+*/
+void PCU_Comm_Pool_Limit(size_t bytes)
+{
+  if (global_state == uninit)
+    reel_fail("Comm_Pool_Limit called before Comm_Init");
+  pcu_pool_limit(&(get_msg()->pool),bytes);
+}
+
+/** \brief Reports the state of the message buffer pool of this thread.
+  \details \a retained is the number of bytes the pool holds now,
+  \a reused the number of buffers it handed out and
+  \a missed the number of times it had none to give.
+  Any of them may be NULL.
+*/
+void PCU_Comm_Pool_Stats(size_t* retained, size_t* reused, size_t* missed)
+{
+  if (global_state == uninit)
+    reel_fail("Comm_Pool_Stats called before Comm_Init");
+  pcu_pool* p = &(get_msg()->pool);
+  if (retained)
+    *retained = p->retained;
+  if (reused)
+    *reused = p->hits;
+  if (missed)
+    *missed = p->misses;
+}
+
+/** \brief Chooses how PCU implements its collectives.
+  \details If \a on (the default), the reductions, scans and barriers
+  below call the MPI collectives, which are usually tuned for the
+  network and may be offloaded to it.
+  Otherwise they use PCU's own binary tree patterns
+  of point-to-point messages.
+  This must be called by all ranks with the same value.
+*/
+void PCU_Native_Collectives(bool on)
+{
+  if (global_state == uninit)
+    reel_fail("Native_Collectives called before Comm_Init");
+  if (pcu_thrd_msgs)
+    reel_fail("Native_Collectives called by a thread of PCU_Thrd_Run");
+  pcu_coll_native = on;
+}
+
 /** \brief Blocking barrier over all threads. */
 void PCU_Barrier(void)
 {
   if (global_state == uninit)
     reel_fail("Barrier called before Comm_Init");
+  double t0 = pcu_prof_on ? PCU_Time() : 0;
   pcu_barrier(&(get_msg()->coll));
+  if (pcu_prof_on)
+    pcu_prof_collective(t0);
 }
 
 /** \brief Performs an Allreduce sum of double arrays.
@@ -502,6 +669,45 @@ int PCU_Proc_Peers(void)
   return pcu_pmpi_size();
 }
 
+/** \brief Runs \a function in \a nthreads threads of each process.
+  \details This must be called by all processes with the same
+  \a nthreads, outside of any communication phase.
+  While the threads run, each of them is a PCU rank of its own:
+  PCU_Comm_Self and PCU_Comm_Peers count threads as described there,
+  and all phases and collectives involve every thread, so that each
+  thread can own a part of a distributed mesh.
+  Messages between threads of the same process are copied directly
+  from the sender's buffer to the receiver's instead of going
+  through MPI. Messages to other processes need MPI to have been
+  initialized with MPI_THREAD_MULTIPLE.
+  Collectives use PCU's point-to-point patterns
+  and neighbor phases become regular phases.
+  The calling thread runs as thread 0. Thread \f$i\f$ is given
+  \a in_out[i] and its return value replaces it.
+*/
+void PCU_Thrd_Run(int nthreads, PCU_Thrd_Func* function, void** in_out)
+{
+  if (global_state == uninit)
+    reel_fail("Thrd_Run called before Comm_Init");
+  pcu_thrd_run(nthreads, function, in_out, global_pmsg.order != NULL);
+}
+
+/** \brief Returns the rank of the calling thread within its process.
+  \details This is zero outside of PCU_Thrd_Run.
+ */
+int PCU_Thrd_Self(void)
+{
+  return pcu_thread_rank();
+}
+
+/** \brief Returns the number of threads per process.
+  \details This is one outside of PCU_Thrd_Run.
+ */
+int PCU_Thrd_Peers(void)
+{
+  return pcu_thread_size();
+}
+
 /** \brief Similar to PCU_Comm_Self, returns the rank as an argument.
  */
 int PCU_Comm_Rank(int* rank)
@@ -534,7 +740,11 @@ int PCU_Comm_Start(PCU_Method method)
   (void)method; //warning silencer
   if (global_state == uninit)
     reel_fail("Comm_Start called before Comm_Init");
+  if (pcu_prof_on)
+    pcu_prof_begin_phase();
   pcu_msg_start(get_msg());
+  if (pcu_prof_on)
+    pcu_prof_started();
   return PCU_SUCCESS;
 }
 
@@ -697,6 +907,24 @@ int PCU_Comm_Received(size_t* size)
   return PCU_SUCCESS;
 }
 
+/** \brief Unpacks an array packed by PCU_Comm_Reserve.
+  \details Returns a pointer to the \a count elements of \a size bytes
+  in the current received buffer, aligned for their type,
+  so they can be read without copying them out.
+  The pointer is valid until the next PCU_Comm_Receive.
+  See also PCU_COMM_EXTRACT.
+ */
+void* PCU_Comm_Extract_Array(size_t count, size_t size)
+{
+  if (global_state == uninit)
+    reel_fail("Comm_Extract_Array called before Comm_Init");
+  pcu_msg* m = get_msg();
+  size_t align = array_alignment(size);
+  if (m->order)
+    return pcu_order_extract(m->order,count*size,align);
+  return pcu_msg_extract(m,count*size,align);
+}
+
 /** \brief Extracts a block of data from the current received buffer.
   \details This function should be called after a successful PCU_Comm_Receive.
   The next \a size bytes of the current received buffer are unpacked,
@@ -724,6 +952,8 @@ void PCU_Switch_Comm(MPI_Comm new_comm)
 {
   if (global_state == uninit)
     reel_fail("Switch_Comm called before Comm_Init");
+  if (pcu_thrd_msgs)
+    reel_fail("Switch_Comm called by a thread of PCU_Thrd_Run");
   pcu_pmpi_switch(new_comm);
 }
 
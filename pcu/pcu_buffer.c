@@ -8,6 +8,7 @@
 
 *******************************************************************************/
 #include <stdlib.h>
+#include <string.h>
 #include "pcu_buffer.h"
 #include "noto_malloc.h"
 #include "reel.h"
@@ -17,6 +18,7 @@ void pcu_make_buffer(pcu_buffer* b)
   b->start = NULL;
   b->size = 0;
   b->capacity = 0;
+  b->allocated = 0;
 }
 
 void pcu_free_buffer(pcu_buffer* b)
@@ -34,7 +36,11 @@ void* pcu_push_buffer(pcu_buffer* b, size_t size)
     b->capacity = b->size;
     if (min_growth > b->capacity)
       b->capacity = min_growth;
-    b->start = noto_realloc(b->start, b->capacity);
+    if (b->capacity > b->allocated)
+    {
+      b->start = noto_realloc(b->start, b->capacity);
+      b->allocated = b->capacity;
+    }
   }
   return b->start + b->size - size;
 }
@@ -53,6 +59,28 @@ void* pcu_walk_buffer(pcu_buffer* b, size_t size)
   return at;
 }
 
+/* the bytes that bring the buffer size to a multiple of align,
+   so that data pushed after them is aligned if the buffer
+   start is, and walking finds it at the same place */
+static size_t padding(pcu_buffer* b, size_t align)
+{
+  return (align - b->size % align) % align;
+}
+
+void* pcu_push_aligned(pcu_buffer* b, size_t size, size_t align)
+{
+  size_t pad = padding(b, align);
+  char* at = pcu_push_buffer(b, pad + size);
+  memset(at, 0, pad);
+  return at + pad;
+}
+
+void* pcu_walk_aligned(pcu_buffer* b, size_t size, size_t align)
+{
+  size_t pad = padding(b, align);
+  return (char*)pcu_walk_buffer(b, pad + size) + pad;
+}
+
 bool pcu_buffer_walked(pcu_buffer* b)
 {
   return b->size == b->capacity;
@@ -60,14 +88,15 @@ bool pcu_buffer_walked(pcu_buffer* b)
 
 void pcu_resize_buffer(pcu_buffer* b, size_t size)
 {
-  if (b->size == size && b->capacity == size) return;
   b->size = b->capacity = size;
+  if (size <= b->allocated) return;
   b->start = noto_realloc(b->start,size);
+  b->allocated = size;
 }
 
 void pcu_set_buffer(pcu_buffer* b, void* p, size_t size)
 {
   b->start = p;
-  b->size = b->capacity = size;
+  b->size = b->capacity = b->allocated = size;
 }
 
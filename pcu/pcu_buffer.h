@@ -18,6 +18,7 @@ typedef struct
   char* start;
   size_t size;
   size_t capacity;
+  size_t allocated;
 } pcu_buffer;
 
 void pcu_make_buffer(pcu_buffer* b);
@@ -25,6 +26,8 @@ void pcu_free_buffer(pcu_buffer* b);
 void* pcu_push_buffer(pcu_buffer* b, size_t size);
 void pcu_begin_buffer(pcu_buffer* b);
 void* pcu_walk_buffer(pcu_buffer* b, size_t size);
+void* pcu_push_aligned(pcu_buffer* b, size_t size, size_t align);
+void* pcu_walk_aligned(pcu_buffer* b, size_t size, size_t align);
 bool pcu_buffer_walked(pcu_buffer* b);
 void pcu_resize_buffer(pcu_buffer* b, size_t size);
 void pcu_set_buffer(pcu_buffer* b, void* p, size_t size);
@@ -9,12 +9,15 @@
 *******************************************************************************/
 #include "pcu_coll.h"
 #include "pcu_pmpi.h"
+#include "pcu_prof.h"
 #include "reel.h"
 #include <string.h>
 
 #define MIN(a,b) (((b)<(a))?(b):(a))
 #define MAX(a,b) (((b)>(a))?(b):(a))
 
+bool pcu_coll_native = true;
+
 static int floor_log2(int n)
 {
   int r = 0;
@@ -124,6 +127,42 @@ void pcu_add_longs(void* local, void* incoming, size_t size)
     a[i] += b[i];
 }
 
+/* finds the MPI equivalent of a merge, if it has one */
+static bool get_native(pcu_merge* m, size_t size,
+    MPI_Datatype* type, MPI_Op* op, int* count)
+{
+  MPI_Datatype sizet = sizeof(size_t) == sizeof(unsigned long) ?
+    MPI_UNSIGNED_LONG : MPI_UNSIGNED_LONG_LONG;
+  static struct {
+    pcu_merge* merge;
+    int type;
+    int op;
+  } const table[] = {
+    {pcu_add_doubles, 0, 0},
+    {pcu_min_doubles, 0, 1},
+    {pcu_max_doubles, 0, 2},
+    {pcu_add_ints, 1, 0},
+    {pcu_min_ints, 1, 1},
+    {pcu_max_ints, 1, 2},
+    {pcu_add_longs, 2, 0},
+    {pcu_add_sizets, 3, 0},
+    {pcu_min_sizets, 3, 1},
+    {pcu_max_sizets, 3, 2}
+  };
+  MPI_Datatype const types[4] = {MPI_DOUBLE, MPI_INT, MPI_LONG, sizet};
+  size_t const sizes[4] = {sizeof(double), sizeof(int), sizeof(long),
+    sizeof(size_t)};
+  MPI_Op const ops[3] = {MPI_SUM, MPI_MIN, MPI_MAX};
+  for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); ++i)
+    if (table[i].merge == m) {
+      *type = types[table[i].type];
+      *op = ops[table[i].op];
+      *count = (int)(size / sizes[table[i].type]);
+      return true;
+    }
+  return false;
+}
+
 /* initiates non-blocking calls for this
    communication step */
 static void begin_coll_step(pcu_coll* c)
@@ -462,29 +501,62 @@ void pcu_bcast(pcu_coll* c, void* data, size_t size)
 
 void pcu_allreduce(pcu_coll* c, pcu_merge* m, void* data, size_t size)
 {
-  pcu_reduce(c,m,data,size);
-  pcu_bcast(c,data,size);
+  double t0 = pcu_prof_on ? MPI_Wtime() : 0;
+  MPI_Datatype type;
+  MPI_Op op;
+  int count;
+  if (pcu_coll_native && get_native(m, size, &type, &op, &count))
+    MPI_Allreduce(MPI_IN_PLACE, data, count, type, op, pcu_coll_comm);
+  else {
+    pcu_reduce(c,m,data,size);
+    pcu_bcast(c,data,size);
+  }
+  if (pcu_prof_on)
+    pcu_prof_collective(t0);
 }
 
 void pcu_scan(pcu_coll* c, pcu_merge* m, void* data, size_t size)
 {
-  pcu_make_coll(c,&scan_up,m);
-  pcu_begin_coll(c,data,size);
-  while(pcu_progress_coll(c));
-  pcu_make_coll(c,&scan_down,m);
-  pcu_begin_coll(c,data,size);
-  while(pcu_progress_coll(c));
+  double t0 = pcu_prof_on ? MPI_Wtime() : 0;
+  MPI_Datatype type;
+  MPI_Op op;
+  int count;
+  if (pcu_coll_native && get_native(m, size, &type, &op, &count))
+    MPI_Scan(MPI_IN_PLACE, data, count, type, op, pcu_coll_comm);
+  else {
+    pcu_make_coll(c,&scan_up,m);
+    pcu_begin_coll(c,data,size);
+    while(pcu_progress_coll(c));
+    pcu_make_coll(c,&scan_down,m);
+    pcu_begin_coll(c,data,size);
+    while(pcu_progress_coll(c));
+  }
+  if (pcu_prof_on)
+    pcu_prof_collective(t0);
 }
 
 /* a barrier is just an allreduce of nothing in particular */
 void pcu_begin_barrier(pcu_coll* c)
 {
+#if MPI_VERSION >= 3
+  if (pcu_coll_native) {
+    c->pattern = NULL;
+    MPI_Ibarrier(pcu_coll_comm,&(c->request));
+    return;
+  }
+#endif
   pcu_make_coll(c,&reduce,pcu_merge_assign);
   pcu_begin_coll(c,NULL,0);
 }
 
 bool pcu_barrier_done(pcu_coll* c)
 {
+  if ( ! c->pattern)
+  {
+    int flag;
+    MPI_Test(&(c->request),&flag,MPI_STATUS_IGNORE);
+    return flag;
+  }
   if (c->pattern == &reduce)
     if ( ! pcu_progress_coll(c))
     {
@@ -499,6 +571,10 @@ bool pcu_barrier_done(pcu_coll* c)
 
 void pcu_barrier(pcu_coll* c)
 {
+  if (pcu_coll_native) {
+    MPI_Barrier(pcu_coll_comm);
+    return;
+  }
   pcu_begin_barrier(c);
   while( ! pcu_barrier_done(c));
 }
@@ -21,6 +21,12 @@
    Because all communication uses the pcu_mpi primitives, the
    system works in hybrid mode as well. */
 
+/* When pcu_coll_native is true (the default), reductions, scans
+   and barriers whose merge has an MPI equivalent call the MPI
+   collectives instead, which most implementations tune for the
+   network. All ranks must agree on its value. */
+extern bool pcu_coll_native;
+
 /* The pcu_merge is the equivalent of the MPI_Op.
    arguments are usually arrays of some type,
    and the operations is sum, min, max, etc. */
@@ -71,6 +77,7 @@ typedef struct
   pcu_merge* merge; //merge operation
   pcu_message message; //local data being operated on
   int bit; //pattern's state bit
+  MPI_Request request; //native non-blocking barrier, if pattern is NULL
 } pcu_coll;
 
 void pcu_make_coll(pcu_coll* c, pcu_pattern* p, pcu_merge* m);
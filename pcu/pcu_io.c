@@ -18,11 +18,40 @@
 #include "pcu_util.h"
 #include <sys/types.h>
 #include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#define PCU_MMAP
+#include <sys/mman.h>
+#endif
 
 #ifdef PCU_BZIP
 #include <bzlib.h>
 #endif
 
+/* blocks a background writer may hold besides the one being filled */
+enum { WRITER_DEPTH = 4 };
+/* closed files whose writers may still be running before
+   pcu_fclose waits for the oldest one */
+enum { MAX_CLOSING = 8 };
+
+/* the queue between a file and the thread that drains its blocks */
+typedef struct pcu_writer {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t filled;
+  pthread_cond_t drained;
+  char* queue[WRITER_DEPTH];
+  size_t sizes[WRITER_DEPTH];
+  int head;
+  int queued;
+  char* spare[WRITER_DEPTH];
+  int spares;
+  bool closing;
+  bool done;
+  struct pcu_file* next;
+} pcu_writer;
+
 typedef struct pcu_file {
   FILE* f;
 #ifdef PCU_BZIP
@@ -30,8 +59,28 @@ typedef struct pcu_file {
 #endif
   bool write;
   bool compress;
+  bool in_memory;
+  size_t pos;
+  void* map;
+  size_t map_size;
+  char* block;
+  size_t block_size;
+  size_t block_used;
+  pcu_writer* writer;
+  char* path;
+  struct pcu_io_stats stats;
 } pcu_file;
 
+static size_t global_block_size = 1 << 20;
+static bool global_background = false;
+
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pcu_io_stats global_stats;
+/* files closed in the background whose threads are not joined yet,
+   newest first */
+static pcu_file* global_closing = NULL;
+static size_t global_pending = 0;
+
 #ifdef PCU_BZIP
 
 static void open_compressed_read(pcu_file* pf)
@@ -150,6 +199,284 @@ static void close_compressed(pcu_file* pf)
 
 #endif
 
+/* writer threads may not call MPI, so they time themselves */
+static double io_time(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void write_block(pcu_file* pf, void const* p, size_t n)
+{
+  double t0 = io_time();
+  if (pf->compress) {
+    compressed_write(pf, p, n);
+  } else {
+    if (n != fwrite(p, 1, n, pf->f))
+      reel_fail("fwrite(%p, 1, %lu, %p) failed", p, n, (void*) pf->f);
+  }
+  pf->stats.write_seconds += io_time() - t0;
+  ++pf->stats.blocks;
+}
+
+static void finish_file(pcu_file* pf)
+{
+  if (pf->compress)
+    close_compressed(pf);
+  fclose(pf->f);
+}
+
+static void* drain(void* arg)
+{
+  pcu_file* pf = arg;
+  pcu_writer* w = pf->writer;
+  char* block;
+  size_t size;
+  pthread_mutex_lock(&w->lock);
+  while (1) {
+    while (!w->queued && !w->closing)
+      pthread_cond_wait(&w->filled, &w->lock);
+    if (!w->queued)
+      break;
+    block = w->queue[w->head];
+    size = w->sizes[w->head];
+    pthread_mutex_unlock(&w->lock);
+    write_block(pf, block, size);
+    pthread_mutex_lock(&w->lock);
+    w->head = (w->head + 1) % WRITER_DEPTH;
+    --w->queued;
+    w->spare[w->spares++] = block;
+    pthread_cond_signal(&w->drained);
+  }
+  pthread_mutex_unlock(&w->lock);
+  finish_file(pf);
+  pthread_mutex_lock(&w->lock);
+  w->done = true;
+  pthread_mutex_unlock(&w->lock);
+  return NULL;
+}
+
+static void start_writer(pcu_file* pf)
+{
+  pcu_writer* w = noto_malloc(sizeof(pcu_writer));
+  w->head = 0;
+  w->queued = 0;
+  w->spares = 0;
+  w->closing = false;
+  w->done = false;
+  w->next = NULL;
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->filled, NULL);
+  pthread_cond_init(&w->drained, NULL);
+  pf->writer = w;
+  if (pthread_create(&w->thread, NULL, drain, pf))
+    reel_fail("pcu_fopen: could not start a writer thread");
+}
+
+/* queues the full block and returns an empty one. there are at most
+   WRITER_DEPTH + 1 blocks, so once the queue has room a spare block
+   exists or one more may be allocated */
+static char* swap_block(pcu_file* pf, char* full, size_t size)
+{
+  pcu_writer* w = pf->writer;
+  char* empty = NULL;
+  double t0 = io_time();
+  pthread_mutex_lock(&w->lock);
+  while (w->queued == WRITER_DEPTH)
+    pthread_cond_wait(&w->drained, &w->lock);
+  w->queue[(w->head + w->queued) % WRITER_DEPTH] = full;
+  w->sizes[(w->head + w->queued) % WRITER_DEPTH] = size;
+  ++w->queued;
+  pthread_cond_signal(&w->filled);
+  if (w->spares)
+    empty = w->spare[--w->spares];
+  pthread_mutex_unlock(&w->lock);
+  pf->stats.wait_seconds += io_time() - t0;
+  if (!empty)
+    empty = noto_malloc(pf->block_size);
+  return empty;
+}
+
+static void flush_block(pcu_file* pf)
+{
+  if (!pf->block_used)
+    return;
+  if (pf->writer)
+    pf->block = swap_block(pf, pf->block, pf->block_used);
+  else
+    write_block(pf, pf->block, pf->block_used);
+  pf->block_used = 0;
+}
+
+static void buffer_write(pcu_file* pf, void const* p, size_t n)
+{
+  char const* c = p;
+  size_t k;
+  /* without a writer, large records skip the copy */
+  if (!pf->writer && !pf->block_used && n >= pf->block_size) {
+    write_block(pf, p, n);
+    return;
+  }
+  while (n) {
+    if (pf->block_used == pf->block_size)
+      flush_block(pf);
+    k = pf->block_size - pf->block_used;
+    if (k > n)
+      k = n;
+    memcpy(pf->block + pf->block_used, c, k);
+    pf->block_used += k;
+    c += k;
+    n -= k;
+  }
+}
+
+static void swap_bytes(char* p, size_t size, size_t n)
+{
+  size_t i, j;
+  char t;
+  for (i = 0; i < n; ++i, p += size)
+    for (j = 0; j < size / 2; ++j) {
+      t = p[j];
+      p[j] = p[size - 1 - j];
+      p[size - 1 - j] = t;
+    }
+}
+
+/* copies the values into the block and swaps them in place there,
+   rather than swapping a temporary copy of the whole array */
+static void buffer_write_swapped(pcu_file* pf, void const* p,
+    size_t size, size_t n)
+{
+  char const* c = p;
+  size_t k;
+  while (n) {
+    if (pf->block_size - pf->block_used < size)
+      flush_block(pf);
+    k = (pf->block_size - pf->block_used) / size;
+    if (k > n)
+      k = n;
+    memcpy(pf->block + pf->block_used, c, k * size);
+    swap_bytes(pf->block + pf->block_used, size, k);
+    pf->block_used += k * size;
+    c += k * size;
+    n -= k;
+  }
+}
+
+static void add_stats(pcu_file* pf)
+{
+  pthread_mutex_lock(&global_lock);
+  ++global_stats.files;
+  global_stats.bytes += pf->pos;
+  global_stats.blocks += pf->stats.blocks;
+  global_stats.write_seconds += pf->stats.write_seconds;
+  global_stats.wait_seconds += pf->stats.wait_seconds;
+  pthread_mutex_unlock(&global_lock);
+}
+
+static void free_file(pcu_file* pf)
+{
+  pcu_writer* w = pf->writer;
+  int i;
+  if (w) {
+    for (i = 0; i < w->spares; ++i)
+      noto_free(w->spare[i]);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->filled);
+    pthread_cond_destroy(&w->drained);
+    noto_free(w);
+  }
+  noto_free(pf->block);
+  noto_free(pf->path);
+  free(pf);
+}
+
+void pcu_io_write_behind(size_t block_size, bool background)
+{
+  if (block_size && block_size < 64)
+    block_size = 64;
+  pthread_mutex_lock(&global_lock);
+  global_block_size = block_size;
+  global_background = background && block_size;
+  pthread_mutex_unlock(&global_lock);
+}
+
+static bool is_done(pcu_file* pf)
+{
+  pcu_writer* w = pf->writer;
+  bool done;
+  pthread_mutex_lock(&w->lock);
+  done = w->done;
+  pthread_mutex_unlock(&w->lock);
+  return done;
+}
+
+/* joins and frees the closed files whose writers are done, then the
+   oldest ones until at most (limit) are left running */
+static void reap(size_t limit)
+{
+  pcu_file** link;
+  pcu_file* pf;
+  pcu_file* reaped = NULL;
+  double t0;
+  pthread_mutex_lock(&global_lock);
+  link = &global_closing;
+  while ((pf = *link)) {
+    if (is_done(pf)) {
+      *link = pf->writer->next;
+      pf->writer->next = reaped;
+      reaped = pf;
+      --global_pending;
+    } else {
+      link = &pf->writer->next;
+    }
+  }
+  while (global_pending > limit) {
+    link = &global_closing;
+    while ((*link)->writer->next)
+      link = &(*link)->writer->next;
+    pf = *link;
+    *link = NULL;
+    pf->writer->next = reaped;
+    reaped = pf;
+    --global_pending;
+  }
+  pthread_mutex_unlock(&global_lock);
+  while ((pf = reaped)) {
+    reaped = pf->writer->next;
+    t0 = io_time();
+    pthread_join(pf->writer->thread, NULL);
+    pf->stats.wait_seconds += io_time() - t0;
+    add_stats(pf);
+    free_file(pf);
+  }
+}
+
+void pcu_io_sync(void)
+{
+  reap(0);
+}
+
+static bool is_closing(const char* path)
+{
+  pcu_file* pf;
+  bool found = false;
+  pthread_mutex_lock(&global_lock);
+  for (pf = global_closing; pf && !found; pf = pf->writer->next)
+    found = !strcmp(pf->path, path);
+  pthread_mutex_unlock(&global_lock);
+  return found;
+}
+
+void pcu_io_get_stats(struct pcu_io_stats* s)
+{
+  pthread_mutex_lock(&global_lock);
+  *s = global_stats;
+  s->pending = global_pending;
+  pthread_mutex_unlock(&global_lock);
+}
+
 /**
  * brief limit the number of ranks that can call fopen simultaneously
  * remark Argonne's GPFS filesystem is failing to open some files when
@@ -181,11 +508,24 @@ FILE* pcu_group_open(const char* path, bool write) {
   return fp;
 }
 
-pcu_file* pcu_fopen(const char* name, bool write, bool compress)
+static pcu_file* make_file(bool write, bool compress, bool in_memory)
 {
-  pcu_file* pf = (pcu_file*) malloc(sizeof(pcu_file));
+  pcu_file* pf = (pcu_file*) calloc(1, sizeof(pcu_file));
   pf->compress = compress;
   pf->write = write;
+  pf->in_memory = in_memory;
+  return pf;
+}
+
+pcu_file* pcu_fopen(const char* name, bool write, bool compress)
+{
+  pcu_file* pf = make_file(write, compress, false);
+  bool background;
+  /* files written in the background may be read back or rewritten */
+  if (!write || is_closing(name))
+    pcu_io_sync();
+  else
+    reap(MAX_CLOSING);
   pf->f = pcu_group_open(name, write);
   if (!pf->f) {
     perror("pcu_fopen");
@@ -193,27 +533,82 @@ pcu_file* pcu_fopen(const char* name, bool write, bool compress)
   }
   if(compress)
     open_compressed(pf);
+  if (write) {
+    pthread_mutex_lock(&global_lock);
+    pf->block_size = global_block_size;
+    background = global_background;
+    pthread_mutex_unlock(&global_lock);
+    if (pf->block_size)
+      pf->block = noto_malloc(pf->block_size);
+    if (background) {
+      pf->path = noto_malloc(strlen(name) + 1);
+      strcpy(pf->path, name);
+      start_writer(pf);
+    }
+  }
+  return pf;
+}
+
+pcu_file* pcu_fopen_memory(void const* data, size_t size)
+{
+  pcu_file* pf = make_file(false, false, true);
+  pf->map = (void*)data;
+  pf->map_size = size;
+  pf->f = fmemopen((void*)data, size, "r");
+  if (!pf->f)
+    reel_fail("pcu_fopen_memory couldn't open %lu bytes",
+        (unsigned long)size);
+  return pf;
+}
+
+pcu_file* pcu_fopen_buffer(char** data, size_t* size)
+{
+  pcu_file* pf = make_file(true, false, true);
+  pf->f = open_memstream(data, size);
+  if (!pf->f)
+    reel_fail("pcu_fopen_buffer couldn't open a memory stream");
   return pf;
 }
 
 void pcu_fclose(pcu_file* pf)
 {
-  if (pf->compress)
-    close_compressed(pf);
-  fclose(pf->f);
-  free(pf);
+  pcu_writer* w = pf->writer;
+#ifdef PCU_MMAP
+  if (pf->map && !pf->in_memory)
+    munmap(pf->map, pf->map_size);
+#endif
+  if (pf->block)
+    flush_block(pf);
+  if (w) {
+    /* the writer finishes the file, a later open or close
+       collects it once it is done */
+    pthread_mutex_lock(&w->lock);
+    w->closing = true;
+    pthread_cond_signal(&w->filled);
+    pthread_mutex_unlock(&w->lock);
+    pthread_mutex_lock(&global_lock);
+    w->next = global_closing;
+    global_closing = pf;
+    ++global_pending;
+    pthread_mutex_unlock(&global_lock);
+    reap(MAX_CLOSING);
+    return;
+  }
+  finish_file(pf);
+  if (pf->write && !pf->in_memory)
+    add_stats(pf);
+  free_file(pf);
 }
 
 void pcu_fwrite(void const* p, size_t size, size_t nmemb, pcu_file * f)
 {
   if (!f->write)
     reel_fail("pcu_fwrite: file not opened for writing.");
-  if (f->compress) {
-    compressed_write(f, p, size * nmemb);
-  } else {
-    if (nmemb != fwrite(p, size, nmemb, f->f))
-      reel_fail("fwrite(%p, %lu, %lu, %p) failed", p, size, nmemb, (void*) f->f);
-  }
+  if (f->block)
+    buffer_write(f, p, size * nmemb);
+  else
+    write_block(f, p, size * nmemb);
+  f->pos += size * nmemb;
 }
 
 void pcu_fread(void* p, size_t size, size_t nmemb, pcu_file * f)
@@ -226,62 +621,101 @@ void pcu_fread(void* p, size_t size, size_t nmemb, pcu_file * f)
     if (nmemb != fread(p, size, nmemb, f->f))
       reel_fail("fread(%p, %lu, %lu, %p) failed", p, size, nmemb, (void*) f->f);
   }
+  f->pos += size * nmemb;
 }
 
-void pcu_read(pcu_file* f, char* p, size_t n)
+size_t pcu_ftell(pcu_file* f)
 {
-  pcu_fread(p,1,n,f);
+  return f->pos;
 }
 
-void pcu_write(pcu_file* f, const char* p, size_t n)
+#ifdef PCU_MMAP
+static void map_file(pcu_file* f)
 {
-  pcu_fwrite(p,1,n,f);
+  long size;
+  void* p;
+  if (fseek(f->f, 0, SEEK_END))
+    return;
+  size = ftell(f->f);
+  if (fseek(f->f, (long)f->pos, SEEK_SET))
+    reel_fail("pcu_fview: could not seek back to %lu",
+        (unsigned long)f->pos);
+  if (size <= 0)
+    return;
+  p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f->f), 0);
+  if (p == MAP_FAILED)
+    return;
+  f->map = p;
+  f->map_size = size;
 }
+#endif
 
-static const uint16_t pcu_endian_value = 1;
-#define PCU_ENDIANNESS ((*((uint8_t*)(&pcu_endian_value)))==1)
-#define PCU_BIG_ENDIAN 0
-#define PCU_ENCODED_ENDIAN PCU_BIG_ENDIAN //consistent with network byte order
+void const* pcu_fview(pcu_file* f, size_t n)
+{
+  char const* p;
+  if (f->write || f->compress)
+    return NULL;
+#ifdef PCU_MMAP
+  if (!f->map)
+    map_file(f);
+#endif
+  if (!f->map || f->pos + n > f->map_size)
+    return NULL;
+  p = (char const*)f->map + f->pos;
+  f->pos += n;
+  if (fseek(f->f, (long)f->pos, SEEK_SET))
+    reel_fail("pcu_fview: could not seek to %lu", (unsigned long)f->pos);
+  return p;
+}
 
-static void pcu_swap_16(uint16_t* p)
+void pcu_fskip(pcu_file* f, size_t n)
 {
-  uint8_t* p2 = (uint8_t*)p;
-  uint8_t temp = p2[0];
-  p2[0] = p2[1];
-  p2[1] = temp;
+  char buf[4096];
+  size_t k;
+  if (f->write)
+    reel_fail("pcu_fskip: file not opened for reading.");
+  if (!f->compress) {
+    if (fseek(f->f, (long)(f->pos + n), SEEK_SET))
+      reel_fail("pcu_fskip: could not seek to %lu",
+          (unsigned long)(f->pos + n));
+    f->pos += n;
+    return;
+  }
+  while (n) {
+    k = n < sizeof(buf) ? n : sizeof(buf);
+    pcu_fread(buf, 1, k, f);
+    n -= k;
+  }
 }
 
-static void pcu_swap_32(uint32_t* p)
+void pcu_read(pcu_file* f, char* p, size_t n)
 {
-  uint16_t* p2 = (uint16_t*)p;
-  uint16_t temp = p2[0];
-  p2[0] = p2[1];
-  p2[1] = temp;
-  pcu_swap_16(p2);
-  pcu_swap_16(p2+1);
+  pcu_fread(p,1,n,f);
 }
 
-static void pcu_swap_64(uint32_t* p)
+void pcu_write(pcu_file* f, const char* p, size_t n)
 {
-  uint32_t temp = p[0];
-  p[0] = p[1];
-  p[1] = temp;
-  pcu_swap_32(p);
-  pcu_swap_32(p+1);
+  pcu_fwrite(p,1,n,f);
 }
 
+static const uint16_t pcu_endian_value = 1;
+#define PCU_ENDIANNESS ((*((uint8_t*)(&pcu_endian_value)))==1)
+#define PCU_BIG_ENDIAN 0
+#define PCU_ENCODED_ENDIAN PCU_BIG_ENDIAN //consistent with network byte order
+
+/* the words are swapped a byte at a time, since reaching into
+   a double through narrower integer pointers breaks aliasing rules
+   and optimizing compilers may then skip the swap */
 void pcu_swap_unsigneds(unsigned* p, size_t n)
 {
   PCU_ALWAYS_ASSERT(sizeof(unsigned)==4);
-  for (size_t i=0; i < n; ++i)
-    pcu_swap_32(p++);
+  swap_bytes((char*)p, sizeof(unsigned), n);
 }
 
 void pcu_swap_doubles(double* p, size_t n)
 {
   PCU_ALWAYS_ASSERT(sizeof(double)==8);
-  for (size_t i=0; i < n; ++i)
-    pcu_swap_64((uint32_t*)(p++));
+  swap_bytes((char*)p, sizeof(double), n);
 }
 
 void pcu_write_unsigneds(pcu_file* f, unsigned* p, size_t n)
@@ -289,7 +723,10 @@ void pcu_write_unsigneds(pcu_file* f, unsigned* p, size_t n)
   unsigned* tmp;
   if (n)
     PCU_ALWAYS_ASSERT(p != 0);
-  if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN) {
+  if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN && f->block) {
+    buffer_write_swapped(f, p, sizeof(unsigned), n);
+    f->pos += n * sizeof(unsigned);
+  } else if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN) {
     tmp = malloc(n * sizeof(unsigned));
     memcpy(tmp, p, n * sizeof(unsigned));
     pcu_swap_unsigneds(tmp, n);
@@ -305,7 +742,10 @@ void pcu_write_doubles(pcu_file* f, double* p, size_t n)
   double* tmp;
   if (n)
     PCU_ALWAYS_ASSERT(p != 0);
-  if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN) {
+  if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN && f->block) {
+    buffer_write_swapped(f, p, sizeof(double), n);
+    f->pos += n * sizeof(double);
+  } else if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN) {
     tmp = malloc(n * sizeof(double));
     memcpy(tmp, p, n * sizeof(double));
     pcu_swap_doubles(tmp, n);
@@ -340,8 +780,7 @@ void pcu_read_string (pcu_file* f, char ** p)
     c = buf.start + buf.size - 1;
     pcu_read(f,c,1);
   } while (*c != '\0');
-  pcu_resize_buffer(&buf,buf.size);
-  *p = buf.start;
+  *p = noto_realloc(buf.start,buf.size);
 }
 
 void pcu_write_string (pcu_file * f, const char * p)
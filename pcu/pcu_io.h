@@ -33,10 +33,69 @@ void pcu_read_doubles(struct pcu_file* f, double* p, size_t n);
 void pcu_write_doubles(struct pcu_file* f, double* p, size_t n);
 void pcu_read_string(struct pcu_file* f, char** p);
 void pcu_write_string(struct pcu_file* f, const char* p);
+/* bytes read or written so far, before compression */
+size_t pcu_ftell(struct pcu_file* f);
+/* consumes the next n bytes of an uncompressed input file and
+   returns a pointer to them in a read-only mapping of the file
+   that lives until pcu_fclose, or NULL (consuming nothing)
+   if the file cannot be mapped */
+void const* pcu_fview(struct pcu_file* f, size_t n);
+/* consumes the next n bytes of an input file without
+   returning them, seeking past them when uncompressed */
+void pcu_fskip(struct pcu_file* f, size_t n);
+
+/* reads from (size) bytes at (data), which must outlive the file */
+struct pcu_file* pcu_fopen_memory(void const* data, size_t size);
+/* writes to a growing buffer; *data and *size are set by pcu_fclose
+   and the caller frees *data */
+struct pcu_file* pcu_fopen_buffer(char** data, size_t* size);
+
+/* collectively writes the (size) bytes of every rank into (files)
+   shared files named prefixN.ext using MPI-IO, each holding
+   the buffers of a contiguous range of ranks behind an index */
+void pcu_write_aggregate(const char* prefix, const char* ext, int files,
+    void const* data, size_t size);
+/* collectively returns the number of ranks that wrote the files */
+int pcu_count_aggregate(const char* prefix, const char* ext);
+/* collectively reads back the buffer written by this rank on the
+   same number of ranks. the caller frees the result */
+void* pcu_read_aggregate(const char* prefix, const char* ext, size_t* size);
 
 FILE* pcu_open_parallel(const char* prefix, const char* ext);
 FILE* pcu_group_open(const char* path, bool write);
 
+/* files opened for writing after this call collect their records in
+   blocks of (block_size) bytes, at least 64, or write each record
+   straight through if it is zero. with (background) set, a thread
+   per file compresses and writes the full blocks while the caller
+   keeps filling, and pcu_fclose returns before the data reaches the
+   disk. pcu_fopen and pcu_fclose collect the threads that are done
+   and wait for the oldest ones if more than 8 are still writing.
+   the default is 1MB blocks written by the caller */
+void pcu_io_write_behind(size_t block_size, bool background);
+/* waits until every file closed in the background is complete.
+   opening a file for reading and PCU_Comm_Free call this */
+void pcu_io_sync(void);
+
+struct pcu_io_stats {
+  /* files written and closed, counting background
+     files once they are collected */
+  size_t files;
+  /* bytes written to them, before compression */
+  size_t bytes;
+  /* blocks handed to compression or the disk */
+  size_t blocks;
+  /* time spent compressing and writing the blocks */
+  double write_seconds;
+  /* time callers waited on writer threads */
+  double wait_seconds;
+  /* files closed in the background and not collected yet */
+  size_t pending;
+};
+
+/* totals since the program started, for this process */
+void pcu_io_get_stats(struct pcu_io_stats* s);
+
 void pcu_swap_doubles(double* p, size_t n);
 void pcu_swap_unsigneds(unsigned* p, size_t n);
 
@@ -0,0 +1,235 @@
+/****************************************************************************** 
+
+  Copyright 2014 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_io.h"
+#include "noto_malloc.h"
+#include "reel.h"
+#include "PCU.h"
+#include "pcu_util.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Aggregated files hold the buffers of a contiguous range of ranks.
+   Each starts with a header and the offsets of those buffers from
+   the start of the file, followed by the buffers themselves.
+   Everything is native-endian, the magic number tells readers
+   whether to swap the header. */
+
+enum { AGG_MAGIC = 0x50435541, AGG_HEADER_WORDS = 6 };
+
+/* largest MPI-IO transfer, keeping counts within an int */
+#define AGG_CHUNK ((size_t)1 << 30)
+
+typedef struct {
+  unsigned magic;
+  unsigned parts;
+  unsigned files;
+  unsigned first;
+  unsigned count;
+  unsigned pad;
+} agg_header;
+
+static int agg_first_part(int file, int parts, int files)
+{
+  return (int)(((long)file * parts) / files);
+}
+
+static int agg_file_of(int part, int parts, int files)
+{
+  return (int)(((long)(part + 1) * files - 1) / parts);
+}
+
+static char* agg_path(const char* prefix, const char* ext, int file)
+{
+  size_t size = strlen(prefix) + strlen(ext) + 16;
+  char* path = noto_malloc(size);
+  snprintf(path, size, "%s%d.%s", prefix, file, ext);
+  return path;
+}
+
+static bool agg_check_header(agg_header* h)
+{
+  if (h->magic == AGG_MAGIC)
+    return false;
+  pcu_swap_unsigneds(&h->magic, AGG_HEADER_WORDS);
+  if (h->magic != AGG_MAGIC)
+    reel_fail("pcu: not an aggregated file");
+  return true;
+}
+
+static void agg_swap_offsets(uint64_t* p, size_t n)
+{
+  size_t i, j;
+  unsigned char* b;
+  unsigned char t;
+  for (i = 0; i < n; ++i) {
+    b = (unsigned char*)(p + i);
+    for (j = 0; j < 4; ++j) {
+      t = b[j];
+      b[j] = b[7 - j];
+      b[7 - j] = t;
+    }
+  }
+}
+
+/* collective transfer of n bytes at offset, in as many
+   rounds as the largest transfer in the group needs */
+static void agg_transfer(MPI_File fh, MPI_Comm comm, MPI_Offset offset,
+    void* p, size_t n, bool write)
+{
+  long rounds = (long)((n + AGG_CHUNK - 1) / AGG_CHUNK);
+  long max_rounds;
+  long i;
+  size_t k;
+  MPI_Status status;
+  MPI_Allreduce(&rounds, &max_rounds, 1, MPI_LONG, MPI_MAX, comm);
+  for (i = 0; i < max_rounds; ++i) {
+    k = n < AGG_CHUNK ? n : AGG_CHUNK;
+    if (write)
+      MPI_File_write_at_all(fh, offset, p, (int)k, MPI_BYTE, &status);
+    else
+      MPI_File_read_at_all(fh, offset, p, (int)k, MPI_BYTE, &status);
+    offset += k;
+    p = (char*)p + k;
+    n -= k;
+  }
+}
+
+void pcu_write_aggregate(const char* prefix, const char* ext, int files,
+    void const* data, size_t size)
+{
+  MPI_Comm comm;
+  MPI_File fh;
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  int file, rank;
+  uint64_t my_size = size;
+  uint64_t offset = 0;
+  uint64_t next;
+  uint64_t* offsets = NULL;
+  agg_header h;
+  size_t header_size;
+  char* path;
+  int i;
+  if (files < 1)
+    files = 1;
+  if (files > peers)
+    files = peers;
+  file = agg_file_of(self, peers, files);
+  MPI_Comm_split(PCU_Get_Comm(), file, self, &comm);
+  MPI_Comm_rank(comm, &rank);
+  h.magic = AGG_MAGIC;
+  h.parts = peers;
+  h.files = files;
+  h.first = agg_first_part(file, peers, files);
+  h.count = agg_first_part(file + 1, peers, files) - h.first;
+  h.pad = 0;
+  header_size = sizeof(h) + (h.count + 1) * sizeof(uint64_t);
+  if (!rank)
+    offsets = noto_malloc((h.count + 1) * sizeof(uint64_t));
+  MPI_Gather(&my_size, 1, MPI_UINT64_T, offsets, 1, MPI_UINT64_T, 0, comm);
+  if (!rank) {
+    offsets[h.count] = 0;
+    offset = header_size;
+    for (i = 0; i <= (int)h.count; ++i) {
+      next = offset + offsets[i];
+      offsets[i] = offset;
+      offset = next;
+    }
+  }
+  MPI_Scatter(offsets, 1, MPI_UINT64_T, &offset, 1, MPI_UINT64_T, 0, comm);
+  path = agg_path(prefix, ext, file);
+  if (MPI_File_open(comm, path, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+        MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    reel_fail("pcu_write_aggregate couldn't open \"%s\"", path);
+  MPI_File_set_size(fh, 0);
+  if (!rank) {
+    char* header = noto_malloc(header_size);
+    memcpy(header, &h, sizeof(h));
+    memcpy(header + sizeof(h), offsets, header_size - sizeof(h));
+    agg_transfer(fh, comm, 0, header, header_size, true);
+    noto_free(header);
+    noto_free(offsets);
+  } else {
+    agg_transfer(fh, comm, 0, NULL, 0, true);
+  }
+  agg_transfer(fh, comm, (MPI_Offset)offset, (void*)data, size, true);
+  MPI_File_close(&fh);
+  MPI_Comm_free(&comm);
+  noto_free(path);
+}
+
+/* reads the header of the first file on rank 0 and shares it */
+static void agg_probe(const char* prefix, const char* ext, agg_header* h)
+{
+  memset(h, 0, sizeof(*h));
+  if (!PCU_Comm_Self()) {
+    char* path = agg_path(prefix, ext, 0);
+    FILE* f = fopen(path, "rb");
+    if (!f || fread(h, sizeof(*h), 1, f) != 1)
+      reel_fail("pcu: couldn't read aggregated file \"%s\"", path);
+    fclose(f);
+    agg_check_header(h);
+    noto_free(path);
+  }
+  MPI_Bcast(h, AGG_HEADER_WORDS, MPI_UNSIGNED, 0, PCU_Get_Comm());
+}
+
+int pcu_count_aggregate(const char* prefix, const char* ext)
+{
+  agg_header h;
+  agg_probe(prefix, ext, &h);
+  return (int)h.parts;
+}
+
+void* pcu_read_aggregate(const char* prefix, const char* ext, size_t* size)
+{
+  MPI_Comm comm;
+  MPI_File fh;
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  int file;
+  agg_header h;
+  uint64_t range[2];
+  bool swap;
+  char* path;
+  void* data;
+  agg_probe(prefix, ext, &h);
+  if (h.parts != (unsigned)peers)
+    reel_fail("pcu_read_aggregate: %u parts in the files, %d ranks",
+        h.parts, peers);
+  file = agg_file_of(self, peers, h.files);
+  MPI_Comm_split(PCU_Get_Comm(), file, self, &comm);
+  path = agg_path(prefix, ext, file);
+  if (MPI_File_open(comm, path, MPI_MODE_RDONLY,
+        MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    reel_fail("pcu_read_aggregate couldn't open \"%s\"", path);
+  agg_transfer(fh, comm, 0, &h, sizeof(h), false);
+  swap = agg_check_header(&h);
+  PCU_ALWAYS_ASSERT(h.parts == (unsigned)peers);
+  PCU_ALWAYS_ASSERT((unsigned)self >= h.first);
+  PCU_ALWAYS_ASSERT((unsigned)self < h.first + h.count);
+  agg_transfer(fh, comm,
+      (MPI_Offset)(sizeof(h) + (self - h.first) * sizeof(uint64_t)),
+      range, sizeof(range), false);
+  if (swap)
+    agg_swap_offsets(range, 2);
+  *size = range[1] - range[0];
+  data = malloc(*size ? *size : 1);
+  if (!data)
+    reel_fail("pcu_read_aggregate: malloc(%lu) failed",
+        (unsigned long)*size);
+  agg_transfer(fh, comm, (MPI_Offset)range[0], data, *size, false);
+  MPI_File_close(&fh);
+  MPI_Comm_free(&comm);
+  noto_free(path);
+  return data;
+}
@@ -13,10 +13,13 @@
 #include "pcu_buffer.h"
 #include <mpi.h>
 
+struct pcu_mail;
+
 typedef struct
 {
   pcu_buffer buffer;
   MPI_Request request;
+  struct pcu_mail* mail; //in-process send, see pcu_tmpi.c
   int peer;
 } pcu_message;
 
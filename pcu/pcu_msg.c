@@ -50,39 +50,75 @@
    If another rank is notified first and quickly goes on to
    a new phase, it may be able to send a message that is
    received by the slow rank out-of-phase.
+
+   When every rank knows in advance which ranks it exchanges
+   with (its neighbors) and this relation is symmetric,
+   a neighbor phase replaces both barriers:
+
+1  pack data to be sent, at least an empty message per neighbor
+2  requests = send all packed data with the neighbor tag
+3  while (some neighbor not heard from)
+4    receive from those neighbors only and process data
+5  wait for requests to be done
+
+   Each rank receives exactly one message from each neighbor,
+   so counting them is enough to detect the end of the phase.
+   Receives name the source and use their own tag, so
+   they never match a message of a global phase, and
+   MPI's non-overtaking rule makes the first message from a neighbor
+   be received before anything it sends in a later neighbor phase.
+   Empty messages are not handed to the caller.
+
+   Either kind of phase can also be polled with pcu_msg_test
+   between sending and receiving: it takes one step of the
+   loops above at a time, queueing whatever arrives, so the caller
+   can compute in between. pcu_msg_receive hands out queued
+   messages before receiving new ones.
 */
 
+enum { neighbor_tag = 1 };
+
 //enumeration for pcu_msg.state
 enum {
   idle_state, //in between phases
   pack_state, //after phase start, before sending
   send_recv_state, //starting to receive, sends still going
-  recv_state //sends are done, still receiving
+  recv_state, //sends are done, still receiving
+  done_state //everything was received, some may still be queued
 };
 
 static void make_comm(pcu_msg* m)
 {
   pcu_make_aa(&(m->peers));
+  m->last = NULL;
   pcu_make_message(&(m->received));
+  pcu_pool_take(&(m->pool),&(m->received.buffer));
   m->state = idle_state;
+  m->waiting = NULL;
+  m->pending = 0;
+  m->queued = 0;
+  m->queue_at = 0;
 }
 
 void pcu_make_msg(pcu_msg* m)
 {
+  pcu_make_pool(&(m->pool));
+  m->queue = NULL;
+  m->queue_space = 0;
   make_comm(m);
   m->file = NULL;
   m->order = NULL;
 }
 
-static void free_peers(pcu_aa_tree* t)
+static void free_peers(pcu_pool* pool, pcu_aa_tree* t)
 {
   if (pcu_aa_empty(*t))
     return;
-  free_peers(&((*t)->left));
-  free_peers(&((*t)->right));
+  free_peers(pool,&((*t)->left));
+  free_peers(pool,&((*t)->right));
   pcu_msg_peer* peer;
   peer = (pcu_msg_peer*) *t;
-  pcu_free_message(&(peer->message));
+  pcu_pool_give(pool,&(peer->message.buffer));
   noto_free(peer);
   pcu_make_aa(t);
 }
@@ -111,26 +147,60 @@ static pcu_msg_peer* find_peer(pcu_aa_tree t, int id)
   return (pcu_msg_peer*) pcu_aa_find(&(key.node),t,peer_less);
 }
 
-static pcu_msg_peer* make_peer(int id)
+static pcu_msg_peer* make_peer(pcu_pool* pool, int id)
 {
   pcu_msg_peer* p;
   NOTO_MALLOC(p,1);
   pcu_make_message(&(p->message));
+  pcu_pool_take(pool,&(p->message.buffer));
   p->message.peer = id;
   return p;
 }
 
-void* pcu_msg_pack(pcu_msg* m, int id, size_t size)
+void pcu_msg_start_neighbors(pcu_msg* m, int const* ranks, int n)
+{
+  if (m->state != idle_state)
+    reel_fail("PCU_Comm_Begin_Neighbors called at the wrong time");
+  NOTO_MALLOC(m->waiting,n + 1);
+  m->pending = 0;
+  for (int i = 0; i < n; ++i)
+  {
+    if (find_peer(m->peers,ranks[i]))
+      continue;
+    pcu_msg_peer* peer = make_peer(&(m->pool),ranks[i]);
+    pcu_aa_insert(&(peer->node),&(m->peers),peer_less);
+    m->waiting[m->pending++] = ranks[i];
+  }
+  m->state = pack_state;
+}
+
+/* packing often goes to the same peer many times in a row */
+static pcu_msg_peer* get_peer(pcu_msg* m, int id)
 {
   if (m->state != pack_state)
     reel_fail("PCU_Comm_Pack called at the wrong time");
+  if (m->last && m->last->message.peer == id)
+    return m->last;
   pcu_msg_peer* peer = find_peer(m->peers,id);
   if (!peer)
   {
-    peer = make_peer(id);
+    if (m->waiting)
+      reel_fail("PCU_Comm_Pack to %d, which is not a neighbor", id);
+    peer = make_peer(&(m->pool),id);
     pcu_aa_insert(&(peer->node),&(m->peers),peer_less);
   }
-  return pcu_push_buffer(&(peer->message.buffer),size);
+  m->last = peer;
+  return peer;
+}
+
+void* pcu_msg_pack(pcu_msg* m, int id, size_t size)
+{
+  return pcu_push_buffer(&(get_peer(m,id)->message.buffer),size);
+}
+
+void* pcu_msg_reserve(pcu_msg* m, int id, size_t size, size_t align)
+{
+  return pcu_push_aligned(&(get_peer(m,id)->message.buffer),size,align);
 }
 
 size_t pcu_msg_packed(pcu_msg* m, int id)
@@ -154,11 +224,47 @@ static void send_peers(pcu_aa_tree t)
   send_peers(t->right);
 }
 
+static void send_neighbors(pcu_aa_tree t)
+{
+  if (pcu_aa_empty(t))
+    return;
+  pcu_msg_peer* peer;
+  peer = (pcu_msg_peer*)t;
+  pcu_pmpi_send2(&(peer->message),neighbor_tag,pcu_user_comm);
+  send_neighbors(t->left);
+  send_neighbors(t->right);
+}
+
+static void count_peers(pcu_aa_tree t, size_t* peers, size_t* bytes)
+{
+  if (pcu_aa_empty(t))
+    return;
+  pcu_msg_peer* peer;
+  peer = (pcu_msg_peer*)t;
+  if (peer->message.buffer.size) {
+    ++(*peers);
+    *bytes += peer->message.buffer.size;
+  }
+  count_peers(t->left, peers, bytes);
+  count_peers(t->right, peers, bytes);
+}
+
+/* the non-empty messages about to be sent and their total size */
+void pcu_msg_sending(pcu_msg* m, size_t* peers, size_t* bytes)
+{
+  *peers = 0;
+  *bytes = 0;
+  count_peers(m->peers, peers, bytes);
+}
+
 void pcu_msg_send(pcu_msg* m)
 {
   if (m->state != pack_state)
     reel_fail("PCU_Comm_Send called at the wrong time");
-  send_peers(m->peers);
+  if (m->waiting)
+    send_neighbors(m->peers);
+  else
+    send_peers(m->peers);
   m->state = send_recv_state;
 }
 
@@ -173,38 +279,116 @@ static bool done_sending_peers(pcu_aa_tree t)
     && done_sending_peers(t->right);
 }
 
-static bool receive_global(pcu_msg* m)
+//results of polling for one message
+enum {
+  no_message, //nothing arrived yet
+  got_message, //a message was received
+  phase_done //no more messages will arrive in this phase
+};
+
+static int poll_global(pcu_msg* m, pcu_message* into)
 {
-  m->received.peer = MPI_ANY_SOURCE;
-  while ( ! pcu_mpi_receive(&(m->received),pcu_user_comm))
+  into->peer = MPI_ANY_SOURCE;
+  if (pcu_mpi_receive(into,pcu_user_comm))
+    return got_message;
+  if (m->state == send_recv_state)
+    if (done_sending_peers(m->peers))
+    {
+      pcu_begin_barrier(&(m->coll));
+      m->state = recv_state;
+    }
+  if (m->state == recv_state)
+    if (pcu_barrier_done(&(m->coll)))
+      return phase_done;
+  return no_message;
+}
+
+static int poll_neighbors(pcu_msg* m, pcu_message* into)
+{
+  for (int i = 0; i < m->pending; ++i)
   {
-    if (m->state == send_recv_state)
-      if (done_sending_peers(m->peers))
-      {
-        pcu_begin_barrier(&(m->coll));
-        m->state = recv_state;
-      }
-    if (m->state == recv_state)
-      if (pcu_barrier_done(&(m->coll)))
-        return false;
+    into->peer = m->waiting[i];
+    if ( ! pcu_pmpi_receive2(into,neighbor_tag,pcu_user_comm))
+      continue;
+    m->waiting[i] = m->waiting[--(m->pending)];
+    if (into->buffer.size)
+      return got_message;
+    --i;
   }
-  return true;
+  if (( ! m->pending) && done_sending_peers(m->peers))
+    return phase_done;
+  return no_message;
+}
+
+static int poll(pcu_msg* m, pcu_message* into)
+{
+  if (m->waiting)
+    return poll_neighbors(m,into);
+  return poll_global(m,into);
+}
+
+static void enqueue(pcu_msg* m, pcu_message* msg)
+{
+  if (m->queued == m->queue_space)
+  {
+    m->queue_space = (m->queue_space + 16) * 3 / 2;
+    m->queue = noto_realloc(m->queue,
+        m->queue_space * sizeof(pcu_message));
+  }
+  m->queue[m->queued++] = *msg;
 }
 
 static void free_comm(pcu_msg* m)
 {
-  free_peers(&(m->peers));
-  pcu_free_message(&(m->received));
+  free_peers(&(m->pool),&(m->peers));
+  pcu_pool_give(&(m->pool),&(m->received.buffer));
+  for (; m->queue_at < m->queued; ++(m->queue_at))
+    pcu_pool_give(&(m->pool),&(m->queue[m->queue_at].buffer));
+  noto_free(m->waiting);
 }
 
-bool pcu_msg_receive(pcu_msg* m)
+/* receive everything that has arrived so far into the queue,
+   without waiting for anything else */
+bool pcu_msg_test(pcu_msg* m)
 {
+  if (m->state == done_state)
+    return true;
   if ((m->state != send_recv_state)&&
       (m->state != recv_state))
+    reel_fail("PCU_Comm_Test called at the wrong time");
+  pcu_message incoming;
+  pcu_make_message(&incoming);
+  pcu_pool_take(&(m->pool),&(incoming.buffer));
+  int result;
+  while ((result = poll(m,&incoming)) == got_message)
+  {
+    enqueue(m,&incoming);
+    pcu_pool_take(&(m->pool),&(incoming.buffer));
+  }
+  pcu_pool_give(&(m->pool),&(incoming.buffer));
+  if (result == phase_done)
+    m->state = done_state;
+  return result == phase_done;
+}
+
+bool pcu_msg_receive(pcu_msg* m)
+{
+  if ((m->state != send_recv_state)&&
+      (m->state != recv_state)&&
+      (m->state != done_state))
     reel_fail("PCU_Comm_Receive called at the wrong time");
   if ( ! pcu_msg_unpacked(m))
     reel_fail("PCU_Comm_Receive called before previous message unpacked");
-  if (receive_global(m))
+  int result = phase_done;
+  if (m->queue_at < m->queued)
+  {
+    pcu_pool_give(&(m->pool),&(m->received.buffer));
+    m->received = m->queue[m->queue_at++];
+    result = got_message;
+  }
+  else if (m->state != done_state)
+    while ((result = poll(m,&(m->received))) == no_message);
+  if (result == got_message)
   {
     pcu_begin_buffer(&(m->received.buffer));
     return true;
@@ -220,6 +404,11 @@ void* pcu_msg_unpack(pcu_msg* m, size_t size)
   return pcu_walk_buffer(&(m->received.buffer),size);
 }
 
+void* pcu_msg_extract(pcu_msg* m, size_t size, size_t align)
+{
+  return pcu_walk_aligned(&(m->received.buffer),size,align);
+}
+
 bool pcu_msg_unpacked(pcu_msg* m)
 {
   return pcu_buffer_walked(&(m->received.buffer));
@@ -238,6 +427,8 @@ size_t pcu_msg_received_size(pcu_msg* m)
 void pcu_free_msg(pcu_msg* m)
 {
   free_comm(m);
+  noto_free(m->queue);
+  pcu_free_pool(&(m->pool));
   if (m->file)
     fclose(m->file);
 }
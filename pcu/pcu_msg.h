@@ -13,6 +13,7 @@
 #include "pcu_coll.h"
 #include "pcu_aa.h"
 #include "pcu_io.h"
+#include "pcu_pool.h"
 
 /* the PCU Messenger (pcu_msg for short) system implements
    a non-blocking Bulk Synchronous Parallel communication model
@@ -32,9 +33,17 @@ struct pcu_order_struct;
 struct pcu_msg_struct
 {
   pcu_aa_tree peers; //binary tree of send buffers
+  pcu_msg_peer* last; //peer of the latest pack, spares a lookup
   pcu_message received; //current received buffer
   pcu_coll coll; //collective operation object
   int state; //state within a communication phase
+  int* waiting; //neighbors not yet heard from, NULL outside neighbor phases
+  int pending; //number of entries in waiting
+  pcu_pool pool; //buffers kept between phases
+  pcu_message* queue; //messages received by pcu_msg_test
+  int queued; //messages in queue
+  int queue_at; //first message of queue not yet handed out
+  int queue_space; //capacity of queue
   /* below this point are variables that just need
      to be thread-specific but have been tacked onto
      pcu_msg. if this gets out of hand, create a
@@ -46,15 +55,20 @@ typedef struct pcu_msg_struct pcu_msg;
 
 void pcu_make_msg(pcu_msg* m);
 void pcu_msg_start(pcu_msg* b);
+void pcu_msg_start_neighbors(pcu_msg* m, int const* ranks, int n);
 void* pcu_msg_pack(pcu_msg* m, int id, size_t size);
 #define PCU_MSG_PACK(m,id,o) \
 memcpy(pcu_msg_pack(m,id,sizeof(o)),&(o),sizeof(o))
+void* pcu_msg_reserve(pcu_msg* m, int id, size_t size, size_t align);
 size_t pcu_msg_packed(pcu_msg* m, int id);
+void pcu_msg_sending(pcu_msg* m, size_t* peers, size_t* bytes);
 void pcu_msg_send(pcu_msg* m);
+bool pcu_msg_test(pcu_msg* m);
 bool pcu_msg_receive(pcu_msg* m);
 void* pcu_msg_unpack(pcu_msg* m, size_t size);
 #define PCU_MSG_UNPACK(m,o) \
 memcpy(&(o),pcu_msg_unpack(m,sizeof(o)),sizeof(o))
+void* pcu_msg_extract(pcu_msg* m, size_t size, size_t align);
 bool pcu_msg_unpacked(pcu_msg* m);
 int pcu_msg_received_from(pcu_msg* m);
 size_t pcu_msg_received_size(pcu_msg* m);
@@ -44,33 +44,37 @@ pcu_order pcu_order_new(void)
   return o;
 }
 
-static void free_message(struct message* m)
+/* buffers go back to the messenger's pool if there is one */
+static void free_message(pcu_pool* pool, struct message* m)
 {
-  pcu_free_buffer(&m->buf);
+  if (pool)
+    pcu_pool_give(pool, &m->buf);
+  else
+    pcu_free_buffer(&m->buf);
   noto_free(m);
 }
 
-static void free_messages(pcu_aa_tree* t)
+static void free_messages(pcu_pool* pool, pcu_aa_tree* t)
 {
   if (pcu_aa_empty(*t))
     return;
-  free_messages(&((*t)->left));
-  free_messages(&((*t)->right));
+  free_messages(pool, &((*t)->left));
+  free_messages(pool, &((*t)->right));
   struct message* m;
   m = (struct message*) *t;
-  free_message(m);
+  free_message(pool, m);
   pcu_make_aa(t);
 }
 
-static void dtor_order(pcu_order o)
+static void dtor_order(pcu_order o, pcu_pool* pool)
 {
-  free_messages(&o->tree);
+  free_messages(pool, &o->tree);
   noto_free(o->array);
 }
 
 void pcu_order_free(pcu_order o)
 {
-  dtor_order(o);
+  dtor_order(o, NULL);
   noto_free(o);
 }
 
@@ -80,7 +84,7 @@ static struct message* take_message(pcu_msg* t)
   NOTO_MALLOC(m,1);
   m->from = t->received.peer;
   m->buf = t->received.buffer; /* steal the buffer */
-  pcu_make_buffer(&t->received.buffer);
+  pcu_pool_take(&t->pool, &t->received.buffer);
   return m;
 }
 
@@ -123,7 +127,7 @@ bool pcu_order_receive(pcu_order o, pcu_msg* m)
     prepare(o, m);
   o->at++;
   if (o->at == o->count) {
-    dtor_order(o);
+    dtor_order(o, &m->pool);
     init_order(o);
     return false;
   }
@@ -136,6 +140,11 @@ void* pcu_order_unpack(pcu_order o, size_t size)
   return pcu_walk_buffer(&o->array[o->at]->buf, size);
 }
 
+void* pcu_order_extract(pcu_order o, size_t size, size_t align)
+{
+  return pcu_walk_aligned(&o->array[o->at]->buf, size, align);
+}
+
 bool pcu_order_unpacked(pcu_order o)
 {
 /* compatibility with pcu_msg_unpacked before pcu_msg_receive */
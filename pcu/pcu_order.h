@@ -19,6 +19,7 @@ pcu_order pcu_order_new(void);
 void pcu_order_free(pcu_order o);
 bool pcu_order_receive(pcu_order o, pcu_msg* m);
 void* pcu_order_unpack(pcu_order o, size_t size);
+void* pcu_order_extract(pcu_order o, size_t size, size_t align);
 bool pcu_order_unpacked(pcu_order o);
 int pcu_order_received_from(pcu_order o);
 size_t pcu_order_received_size(pcu_order o);
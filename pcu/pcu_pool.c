@@ -0,0 +1,77 @@
+/****************************************************************************** 
+
+  Copyright 2014 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_pool.h"
+#include "noto_malloc.h"
+
+enum { default_limit = 64 * 1024 * 1024 };
+
+void pcu_make_pool(pcu_pool* p)
+{
+  p->blocks = NULL;
+  p->count = 0;
+  p->space = 0;
+  p->retained = 0;
+  p->limit = default_limit;
+  p->hits = 0;
+  p->misses = 0;
+}
+
+void pcu_free_pool(pcu_pool* p)
+{
+  pcu_pool_limit(p, 0);
+  noto_free(p->blocks);
+}
+
+/* the most recently given buffer is taken first,
+   it is the most likely to still be in cache */
+void pcu_pool_take(pcu_pool* p, pcu_buffer* b)
+{
+  if (!p->count)
+  {
+    ++(p->misses);
+    pcu_make_buffer(b);
+    return;
+  }
+  ++(p->hits);
+  *b = p->blocks[--(p->count)];
+  p->retained -= b->allocated;
+  /* empty like a new buffer, only the memory is kept */
+  b->size = 0;
+  b->capacity = 0;
+}
+
+void pcu_pool_give(pcu_pool* p, pcu_buffer* b)
+{
+  if (!b->allocated || p->retained + b->allocated > p->limit)
+  {
+    pcu_free_buffer(b);
+    pcu_make_buffer(b);
+    return;
+  }
+  if (p->count == p->space)
+  {
+    p->space = (p->space + 16) * 3 / 2;
+    p->blocks = noto_realloc(p->blocks, p->space * sizeof(pcu_buffer));
+  }
+  p->blocks[p->count++] = *b;
+  p->retained += b->allocated;
+  pcu_make_buffer(b);
+}
+
+void pcu_pool_limit(pcu_pool* p, size_t limit)
+{
+  p->limit = limit;
+  while (p->retained > limit)
+  {
+    pcu_buffer* b = &(p->blocks[--(p->count)]);
+    p->retained -= b->allocated;
+    pcu_free_buffer(b);
+  }
+}
@@ -0,0 +1,36 @@
+/****************************************************************************** 
+
+  Copyright 2014 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef PCU_POOL_H
+#define PCU_POOL_H
+
+#include "pcu_buffer.h"
+
+/* a pool of buffer memory kept between communication phases,
+   so that a phase can start with the capacity the previous
+   ones grew to instead of from nothing.
+   at most limit bytes are kept, the rest is freed */
+typedef struct
+{
+  pcu_buffer* blocks; //stack of kept buffers
+  int count; //buffers in the stack
+  int space; //capacity of the stack
+  size_t retained; //bytes held by the kept buffers
+  size_t limit; //most bytes that may be kept
+  size_t hits; //takes given a kept buffer
+  size_t misses; //takes given an empty buffer
+} pcu_pool;
+
+void pcu_make_pool(pcu_pool* p);
+void pcu_free_pool(pcu_pool* p);
+void pcu_pool_take(pcu_pool* p, pcu_buffer* b);
+void pcu_pool_give(pcu_pool* p, pcu_buffer* b);
+void pcu_pool_limit(pcu_pool* p, size_t limit);
+
+#endif
@@ -0,0 +1,456 @@
+/****************************************************************************** 
+
+  Copyright 2014 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_prof.h"
+#include "pcu_thrd.h"
+#include "PCU.h"
+#include "pcu_pmpi.h"
+#include "noto_malloc.h"
+#include "reel.h"
+#include <lionPrint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { path_max = 256, depth_max = 32 };
+
+//the counters kept for each label path
+enum {
+  phases,
+  peers, //ranks messaged, one message each
+  sent_bytes,
+  received,
+  received_bytes,
+  pack_time, //from phase start to send
+  barrier_time, //in the barrier that starts a phase
+  wait_time, //waiting for messages to arrive
+  unpack_time, //the rest of the phase after sending
+  collectives,
+  collective_time,
+  counters
+};
+
+static const char* const counter_names[counters] = {
+  "phases",
+  "peers",
+  "bytes sent",
+  "messages received",
+  "bytes received",
+  "pack seconds",
+  "barrier seconds",
+  "wait seconds",
+  "unpack seconds",
+  "collectives",
+  "collective seconds"
+};
+
+struct prof_stat {
+  char path[path_max];
+  double v[counters];
+};
+
+struct prof_event {
+  int stat;
+  bool collective;
+  double start;
+  double end;
+  double v[counters];
+};
+
+bool pcu_prof_on = false;
+
+static char* trace_prefix;
+static double zero_time;
+static struct prof_stat* stats;
+static int stat_count;
+static int stat_space;
+static struct prof_event* events;
+static int event_count;
+static int event_space;
+static char path[path_max];
+static size_t path_cut[depth_max];
+static int stat_of[depth_max + 1];
+static int depth;
+static int current;
+
+static struct {
+  double begin;
+  double started;
+  double sent;
+  double wait;
+  double v[counters];
+} phase;
+
+static int find_stat(const char* p)
+{
+  for (int i = 0; i < stat_count; ++i)
+    if (!strcmp(stats[i].path, p))
+      return i;
+  if (stat_count == stat_space) {
+    stat_space = (stat_space + 16) * 3 / 2;
+    stats = noto_realloc(stats, stat_space * sizeof(struct prof_stat));
+  }
+  struct prof_stat* s = &stats[stat_count];
+  memset(s, 0, sizeof(*s));
+  size_t len = strlen(p);
+  if (len > path_max - 1)
+    len = path_max - 1;
+  memcpy(s->path, p, len);
+  return stat_count++;
+}
+
+static struct prof_event* add_event(bool collective, double start,
+    double end)
+{
+  if (!trace_prefix)
+    return NULL;
+  if (event_count == event_space) {
+    event_space = (event_space + 16) * 3 / 2;
+    events = noto_realloc(events, event_space * sizeof(struct prof_event));
+  }
+  struct prof_event* e = &events[event_count++];
+  memset(e, 0, sizeof(*e));
+  e->stat = current;
+  e->collective = collective;
+  e->start = start;
+  e->end = end;
+  return e;
+}
+
+void pcu_prof_enable(const char* prefix)
+{
+  if (pcu_prof_on)
+    reel_fail("PCU profiling enabled twice");
+  pcu_prof_on = true;
+  zero_time = MPI_Wtime();
+  if (prefix) {
+    trace_prefix = noto_malloc(strlen(prefix) + 1);
+    strcpy(trace_prefix, prefix);
+  }
+  path[0] = '\0';
+  depth = 0;
+  current = stat_of[0] = find_stat(path);
+}
+
+void pcu_prof_push(const char* label)
+{
+  if (depth == depth_max)
+    reel_fail("PCU profile labels nested deeper than %d", depth_max);
+  size_t len = strlen(path);
+  path_cut[depth++] = len;
+  if (len && len < path_max - 1)
+    path[len++] = '/';
+  strncpy(path + len, label, path_max - 1 - len);
+  path[path_max - 1] = '\0';
+  current = stat_of[depth] = find_stat(path);
+}
+
+void pcu_prof_pop(void)
+{
+  if (!depth)
+    return;
+  path[path_cut[--depth]] = '\0';
+  current = stat_of[depth];
+}
+
+void pcu_prof_begin_phase(void)
+{
+  memset(&phase, 0, sizeof(phase));
+  phase.begin = MPI_Wtime();
+}
+
+void pcu_prof_started(void)
+{
+  phase.started = MPI_Wtime();
+}
+
+void pcu_prof_sent(size_t n, size_t bytes)
+{
+  phase.sent = MPI_Wtime();
+  phase.v[peers] = n;
+  phase.v[sent_bytes] = bytes;
+}
+
+void pcu_prof_wait(double since)
+{
+  phase.wait += MPI_Wtime() - since;
+}
+
+void pcu_prof_received(size_t bytes)
+{
+  phase.v[received] += 1;
+  phase.v[received_bytes] += bytes;
+}
+
+void pcu_prof_end_phase(void)
+{
+  double end = MPI_Wtime();
+  phase.v[phases] = 1;
+  phase.v[barrier_time] = phase.started - phase.begin;
+  phase.v[pack_time] = phase.sent - phase.started;
+  phase.v[wait_time] = phase.wait;
+  phase.v[unpack_time] = end - phase.sent - phase.wait;
+  double* v = stats[current].v;
+  for (int i = 0; i < counters; ++i)
+    v[i] += phase.v[i];
+  struct prof_event* e = add_event(false, phase.begin, end);
+  if (e)
+    memcpy(e->v, phase.v, sizeof(phase.v));
+}
+
+void pcu_prof_collective(double since)
+{
+  double end = MPI_Wtime();
+  stats[current].v[collectives] += 1;
+  stats[current].v[collective_time] += end - since;
+  add_event(true, since, end);
+}
+
+static void write_string(FILE* f, const char* s)
+{
+  fputc('"', f);
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', f);
+    fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+/* one Chrome trace event file per rank, see chrome://tracing */
+static void write_trace(int rank)
+{
+  char name[1024];
+  snprintf(name, sizeof(name), "%s%d.json", trace_prefix, rank);
+  FILE* f = fopen(name, "w");
+  if (!f)
+    reel_fail("could not open PCU trace file %s", name);
+  fprintf(f, "{\"traceEvents\":[\n");
+  for (int i = 0; i < event_count; ++i) {
+    struct prof_event* e = &events[i];
+    const char* p = stats[e->stat].path;
+    fprintf(f, "{\"name\":");
+    write_string(f, *p ? p : "(unlabeled)");
+    fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+        "\"pid\":%d,\"tid\":0",
+        e->collective ? "collective" : "phase",
+        (e->start - zero_time) * 1e6, (e->end - e->start) * 1e6, rank);
+    if (!e->collective) {
+      fprintf(f, ",\"args\":{");
+      for (int j = peers; j <= unpack_time; ++j)
+        fprintf(f, "%s\"%s\":%g", j == peers ? "" : ",",
+            counter_names[j], e->v[j]);
+      fprintf(f, "}");
+    }
+    fprintf(f, "}%s\n", i + 1 < event_count ? "," : "");
+  }
+  fprintf(f, "]}\n");
+  fclose(f);
+}
+
+static int compare_paths(const void* a, const void* b)
+{
+  return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+/* the paths of this rank, one after another with their nulls.
+   every rank has at least the unlabeled root path, so none of
+   the path lists below are empty */
+static char* pack_paths(int* bytes)
+{
+  int n = 0;
+  for (int i = 0; i < stat_count; ++i)
+    n += strlen(stats[i].path) + 1;
+  char* packed = noto_malloc(n);
+  char* at = packed;
+  for (int i = 0; i < stat_count; ++i) {
+    strcpy(at, stats[i].path);
+    at += strlen(at) + 1;
+  }
+  *bytes = n;
+  return packed;
+}
+
+/* pointers to each of the packed paths */
+static const char** split_paths(const char* packed, int bytes, int* n)
+{
+  *n = 0;
+  for (int at = 0; at < bytes; at += strlen(packed + at) + 1)
+    ++(*n);
+  const char** p = noto_malloc(*n * sizeof(const char*));
+  *n = 0;
+  for (int at = 0; at < bytes; at += strlen(packed + at) + 1)
+    p[(*n)++] = packed + at;
+  return p;
+}
+
+/* sorts the packed paths, dropping repeats, and repacks them */
+static char* unique_paths(char* packed, int bytes, int* out_bytes)
+{
+  int n;
+  const char** p = split_paths(packed, bytes, &n);
+  qsort(p, n, sizeof(const char*), compare_paths);
+  char* unique = noto_malloc(bytes);
+  char* at = unique;
+  for (int i = 0; i < n; ++i)
+    if (!i || strcmp(p[i], p[i - 1])) {
+      strcpy(at, p[i]);
+      at += strlen(at) + 1;
+    }
+  *out_bytes = at - unique;
+  noto_free(p);
+  return unique;
+}
+
+/* every rank sends its path names to rank 0, which
+   broadcasts back the sorted list of all of them */
+static char* agree_on_paths(MPI_Comm comm, int rank, int ranks, int* bytes)
+{
+  int mine;
+  char* packed = pack_paths(&mine);
+  int* counts = NULL;
+  int* displs = NULL;
+  char* all = NULL;
+  if (!rank) {
+    counts = noto_malloc(ranks * sizeof(int));
+    displs = noto_malloc(ranks * sizeof(int));
+  }
+  MPI_Gather(&mine, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+  int total = 0;
+  if (!rank) {
+    for (int r = 0; r < ranks; ++r) {
+      displs[r] = total;
+      total += counts[r];
+    }
+    all = noto_malloc(total);
+  }
+  MPI_Gatherv(packed, mine, MPI_CHAR,
+      all, counts, displs, MPI_CHAR, 0, comm);
+  noto_free(packed);
+  char* unique = NULL;
+  if (!rank)
+    unique = unique_paths(all, total, bytes);
+  noto_free(counts);
+  noto_free(displs);
+  noto_free(all);
+  MPI_Bcast(bytes, 1, MPI_INT, 0, comm);
+  if (rank)
+    unique = noto_malloc(*bytes);
+  MPI_Bcast(unique, *bytes, MPI_CHAR, 0, comm);
+  return unique;
+}
+
+static void print_summary(const char** paths, int n, double* lo,
+    double* sum, double* hi, int ranks)
+{
+  lion_oprint(1, "PCU communication profile, min/avg/max over %d ranks\n",
+      ranks);
+  for (int i = 0; i < n; ++i) {
+    lion_oprint(1, "%s\n", *paths[i] ? paths[i] : "(unlabeled)");
+    for (int k = 0; k < counters; ++k) {
+      int j = i * counters + k;
+      if (hi[j] > 0)
+        lion_oprint(1, "  %-20s %14.6g %14.6g %14.6g\n", counter_names[k],
+            lo[j], sum[j] / ranks, hi[j]);
+    }
+  }
+}
+
+/* reduces the counters of every path to rank 0 and prints
+   them there, called by all ranks */
+void pcu_prof_finish(void)
+{
+  MPI_Comm comm = pcu_coll_comm;
+  int rank, ranks;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &ranks);
+  if (trace_prefix)
+    write_trace(rank);
+  int bytes;
+  char* paths = agree_on_paths(comm, rank, ranks, &bytes);
+  int n;
+  const char** sorted = split_paths(paths, bytes, &n);
+  /* ranks that never saw a path count zero for it */
+  int size = n * counters;
+  double* v = noto_malloc(size * sizeof(double));
+  memset(v, 0, size * sizeof(double));
+  for (int i = 0; i < stat_count; ++i) {
+    const char* p = stats[i].path;
+    const char** found = bsearch(&p, sorted, n, sizeof(const char*),
+        compare_paths);
+    memcpy(v + (found - sorted) * counters, stats[i].v, sizeof(stats[i].v));
+  }
+  double* lo = NULL;
+  double* sum = NULL;
+  double* hi = NULL;
+  if (!rank) {
+    lo = noto_malloc(size * sizeof(double));
+    sum = noto_malloc(size * sizeof(double));
+    hi = noto_malloc(size * sizeof(double));
+  }
+  MPI_Reduce(v, lo, size, MPI_DOUBLE, MPI_MIN, 0, comm);
+  MPI_Reduce(v, sum, size, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(v, hi, size, MPI_DOUBLE, MPI_MAX, 0, comm);
+  if (!rank)
+    print_summary(sorted, n, lo, sum, hi, ranks);
+  noto_free(lo);
+  noto_free(sum);
+  noto_free(hi);
+  noto_free(v);
+  noto_free(sorted);
+  noto_free(paths);
+  noto_free(stats);
+  noto_free(events);
+  noto_free(trace_prefix);
+  stats = NULL;
+  events = NULL;
+  trace_prefix = NULL;
+  stat_count = stat_space = event_count = event_space = 0;
+  pcu_prof_on = false;
+}
+
+/** \brief Starts counting and timing communication.
+  \details Must be called by all threads, outside of any label.
+  From then on, each communication phase and collective is
+  counted under the labels pushed with PCU_Profile_Push:
+  messages, bytes, and the time spent packing, in the barrier
+  that starts a phase, waiting for messages and unpacking them.
+  PCU_Comm_Free prints the minimum, average and maximum
+  over threads of these for each label path.
+  If \a trace_prefix is not NULL, each thread also writes its phases
+  and collectives to the Chrome trace file <trace_prefix><rank>.json.
+  Before this call, the cost of profiling is a branch per PCU call.
+*/
+void PCU_Profile_Enable(const char* trace_prefix)
+{
+  if (!PCU_Comm_Initialized())
+    reel_fail("Profile_Enable called before Comm_Init");
+  if (pcu_thrd_msgs)
+    reel_fail("Profile_Enable called by a thread of PCU_Thrd_Run");
+  pcu_prof_enable(trace_prefix);
+}
+
+/** \brief Attributes the following communication to \a label.
+  \details Labels nest, so that communication is attributed
+  to paths such as "migrate/moveEntities".
+  Each push must be matched by a PCU_Profile_Pop.
+  This does nothing unless PCU_Profile_Enable was called.
+*/
+void PCU_Profile_Push(const char* label)
+{
+  if (pcu_prof_on)
+    pcu_prof_push(label);
+}
+
+/** \brief Ends the label of the matching PCU_Profile_Push. */
+void PCU_Profile_Pop(void)
+{
+  if (pcu_prof_on)
+    pcu_prof_pop();
+}
@@ -0,0 +1,36 @@
+/****************************************************************************** 
+
+  Copyright 2014 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef PCU_PROF_H
+#define PCU_PROF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the PCU profiler (pcu_prof) counts and times communication
+   phases and collectives, attributing them to the path of
+   labels pushed by the user at the time.
+   every hook is called only when pcu_prof_on is set,
+   so the cost when disabled is that one check */
+
+extern bool pcu_prof_on;
+
+void pcu_prof_enable(const char* trace_prefix);
+void pcu_prof_push(const char* label);
+void pcu_prof_pop(void);
+void pcu_prof_begin_phase(void);
+void pcu_prof_started(void);
+void pcu_prof_sent(size_t peers, size_t bytes);
+void pcu_prof_wait(double since);
+void pcu_prof_received(size_t bytes);
+void pcu_prof_end_phase(void);
+void pcu_prof_collective(double since);
+void pcu_prof_finish(void);
+
+#endif
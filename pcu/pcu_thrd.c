@@ -0,0 +1,60 @@
+/****************************************************************************** 
+
+  Copyright 2011 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_thrd.h"
+#include "pcu_coll.h"
+#include "pcu_order.h"
+#include "pcu_pmpi.h"
+#include "pcu_prof.h"
+#include "pcu_tmpi.h"
+#include "noto_malloc.h"
+#include "reel.h"
+
+pcu_msg* pcu_thrd_msgs = NULL;
+
+void pcu_thrd_run(int nthreads, pcu_thread* function, void** in_out,
+    bool ordered)
+{
+  if (pcu_thrd_msgs)
+    reel_fail("nested calls to Thrd_Run");
+  if (nthreads < 1)
+    reel_fail("Thrd_Run called with %d threads", nthreads);
+  if (pcu_prof_on)
+    reel_fail("Thrd_Run does not support communication profiling");
+  if (pcu_pmpi_size() > 1 && nthreads > 1) {
+    int level;
+    MPI_Query_thread(&level);
+    if (level != MPI_THREAD_MULTIPLE)
+      reel_fail("Thrd_Run needs MPI_Init_thread with MPI_THREAD_MULTIPLE");
+  }
+  pcu_tmpi_init(nthreads);
+  pcu_mpi* saved_mpi = pcu_get_mpi();
+  bool saved_native = pcu_coll_native;
+  pcu_set_mpi(&pcu_tmpi);
+  pcu_coll_native = false;
+  pcu_msg* msgs;
+  NOTO_MALLOC(msgs, nthreads);
+  for (int i = 0; i < nthreads; ++i) {
+    pcu_make_msg(&(msgs[i]));
+    if (ordered)
+      msgs[i].order = pcu_order_new();
+  }
+  pcu_thrd_msgs = msgs;
+  pcu_run_threads(nthreads, function, in_out);
+  pcu_thrd_msgs = NULL;
+  for (int i = 0; i < nthreads; ++i) {
+    if (msgs[i].order)
+      pcu_order_free(msgs[i].order);
+    pcu_free_msg(&(msgs[i]));
+  }
+  noto_free(msgs);
+  pcu_coll_native = saved_native;
+  pcu_set_mpi(saved_mpi);
+  pcu_tmpi_finalize();
+}
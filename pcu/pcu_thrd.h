@@ -0,0 +1,28 @@
+/****************************************************************************** 
+
+  Copyright 2011 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef PCU_THRD_H
+#define PCU_THRD_H
+
+#include "pcu_msg.h"
+#include "pcu_thread.h"
+
+/* the message state of each thread while PCU_Thrd_Run runs,
+   NULL outside of it */
+
+extern pcu_msg* pcu_thrd_msgs;
+
+/* switches PCU to one rank per thread, runs the threads
+   and switches back. ordered says whether the message
+   state of the process orders its messages. */
+
+void pcu_thrd_run(int nthreads, pcu_thread* function, void** in_out,
+    bool ordered);
+
+#endif
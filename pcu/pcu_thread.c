@@ -0,0 +1,74 @@
+/****************************************************************************** 
+
+  Copyright 2011 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_thread.h"
+#include "noto_malloc.h"
+#include "reel.h"
+#include <pthread.h>
+
+static int global_size = 1;
+static pthread_key_t rank_key;
+
+typedef struct
+{
+  int rank;
+  pcu_thread* function;
+  void** in_out;
+} start_info;
+
+static void* start(void* arg)
+{
+  start_info* info = arg;
+  pthread_setspecific(rank_key,info);
+  info->in_out[info->rank] = info->function(info->in_out[info->rank]);
+  return NULL;
+}
+
+void pcu_run_threads(int count, pcu_thread* function, void** in_out)
+{
+  if (global_size != 1)
+    reel_fail("nested calls to PCU_Thrd_Run");
+  if (pthread_key_create(&rank_key,NULL))
+    reel_fail("pthread_key_create failed");
+  global_size = count;
+  start_info* infos;
+  NOTO_MALLOC(infos,count);
+  pthread_t* threads;
+  NOTO_MALLOC(threads,count);
+  for (int i = 0; i < count; ++i)
+  {
+    infos[i].rank = i;
+    infos[i].function = function;
+    infos[i].in_out = in_out;
+  }
+  for (int i = 1; i < count; ++i)
+    if (pthread_create(&threads[i],NULL,start,&infos[i]))
+      reel_fail("pthread_create failed for thread %d",i);
+  start(&infos[0]);
+  for (int i = 1; i < count; ++i)
+    pthread_join(threads[i],NULL);
+  pthread_setspecific(rank_key,NULL);
+  pthread_key_delete(rank_key);
+  noto_free(threads);
+  noto_free(infos);
+  global_size = 1;
+}
+
+int pcu_thread_size(void)
+{
+  return global_size;
+}
+
+int pcu_thread_rank(void)
+{
+  if (global_size == 1)
+    return 0;
+  start_info* info = pthread_getspecific(rank_key);
+  return info->rank;
+}
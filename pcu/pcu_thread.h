@@ -0,0 +1,25 @@
+/****************************************************************************** 
+
+  Copyright 2011 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef PCU_THREAD_H
+#define PCU_THREAD_H
+
+/* runs count threads of a process, each with its own
+   rank from 0 to count-1. The calling thread becomes
+   thread 0 and the call returns when all threads do.
+   Thread i is given in_out[i] and its result replaces it.
+   Outside of pcu_run_threads, the rank is 0 and the size 1. */
+
+typedef void* pcu_thread(void*);
+
+void pcu_run_threads(int count, pcu_thread* function, void** in_out);
+int pcu_thread_size(void);
+int pcu_thread_rank(void);
+
+#endif
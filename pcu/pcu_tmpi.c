@@ -0,0 +1,252 @@
+/****************************************************************************** 
+
+  Copyright 2011 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_tmpi.h"
+#include "pcu_pmpi.h"
+#include "pcu_thread.h"
+#include "noto_malloc.h"
+#include "reel.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <limits.h>
+
+/* A message between two threads of the same process does not
+   go through MPI: the sender posts it in the mailbox of the
+   receiving thread, which copies the sender's buffer straight
+   into its own. Like MPI_Issend, the send is only done once the
+   message has been received, so the buffer stays valid until
+   then and pcu_msg can detect the end of a phase as usual.
+
+   Messages to other processes use a duplicate of the PCU
+   communicator for each receiving thread, and the tag is the
+   thread that sent them, so that a thread can probe for
+   messages from any rank without seeing those of the others.
+   This requires MPI_THREAD_MULTIPLE. */
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  struct pcu_mail* first;
+  struct pcu_mail* last;
+} mailbox;
+
+struct pcu_mail
+{
+  mailbox* box;
+  void* data; //the sender's buffer, valid until taken
+  size_t size;
+  int from; //thread rank of the sender
+  bool taken;
+  struct pcu_mail* next;
+};
+
+//pcu_msg and pcu_coll messages are kept apart, as with MPI
+enum { user_channel, coll_channel, channels };
+
+static int global_threads;
+static mailbox* global_boxes[channels];
+static MPI_Comm* global_comms[channels];
+
+static int get_channel(MPI_Comm comm)
+{
+  if (comm == pcu_user_comm)
+    return user_channel;
+  if (comm == pcu_coll_comm)
+    return coll_channel;
+  reel_fail("PCU thread message on an unknown communicator");
+  return -1;
+}
+
+static int tmpi_size(void)
+{
+  return pcu_pmpi_size() * global_threads;
+}
+
+static int tmpi_rank(void)
+{
+  return pcu_pmpi_rank() * global_threads + pcu_thread_rank();
+}
+
+static void tmpi_send(pcu_message* m, MPI_Comm comm)
+{
+  int c = get_channel(comm);
+  int process = m->peer / global_threads;
+  int thread = m->peer % global_threads;
+  if (process != pcu_pmpi_rank())
+  {
+    if (m->buffer.size > (size_t)INT_MAX)
+      reel_fail("PCU message size exceeds INT_MAX");
+    m->mail = NULL;
+    MPI_Issend(m->buffer.start,(int)(m->buffer.size),MPI_BYTE,
+        process,pcu_thread_rank(),global_comms[c][thread],&(m->request));
+    return;
+  }
+  struct pcu_mail* mail;
+  NOTO_MALLOC(mail,1);
+  mail->box = &(global_boxes[c][thread]);
+  mail->data = m->buffer.start;
+  mail->size = m->buffer.size;
+  mail->from = pcu_thread_rank();
+  mail->taken = false;
+  mail->next = NULL;
+  mailbox* box = mail->box;
+  pthread_mutex_lock(&(box->lock));
+  if (box->last)
+    box->last->next = mail;
+  else
+    box->first = mail;
+  box->last = mail;
+  pthread_mutex_unlock(&(box->lock));
+  m->mail = mail;
+}
+
+/* callers poll until something arrives, and the threads of a
+   process may well outnumber its cores, so give the core to
+   another thread instead of spinning */
+static bool idle(void)
+{
+  sched_yield();
+  return false;
+}
+
+static bool tmpi_done(pcu_message* m)
+{
+  if ( ! m->mail)
+  {
+    if (m->request == MPI_REQUEST_NULL)
+      return true;
+    int flag;
+    MPI_Test(&(m->request),&flag,MPI_STATUS_IGNORE);
+    return flag;
+  }
+  struct pcu_mail* mail = m->mail;
+  pthread_mutex_lock(&(mail->box->lock));
+  bool taken = mail->taken;
+  pthread_mutex_unlock(&(mail->box->lock));
+  if ( ! taken)
+    return idle();
+  noto_free(mail);
+  m->mail = NULL;
+  m->request = MPI_REQUEST_NULL;
+  return true;
+}
+
+/* takes the oldest mail from thread (from), or from
+   any thread if (from) is negative */
+static bool take_mail(mailbox* box, int from, pcu_message* m)
+{
+  pthread_mutex_lock(&(box->lock));
+  struct pcu_mail* prev = NULL;
+  struct pcu_mail* mail = box->first;
+  while (mail && from >= 0 && mail->from != from)
+  {
+    prev = mail;
+    mail = mail->next;
+  }
+  if (mail)
+  {
+    if (prev)
+      prev->next = mail->next;
+    else
+      box->first = mail->next;
+    if (box->last == mail)
+      box->last = prev;
+  }
+  pthread_mutex_unlock(&(box->lock));
+  if ( ! mail)
+    return false;
+  pcu_resize_buffer(&(m->buffer),mail->size);
+  if (mail->size)
+    memcpy(m->buffer.start,mail->data,mail->size);
+  m->peer = pcu_pmpi_rank() * global_threads + mail->from;
+  pthread_mutex_lock(&(box->lock));
+  mail->taken = true;
+  pthread_mutex_unlock(&(box->lock));
+  return true;
+}
+
+static bool tmpi_receive(pcu_message* m, MPI_Comm comm)
+{
+  int c = get_channel(comm);
+  int self = pcu_thread_rank();
+  int process = MPI_ANY_SOURCE;
+  int thread = MPI_ANY_TAG;
+  if (m->peer != MPI_ANY_SOURCE)
+  {
+    process = m->peer / global_threads;
+    thread = m->peer % global_threads;
+  }
+  if ((process == MPI_ANY_SOURCE)||(process == pcu_pmpi_rank()))
+    if (take_mail(&(global_boxes[c][self]),
+          process == MPI_ANY_SOURCE ? -1 : thread, m))
+      return true;
+  if ((process == pcu_pmpi_rank())||(pcu_pmpi_size() == 1))
+    return idle();
+  MPI_Comm tcomm = global_comms[c][self];
+  MPI_Status status;
+  int flag;
+  MPI_Iprobe(process,thread,tcomm,&flag,&status);
+  if ( ! flag)
+    return idle();
+  int count;
+  MPI_Get_count(&status,MPI_BYTE,&count);
+  pcu_resize_buffer(&(m->buffer),(size_t)count);
+  MPI_Recv(m->buffer.start,count,MPI_BYTE,
+      status.MPI_SOURCE,status.MPI_TAG,tcomm,MPI_STATUS_IGNORE);
+  m->peer = status.MPI_SOURCE * global_threads + status.MPI_TAG;
+  return true;
+}
+
+pcu_mpi pcu_tmpi =
+{ .size = tmpi_size,
+  .rank = tmpi_rank,
+  .send = tmpi_send,
+  .done = tmpi_done,
+  .receive = tmpi_receive };
+
+/* called by all processes before their threads start */
+void pcu_tmpi_init(int threads)
+{
+  int range[2] = {-threads, threads};
+  MPI_Allreduce(MPI_IN_PLACE,range,2,MPI_INT,MPI_MAX,pcu_coll_comm);
+  if (-range[0] != range[1])
+    reel_fail("PCU_Thrd_Run called with different thread counts");
+  global_threads = threads;
+  MPI_Comm base[channels] = {pcu_user_comm, pcu_coll_comm};
+  for (int c = 0; c < channels; ++c)
+  {
+    NOTO_MALLOC(global_boxes[c],threads);
+    NOTO_MALLOC(global_comms[c],threads);
+    for (int i = 0; i < threads; ++i)
+    {
+      pthread_mutex_init(&(global_boxes[c][i].lock),NULL);
+      global_boxes[c][i].first = NULL;
+      global_boxes[c][i].last = NULL;
+      MPI_Comm_dup(base[c],&(global_comms[c][i]));
+    }
+  }
+}
+
+void pcu_tmpi_finalize(void)
+{
+  for (int c = 0; c < channels; ++c)
+  {
+    for (int i = 0; i < global_threads; ++i)
+    {
+      if (global_boxes[c][i].first)
+        reel_fail("PCU thread messages were never received");
+      pthread_mutex_destroy(&(global_boxes[c][i].lock));
+      MPI_Comm_free(&(global_comms[c][i]));
+    }
+    noto_free(global_boxes[c]);
+    noto_free(global_comms[c]);
+  }
+  global_threads = 0;
+}
@@ -0,0 +1,24 @@
+/****************************************************************************** 
+
+  Copyright 2011 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef PCU_TMPI_H
+#define PCU_TMPI_H
+
+#include "pcu_mpi.h"
+
+/* the pcu_mpi implementation used while several threads
+   per process run, see PCU_Thrd_Run.
+   Ranks are (process rank) * threads + (thread rank). */
+
+void pcu_tmpi_init(int threads);
+void pcu_tmpi_finalize(void);
+
+extern pcu_mpi pcu_tmpi;
+
+#endif
@@ -29,6 +29,10 @@ class SInt : public apf::Integrator
     {
       PCU_Add_Doubles(&r,1);
     }
+    void join(apf::Integrator* copy)
+    {
+      r += static_cast<SInt*>(copy)->r;
+    }
     void reset() {r=0;}
     double r;
 };
@@ -117,6 +121,10 @@ class SelfProduct : public SInt
       apf::getComponents(element, p, &v[0]);
       r += (v * v) * w * dV;
     }
+    apf::Integrator* clone()
+    {
+      return new SelfProduct(estimation);
+    }
   private:
     Estimation* estimation;
     apf::Element* element;
@@ -183,6 +191,10 @@ class Error : public ElementError
       double p = estimation->recovered_order;
       r += pow(sqrt(sum), ((2 * d) / (2 * p + d)));
     }
+    apf::Integrator* clone()
+    {
+      return new Error(estimation);
+    }
 };
 
 /* computes the $\|e_\epsilon\|^{-\frac{2}{2p+d}}_e$ term
@@ -70,6 +70,10 @@ class ScalarIntegrator : public apf::Integrator
     {
       PCU_Add_Doubles(&result,1);
     }
+    void join(apf::Integrator* copy)
+    {
+      result += static_cast<ScalarIntegrator*>(copy)->result;
+    }
     double result;
 };
 
@@ -126,6 +130,10 @@ class GlobalErrorTerm : public ElementError
       double p = estimation->recovered_order;
       result += pow(sqrt(sum), ((2*d)/(2*p+d)));
     }
+    apf::Integrator* clone()
+    {
+      return new GlobalErrorTerm(estimation);
+    }
 };
 
 static void computeSizeFactor(Estimation* e)
@@ -0,0 +1,116 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cmath>
+#include <cstdlib>
+
+/* sums dV, inverse Jacobians and field gradients over every
+   integration point, as an assembly loop would */
+static double sweep(apf::Field* f, int order)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  int dim = m->getDimension();
+  double sum = 0;
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(dim);
+  while ((e = m->iterate(it))) {
+    apf::MeshElement* me = apf::createMeshElement(m, e);
+    apf::Element* fe = apf::createElement(f, me);
+    int np = apf::countIntPoints(me, order);
+    for (int p = 0; p < np; ++p) {
+      apf::Vector3 xi, g;
+      apf::getIntPoint(me, order, p, xi);
+      apf::Matrix3x3 jinv;
+      apf::getJacobianInv(me, xi, jinv);
+      apf::getGrad(fe, xi, g);
+      double dv = apf::getDV(me, xi);
+      sum += (jinv[0][0] + jinv[1][1] + jinv[2][2] + g * g) * dv;
+    }
+    apf::destroyElement(fe);
+    apf::destroyMeshElement(me);
+  }
+  m->end(it);
+  return sum;
+}
+
+static double timeSweeps(apf::Field* f, int order, int steps, bool cache,
+    double* sum)
+{
+  apf::setAffineCaching(cache);
+  double t0 = PCU_Time();
+  for (int i = 0; i < steps; ++i)
+    *sum = sweep(f, order);
+  double t = (PCU_Time() - t0) / steps;
+  apf::setAffineCaching(true);
+  return t;
+}
+
+/* MeshElements made after a vertex moves see the new geometry */
+static void checkMove(apf::Mesh2* m)
+{
+  apf::MeshIterator* it = m->begin(3);
+  apf::MeshEntity* tet = m->iterate(it);
+  m->end(it);
+  apf::Downward v;
+  m->getDownward(tet, 0, v);
+  double before = apf::measure(m, tet);
+  apf::Vector3 x;
+  m->getPoint(v[0], 0, x);
+  apf::Vector3 c = apf::getLinearCentroid(m, tet);
+  /* halfway to the centroid, the vertex is 5/8 as far from
+     the opposite face */
+  m->setPoint(v[0], 0, (x + c) / 2);
+  double after = apf::measure(m, tet);
+  m->setPoint(v[0], 0, x);
+  lion_oprint(1, "volume %g before moving, %g after\n", before, after);
+  PCU_ALWAYS_ASSERT(std::fabs(after / before - 5. / 8.) < 1e-12);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <steps>\n"
+          "  times integration point geometry over an n^3 box of\n"
+          "  linear tets with and without cached affine Jacobians\n",
+          argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  PCU_ALWAYS_ASSERT(PCU_Comm_Peers() == 1);
+  int n = atoi(argv[1]);
+  int steps = atoi(argv[2]);
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true);
+  apf::Field* f = apf::createLagrangeField(m, "u", apf::SCALAR, 2);
+  for (int d = 0; d <= 1; ++d) {
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it))) {
+      apf::Vector3 x = apf::getLinearCentroid(m, e);
+      apf::setScalar(f, e, 0, x[0] * x[1] + x[2]);
+    }
+    m->end(it);
+  }
+  lion_oprint(1, "seconds per sweep\n%6s %12s %12s\n",
+      "order", "computed", "cached");
+  for (int order = 1; order <= 4; ++order) {
+    double computed, cached;
+    double t0 = timeSweeps(f, order, steps, false, &computed);
+    double t1 = timeSweeps(f, order, steps, true, &cached);
+    /* the cache holds exactly what every point computes */
+    PCU_ALWAYS_ASSERT(computed == cached);
+    lion_oprint(1, "%6d %12f %12f\n", order, t0, t1);
+  }
+  checkMove(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
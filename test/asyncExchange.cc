@@ -0,0 +1,122 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apfCavityOp.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include "slabs.h"
+
+static int const n = 4;
+
+/* everyone sends to everyone and polls before listening */
+static void testPolling()
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  PCU_Comm_Begin();
+  for (int to = 0; to < peers; ++to)
+    PCU_COMM_PACK(to, self);
+  PCU_Comm_Send();
+  while (!PCU_Comm_Test());
+  int count = 0;
+  while (PCU_Comm_Receive()) {
+    int from;
+    PCU_COMM_UNPACK(from);
+    PCU_ALWAYS_ASSERT(from == PCU_Comm_Sender());
+    ++count;
+  }
+  PCU_ALWAYS_ASSERT(count == peers);
+}
+
+static void testSynchronize(apf::Mesh2* m)
+{
+  apf::Field* f = apf::createLagrangeField(m, "f", apf::SCALAR, 1);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it)))
+    apf::setScalar(f, v, 0, m->isOwned(v) ? PCU_Comm_Self() : -1);
+  m->end(it);
+  apf::startSynchronize(f);
+  /* local work that does not touch the field */
+  double volume = 0;
+  it = m->begin(3);
+  apf::MeshEntity* e;
+  while ((e = m->iterate(it))) {
+    volume += apf::measure(m, e);
+    apf::testSynchronize();
+  }
+  m->end(it);
+  apf::finishSynchronize(f);
+  it = m->begin(0);
+  while ((v = m->iterate(it)))
+    PCU_ALWAYS_ASSERT(apf::getScalar(f, v, 0) == m->getOwner(v));
+  m->end(it);
+  PCU_ALWAYS_ASSERT(PCU_Add_Double(volume) > 0.999);
+  apf::destroyField(f);
+}
+
+/* marks each vertex once all of its elements are on one part */
+class MarkVertices : public apf::CavityOp
+{
+  public:
+    MarkVertices(apf::Mesh* m, apf::MeshTag* t):
+      apf::CavityOp(m), tag(t), vertex(0)
+    {
+    }
+    Outcome setEntity(apf::MeshEntity* e)
+    {
+      if (mesh->hasTag(e, tag))
+        return SKIP;
+      if (!requestLocality(&e, 1))
+        return REQUEST;
+      vertex = e;
+      return OK;
+    }
+    void apply()
+    {
+      int one = 1;
+      mesh->setIntTag(vertex, tag, &one);
+    }
+  private:
+    apf::MeshTag* tag;
+    apf::MeshEntity* vertex;
+};
+
+static void testCavities(apf::Mesh2* m)
+{
+  long vertices = apf::countOwned(m, 0);
+  vertices = PCU_Add_Long(vertices);
+  apf::MeshTag* tag = m->createIntTag("marked", 1);
+  MarkVertices op(m, tag);
+  op.applyToDimension(0);
+  long marked = 0;
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it)))
+    if (m->isOwned(v)) {
+      PCU_ALWAYS_ASSERT(m->hasTag(v, tag));
+      ++marked;
+    }
+  m->end(it);
+  PCU_ALWAYS_ASSERT(PCU_Add_Long(marked) == vertices);
+  apf::removeTagFromDimension(m, tag, 0);
+  m->destroyTag(tag);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  testPolling();
+  apf::Mesh2* m = makeSlabs(n);
+  testSynchronize(m);
+  testCavities(m);
+  m->verify();
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,218 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+static void setValues(apf::Field* u, apf::Field* v)
+{
+  apf::Mesh* m = apf::getMesh(u);
+  for (int d = 0; d <= 1; ++d) {
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it))) {
+      apf::Vector3 x = apf::getLinearCentroid(m, e);
+      apf::setScalar(u, e, 0, x[0] * x[1] + x[2] * x[2]);
+      apf::setVector(v, e, 0, apf::Vector3(x[1] * x[2], x[0], x[0] * x[2]));
+    }
+    m->end(it);
+  }
+}
+
+static bool close(double a, double b)
+{
+  return std::fabs(a - b) <= 1e-12 * (1 + std::fabs(a));
+}
+
+/* values and gradients of a scalar and a vector field at the
+   integration points of every element, one point per call */
+static double perPoint(apf::Field* u, apf::Field* v, int order,
+    std::vector<double>& out)
+{
+  apf::Mesh* m = apf::getMesh(u);
+  out.clear();
+  double t0 = PCU_Time();
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(m->getDimension());
+  while ((e = m->iterate(it))) {
+    apf::MeshElement* me = apf::createMeshElement(m, e);
+    apf::Element* ue = apf::createElement(u, me);
+    apf::Element* ve = apf::createElement(v, me);
+    int np = apf::countIntPoints(me, order);
+    for (int p = 0; p < np; ++p) {
+      apf::Vector3 xi, g, x;
+      apf::Matrix3x3 dx;
+      apf::getIntPoint(me, order, p, xi);
+      out.push_back(apf::getScalar(ue, xi));
+      apf::getGrad(ue, xi, g);
+      apf::getVector(ve, xi, x);
+      apf::getVectorGrad(ve, xi, dx);
+      for (int d = 0; d < 3; ++d)
+        out.push_back(g[d]);
+      for (int c = 0; c < 3; ++c)
+        out.push_back(x[c]);
+      for (int c = 0; c < 3; ++c)
+        for (int d = 0; d < 3; ++d)
+          out.push_back(dx[d][c]);
+    }
+    apf::destroyElement(ue);
+    apf::destroyElement(ve);
+    apf::destroyMeshElement(me);
+  }
+  m->end(it);
+  return PCU_Time() - t0;
+}
+
+/* the same, all points of an element per call */
+static double batched(apf::Field* u, apf::Field* v, int order,
+    std::vector<double>& out)
+{
+  apf::Mesh* m = apf::getMesh(u);
+  out.clear();
+  std::vector<apf::Vector3> xi;
+  std::vector<double> b(28 * 64);
+  double t0 = PCU_Time();
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(m->getDimension());
+  while ((e = m->iterate(it))) {
+    apf::MeshElement* me = apf::createMeshElement(m, e);
+    apf::Element* ue = apf::createElement(u, me);
+    apf::Element* ve = apf::createElement(v, me);
+    int np = apf::countIntPoints(me, order);
+    xi.resize(np);
+    for (int p = 0; p < np; ++p)
+      apf::getIntPoint(me, order, p, xi[p]);
+    if (int(b.size()) < 16 * np)
+      b.resize(16 * np);
+    double* us = &b[0];
+    double* ug = us + np;
+    double* vs = ug + 3 * np;
+    double* vg = vs + 3 * np;
+    apf::getComponents(ue, np, &xi[0], us);
+    apf::getComponentGrads(ue, np, &xi[0], ug);
+    apf::getComponents(ve, np, &xi[0], vs);
+    apf::getComponentGrads(ve, np, &xi[0], vg);
+    for (int p = 0; p < np; ++p) {
+      out.push_back(us[p]);
+      for (int d = 0; d < 3; ++d)
+        out.push_back(ug[d * np + p]);
+      for (int c = 0; c < 3; ++c)
+        out.push_back(vs[c * np + p]);
+      for (int c = 0; c < 3; ++c)
+        for (int d = 0; d < 3; ++d)
+          out.push_back(vg[(c * 3 + d) * np + p]);
+    }
+    apf::destroyElement(ue);
+    apf::destroyElement(ve);
+    apf::destroyMeshElement(me);
+  }
+  m->end(it);
+  return PCU_Time() - t0;
+}
+
+static void comparePoints(apf::Field* u, apf::Field* v, int steps)
+{
+  lion_oprint(1, "seconds per sweep over the integration points\n"
+      "%6s %12s %12s\n", "order", "per point", "batched");
+  std::vector<double> a, b;
+  for (int order = 1; order <= 4; ++order) {
+    double t[2] = {0, 0};
+    for (int i = 0; i < steps; ++i) {
+      t[0] += perPoint(u, v, order, a);
+      t[1] += batched(u, v, order, b);
+    }
+    PCU_ALWAYS_ASSERT(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i)
+      PCU_ALWAYS_ASSERT(close(a[i], b[i]));
+    lion_oprint(1, "%6d %12f %12f\n", order, t[0] / steps, t[1] / steps);
+  }
+}
+
+/* the vector field at one point of every element, one element
+   per call or (batch) elements per call */
+static double acrossElements(apf::Field* v, int batch,
+    std::vector<double>& out)
+{
+  apf::Mesh* m = apf::getMesh(v);
+  apf::Vector3 xi(0.25, 0.25, 0.25);
+  out.clear();
+  std::vector<apf::MeshEntity*> elements;
+  std::vector<double> b(3 * batch);
+  double t0 = PCU_Time();
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(m->getDimension());
+  bool done = false;
+  while (!done) {
+    elements.clear();
+    while (int(elements.size()) < batch && (e = m->iterate(it)))
+      elements.push_back(e);
+    done = int(elements.size()) < batch;
+    int n = int(elements.size());
+    if (!n)
+      break;
+    if (batch == 1) {
+      apf::Element* ve = apf::createElement(v, elements[0]);
+      apf::getComponents(ve, xi, &b[0]);
+      apf::destroyElement(ve);
+    } else
+      apf::getComponents(v, n, &elements[0], xi, &b[0]);
+    for (int i = 0; i < n; ++i)
+      for (int c = 0; c < 3; ++c)
+        out.push_back(b[c * n + i]);
+  }
+  m->end(it);
+  return PCU_Time() - t0;
+}
+
+static void compareElements(apf::Field* v, int steps)
+{
+  lion_oprint(1, "seconds per sweep at one point of every element\n"
+      "%6s %12s\n", "batch", "seconds");
+  std::vector<double> a, b;
+  for (int batch = 1; batch <= 256; batch *= 4) {
+    double t = 0;
+    for (int i = 0; i < steps; ++i)
+      t += acrossElements(v, batch, batch == 1 ? a : b);
+    if (batch > 1) {
+      PCU_ALWAYS_ASSERT(a.size() == b.size());
+      for (size_t i = 0; i < a.size(); ++i)
+        PCU_ALWAYS_ASSERT(close(a[i], b[i]));
+    }
+    lion_oprint(1, "%6d %12f\n", batch, t / steps);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <steps>\n"
+          "  evaluates quadratic fields on an n^3 box one point per\n"
+          "  call and in batches, checking they agree\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  PCU_ALWAYS_ASSERT(PCU_Comm_Peers() == 1);
+  int n = atoi(argv[1]);
+  int steps = atoi(argv[2]);
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true);
+  apf::Field* u = apf::createLagrangeField(m, "u", apf::SCALAR, 2);
+  apf::Field* v = apf::createLagrangeField(m, "v", apf::VECTOR, 2);
+  setValues(u, v);
+  comparePoints(u, v, steps);
+  compareElements(v, steps);
+  apf::destroyField(u);
+  apf::destroyField(v);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
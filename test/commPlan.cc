@@ -0,0 +1,113 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include "slabs.h"
+
+static int const n = 4;
+
+/* owned nodes get their position, copies get garbage */
+static void setValues(apf::Field* f)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(0);
+  while ((e = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(e, 0, x);
+    if (!m->isOwned(e))
+      x = apf::Vector3(-1, -1, -1);
+    apf::setVector(f, e, 0, x);
+  }
+  m->end(it);
+}
+
+static void checkValues(apf::Field* f)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(0);
+  while ((e = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(e, 0, x);
+    apf::Vector3 v;
+    apf::getVector(f, e, 0, v);
+    PCU_ALWAYS_ASSERT((v - x).getLength() == 0);
+  }
+  m->end(it);
+}
+
+/* every other layer of vertices along y, which all copies agree on */
+static bool hasHalfData(apf::Mesh* m, apf::MeshEntity* v)
+{
+  apf::Vector3 x;
+  m->getPoint(v, 0, x);
+  return int(x[1] * n + 0.5) % 2;
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  apf::Mesh2* m = makeSlabs(n);
+  apf::Field* f = apf::createLagrangeField(m, "f", apf::VECTOR, 1);
+  apf::Field* s = apf::createLagrangeField(m, "s", apf::SCALAR, 1);
+  apf::CommPlan* plan = apf::createCommPlan(m, apf::getShape(f));
+  setValues(f);
+  apf::synchronize(plan, f);
+  checkValues(f);
+  /* fewer components remake the requests */
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(0);
+  while ((e = m->iterate(it)))
+    apf::setScalar(s, e, 0, m->isOwned(e) ? m->getOwner(e) : -1);
+  m->end(it);
+  apf::synchronize(plan, s);
+  it = m->begin(0);
+  while ((e = m->iterate(it)))
+    PCU_ALWAYS_ASSERT(apf::getScalar(s, e, 0) == m->getOwner(e));
+  m->end(it);
+  /* entities without values are skipped as apf::synchronize does */
+  apf::Field* h = apf::createLagrangeField(m, "h", apf::SCALAR, 1);
+  it = m->begin(0);
+  while ((e = m->iterate(it)))
+    if (m->isOwned(e) && hasHalfData(m, e))
+      apf::setScalar(h, e, 0, m->getOwner(e));
+  m->end(it);
+  apf::synchronize(plan, h);
+  it = m->begin(0);
+  while ((e = m->iterate(it))) {
+    PCU_ALWAYS_ASSERT(apf::hasEntity(h, e) == hasHalfData(m, e));
+    if (apf::hasEntity(h, e))
+      PCU_ALWAYS_ASSERT(apf::getScalar(h, e, 0) == m->getOwner(e));
+  }
+  m->end(it);
+  apf::destroyField(h);
+  /* migration makes the plan rebuild itself */
+  cutSlabs(m, 1);
+  setValues(f);
+  apf::synchronize(plan, f);
+  checkValues(f);
+  int const steps = 20;
+  double t0 = PCU_Time();
+  for (int i = 0; i < steps; ++i)
+    apf::synchronize(f);
+  double t1 = PCU_Time();
+  for (int i = 0; i < steps; ++i)
+    apf::synchronize(plan, f);
+  double t2 = PCU_Time();
+  checkValues(f);
+  if (!PCU_Comm_Self())
+    lion_oprint(1, "%d synchronizations: %f seconds, %f with a plan\n",
+        steps, t1 - t0, t2 - t1);
+  apf::destroyCommPlan(plan);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
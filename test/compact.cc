@@ -0,0 +1,191 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <vector>
+#include "slabs.h"
+
+/* punch holes into the MDS arrays by removing
+   every third element and whatever it leaves unused */
+static void makeHoles(apf::Mesh2* m)
+{
+  int d = m->getDimension();
+  std::vector<apf::MeshEntity*> doomed;
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(d);
+  int i = 0;
+  while ((e = m->iterate(it)))
+    if (i++ % 3 == 0)
+      doomed.push_back(e);
+  m->end(it);
+  for (size_t j = 0; j < doomed.size(); ++j)
+    m->destroy(doomed[j]);
+  for (int dim = d - 1; dim >= 0; --dim) {
+    doomed.clear();
+    it = m->begin(dim);
+    while ((e = m->iterate(it)))
+      if (!m->hasUp(e))
+        doomed.push_back(e);
+    m->end(it);
+    for (size_t j = 0; j < doomed.size(); ++j)
+      m->destroy(doomed[j]);
+  }
+}
+
+/* label entities in iteration order and remember
+   their coordinates and downward adjacencies by label */
+static void label(apf::Mesh2* m, apf::MeshTag* t,
+    std::vector<std::vector<int> >& down, std::vector<apf::Vector3>& x)
+{
+  int d = m->getDimension();
+  down.clear();
+  x.clear();
+  for (int dim = 0; dim <= d; ++dim) {
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(dim);
+    int i = 0;
+    while ((e = m->iterate(it))) {
+      m->setIntTag(e, t, &i);
+      ++i;
+      if (dim == 0) {
+        apf::Vector3 p;
+        m->getPoint(e, 0, p);
+        x.push_back(p);
+      }
+    }
+    m->end(it);
+  }
+  for (int dim = 1; dim <= d; ++dim) {
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(dim);
+    while ((e = m->iterate(it))) {
+      std::vector<int> labels;
+      for (int dd = 0; dd < dim; ++dd) {
+        apf::Downward de;
+        int n = m->getDownward(e, dd, de);
+        for (int j = 0; j < n; ++j) {
+          int l;
+          m->getIntTag(de[j], t, &l);
+          labels.push_back(l);
+        }
+      }
+      down.push_back(labels);
+    }
+    m->end(it);
+  }
+}
+
+static void check(apf::Mesh2* m, apf::MeshTag* t,
+    std::vector<std::vector<int> > const& down,
+    std::vector<apf::Vector3> const& x)
+{
+  int d = m->getDimension();
+  size_t k = 0;
+  for (int dim = 0; dim <= d; ++dim) {
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(dim);
+    int i = 0;
+    while ((e = m->iterate(it))) {
+      PCU_ALWAYS_ASSERT(apf::getMdsIndex(m, e) == i);
+      PCU_ALWAYS_ASSERT(apf::getMdsEntity(m, dim, i) == e);
+      int l;
+      m->getIntTag(e, t, &l);
+      PCU_ALWAYS_ASSERT(l == i);
+      apf::Up up;
+      m->getUp(e, up);
+      for (int j = 0; j < up.n; ++j) {
+        apf::Downward ud;
+        int n = m->getDownward(up.e[j], dim, ud);
+        PCU_ALWAYS_ASSERT(apf::findIn(ud, n, e) >= 0);
+      }
+      if (dim == 0) {
+        apf::Vector3 p;
+        m->getPoint(e, 0, p);
+        PCU_ALWAYS_ASSERT((p - x[i]).getLength() == 0);
+      } else {
+        std::vector<int> labels;
+        for (int dd = 0; dd < dim; ++dd) {
+          apf::Downward de;
+          int n = m->getDownward(e, dd, de);
+          for (int j = 0; j < n; ++j) {
+            m->getIntTag(de[j], t, &l);
+            labels.push_back(l);
+          }
+        }
+        PCU_ALWAYS_ASSERT(labels == down[k++]);
+      }
+      ++i;
+    }
+    m->end(it);
+  }
+  PCU_ALWAYS_ASSERT(k == down.size());
+}
+
+static void testMesh(apf::Mesh2* m)
+{
+  makeHoles(m);
+  apf::MeshTag* t = m->createIntTag("label", 1);
+  std::vector<std::vector<int> > down;
+  std::vector<apf::Vector3> x;
+  label(m, t, down, x);
+  apf::compactMdsMesh(m);
+  check(m, t, down, x);
+  /* the compacted mesh can still be modified */
+  apf::MeshEntity* v = m->createVert(0);
+  m->destroy(v);
+  apf::compactMdsMesh(m);
+  check(m, t, down, x);
+  m->destroyTag(t);
+}
+
+/* migrating the slabs around leaves holes behind on every part,
+   compacting them must keep the remote copies consistent */
+static void testDistributed()
+{
+  apf::Mesh2* m = makeSlabs(4);
+  cutSlabs(m, 1);
+  apf::compactMdsMesh(m);
+  for (int dim = 0; dim <= 3; ++dim) {
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(dim);
+    int i = 0;
+    while ((e = m->iterate(it)))
+      PCU_ALWAYS_ASSERT(apf::getMdsIndex(m, e) == i++);
+    m->end(it);
+  }
+  apf::verify(m);
+  /* and the compacted parts can still migrate */
+  cutSlabs(m, 2);
+  apf::compactMdsMesh(m);
+  apf::verify(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (PCU_Comm_Peers() > 1) {
+    testDistributed();
+    PCU_Comm_Free();
+    MPI_Finalize();
+    return 0;
+  }
+  for (int simplex = 0; simplex < 2; ++simplex) {
+    apf::Mesh2* m = apf::makeMdsBox(4, 4, 4, 1, 1, 1, simplex);
+    testMesh(m);
+    m->destroyNative();
+    apf::destroyMesh(m);
+    m = apf::makeMdsBox(6, 6, 0, 1, 1, 0, simplex);
+    testMesh(m);
+    m->destroyNative();
+    apf::destroyMesh(m);
+  }
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,74 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <vector>
+
+typedef std::vector<apf::MeshEntity*> Adjacencies;
+
+static void collect(apf::Mesh* m, int from, int to, Adjacencies& out)
+{
+  out.clear();
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(from);
+  while ((e = m->iterate(it))) {
+    apf::Adjacent adj;
+    m->getAdjacent(e, to, adj);
+    out.push_back(0);
+    for (size_t i = 0; i < adj.getSize(); ++i)
+      out.push_back(adj[i]);
+  }
+  m->end(it);
+}
+
+static void testMesh(apf::Mesh2* m)
+{
+  int d = m->getDimension();
+  std::vector<Adjacencies> before;
+  for (int from = 0; from <= d; ++from)
+  for (int to = 0; to <= d; ++to) {
+    before.push_back(Adjacencies());
+    collect(m, from, to, before.back());
+  }
+  std::size_t bytes = apf::freezeMdsMesh(m);
+  PCU_ALWAYS_ASSERT(bytes > 0);
+  PCU_ALWAYS_ASSERT(bytes <= apf::getMdsFrozenBytes(m));
+  int k = 0;
+  Adjacencies after;
+  for (int from = 0; from <= d; ++from)
+  for (int to = 0; to <= d; ++to) {
+    collect(m, from, to, after);
+    PCU_ALWAYS_ASSERT(after == before[k++]);
+  }
+  /* any topology change must drop the snapshot */
+  apf::MeshEntity* v = m->createVert(0);
+  PCU_ALWAYS_ASSERT(apf::getMdsFrozenBytes(m) == 0);
+  m->destroy(v);
+  apf::freezeMdsAdjacency(m, 0, d);
+  PCU_ALWAYS_ASSERT(apf::getMdsFrozenBytes(m) > 0);
+  apf::thawMdsMesh(m);
+  PCU_ALWAYS_ASSERT(apf::getMdsFrozenBytes(m) == 0);
+  m->verify();
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  for (int simplex = 0; simplex < 2; ++simplex) {
+    apf::Mesh2* m = apf::makeMdsBox(3, 3, 3, 1, 1, 1, simplex);
+    testMesh(m);
+    m->destroyNative();
+    apf::destroyMesh(m);
+    m = apf::makeMdsBox(4, 4, 0, 1, 1, 0, simplex);
+    testMesh(m);
+    m->destroyNative();
+    apf::destroyMesh(m);
+  }
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
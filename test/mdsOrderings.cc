@@ -0,0 +1,80 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "orderings.h"
+
+static double totalMeasure(apf::Mesh2* m)
+{
+  double sum = 0;
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(m->getDimension());
+  while ((e = m->iterate(it)))
+    sum += apf::measure(m, e);
+  m->end(it);
+  return sum;
+}
+
+/* every index from 0 to the count appears once */
+static void checkIndices(apf::Mesh2* m, int d)
+{
+  std::vector<bool> seen(m->count(d), false);
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(d);
+  while ((e = m->iterate(it))) {
+    int i = apf::getMdsIndex(m, e);
+    PCU_ALWAYS_ASSERT(0 <= i && i < int(seen.size()));
+    PCU_ALWAYS_ASSERT(!seen[i]);
+    seen[i] = true;
+    PCU_ALWAYS_ASSERT(apf::getMdsEntity(m, d, i) == e);
+  }
+  m->end(it);
+}
+
+static void check(bool simplex, apf::MdsOrdering ordering)
+{
+  apf::Mesh2* m = apf::makeMdsBox(6, 5, 4, 1, 1, 1, simplex);
+  int d = m->getDimension();
+  scramble(m);
+  size_t counts[4];
+  for (int i = 0; i <= d; ++i)
+    counts[i] = m->count(i);
+  double measure = totalMeasure(m);
+  long scrambled = bandwidth(m);
+  apf::reorderMdsMesh(m, ordering);
+  m->verify();
+  for (int i = 0; i <= d; ++i) {
+    PCU_ALWAYS_ASSERT(m->count(i) == counts[i]);
+    checkIndices(m, i);
+  }
+  PCU_ALWAYS_ASSERT(std::fabs(totalMeasure(m) - measure) < 1e-12);
+  long bw = bandwidth(m);
+  lion_oprint(1, "%s ordering %d bandwidth %ld, scrambled %ld\n",
+      simplex ? "tet" : "hex", int(ordering), bw, scrambled);
+  if (ordering == apf::MDS_ORDER_RCM)
+    PCU_ALWAYS_ASSERT(bw < scrambled);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  PCU_ALWAYS_ASSERT(PCU_Comm_Peers() == 1);
+  apf::MdsOrdering orderings[] = {apf::MDS_ORDER_BFS, apf::MDS_ORDER_RCM,
+    apf::MDS_ORDER_HILBERT, apf::MDS_ORDER_MORTON};
+  for (int simplex = 0; simplex < 2; ++simplex)
+    for (int i = 0; i < 4; ++i)
+      check(simplex, orderings[i]);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,57 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+
+static void checkBounds(apf::MemoryUsage const& u)
+{
+  for (int k = 0; k < apf::MemoryUsage::KINDS; ++k)
+  for (int t = 0; t < apf::Mesh::TYPES; ++t)
+    PCU_ALWAYS_ASSERT(u.live[k][t] <= u.allocated[k][t]);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  apf::Mesh2* m = apf::makeMdsBox(4, 4, 4, 1, 1, 1, true);
+  apf::MemoryUsage u = apf::getMdsMemoryUsage(m);
+  checkBounds(u);
+  std::size_t nv = m->count(0);
+  PCU_ALWAYS_ASSERT(u.live[apf::MemoryUsage::COORDINATES][apf::Mesh::VERTEX]
+      == nv * 5 * sizeof(double));
+  PCU_ALWAYS_ASSERT(u.getLive(apf::MemoryUsage::ADJACENCY) > 0);
+  PCU_ALWAYS_ASSERT(u.getAllocated(apf::MemoryUsage::FROZEN_ADJACENCY) == 0);
+  PCU_ALWAYS_ASSERT(u.getAllocated(apf::MemoryUsage::REMOTES) == 0);
+  /* a tag on every vertex adds exactly its values to the live bytes */
+  std::size_t tagsBefore = u.live[apf::MemoryUsage::TAGS][apf::Mesh::VERTEX];
+  apf::MeshTag* t = m->createDoubleTag("x", 3);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    m->setDoubleTag(v, t, &x[0]);
+  }
+  m->end(it);
+  u = apf::getMdsMemoryUsage(m);
+  checkBounds(u);
+  PCU_ALWAYS_ASSERT(u.live[apf::MemoryUsage::TAGS][apf::Mesh::VERTEX]
+      == tagsBefore + nv * 3 * sizeof(double));
+  apf::freezeMdsMesh(m);
+  u = apf::getMdsMemoryUsage(m);
+  PCU_ALWAYS_ASSERT(u.getAllocated(apf::MemoryUsage::FROZEN_ADJACENCY)
+      <= apf::getMdsFrozenBytes(m));
+  PCU_ALWAYS_ASSERT(u.getAllocated(apf::MemoryUsage::FROZEN_ADJACENCY) > 0);
+  apf::printStats(m, true);
+  apf::removeTagFromDimension(m, t, 0);
+  m->destroyTag(t);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
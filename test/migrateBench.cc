@@ -0,0 +1,61 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdlib>
+#include "slabs.h"
+
+static double rotate(apf::Mesh2* m, int rounds)
+{
+  double t0 = PCU_Time();
+  for (int i = 1; i <= rounds; ++i)
+    cutSlabs(m, i);
+  return PCU_Max_Double(PCU_Time() - t0);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <rounds>\n"
+          "  migrates the slabs of an n^3 tet box mesh around the parts\n"
+          "  (rounds) times without and then with the PCU buffer pool\n",
+          argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  int n = atoi(argv[1]);
+  int rounds = atoi(argv[2]);
+  apf::Mesh2* m = makeExpandedBox(n);
+  lion_set_verbosity(0);
+  cutSlabs(m);
+  PCU_Comm_Pool_Limit(0);
+  double unpooled = rotate(m, rounds);
+  PCU_Comm_Pool_Limit(64 * 1024 * 1024);
+  size_t hits0, misses0;
+  PCU_Comm_Pool_Stats(0, &hits0, &misses0);
+  double pooled = rotate(m, rounds);
+  size_t retained, hits, misses;
+  PCU_Comm_Pool_Stats(&retained, &hits, &misses);
+  lion_set_verbosity(1);
+  long elements = PCU_Add_Long(m->count(3));
+  long reused = PCU_Add_Long(long(hits - hits0));
+  long missed = PCU_Add_Long(long(misses - misses0));
+  double kept = PCU_Max_Double(retained / (1024. * 1024.));
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"%ld elements, %d migrations: %f seconds without the "
+        "buffer pool, %f with it (%ld buffers reused, %ld allocated, "
+        "at most %.2f MB kept per part)\n",
+        elements, rounds, unpooled, pooled, reused, missed, kept);
+  PCU_ALWAYS_ASSERT(reused > 0);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,164 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <vector>
+#include "slabs.h"
+
+static int const n = 4;
+
+/* back to back phases around a ring, the second one empty */
+static void testRing()
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  int ranks[2] = {(self + peers - 1) % peers, (self + 1) % peers};
+  for (int round = 0; round < 3; ++round) {
+    PCU_Comm_Begin_Neighbors(ranks, 2);
+    if (round != 1)
+      for (int i = 0; i < 2; ++i) {
+        int value = self * 10 + round;
+        PCU_COMM_PACK(ranks[i], value);
+      }
+    PCU_Comm_Send();
+    int count = 0;
+    while (PCU_Comm_Receive()) {
+      int value;
+      PCU_COMM_UNPACK(value);
+      PCU_ALWAYS_ASSERT(value == PCU_Comm_Sender() * 10 + round);
+      ++count;
+    }
+    PCU_ALWAYS_ASSERT(count == (round == 1 ? 0 : 2));
+  }
+}
+
+static void testFields()
+{
+  apf::Mesh2* m = makeSlabs(n);
+  int self = PCU_Comm_Self();
+  apf::Parts neighbors;
+  PCU_ALWAYS_ASSERT(m->getNeighbors(neighbors));
+  apf::Parts expected;
+  if (self > 0)
+    expected.insert(self - 1);
+  if (self + 1 < PCU_Comm_Peers())
+    expected.insert(self + 1);
+  PCU_ALWAYS_ASSERT(neighbors == expected);
+  apf::Field* f = apf::createLagrangeField(m, "f", apf::SCALAR, 1);
+  apf::Field* g = apf::createLagrangeField(m, "g", apf::SCALAR, 1);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    apf::setScalar(f, v, 0, self + 1);
+    apf::setScalar(g, v, 0, self + 1);
+  }
+  m->end(it);
+  apf::synchronize(f);
+  apf::accumulate(g);
+  it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    PCU_ALWAYS_ASSERT(apf::getScalar(f, v, 0) == m->getOwner(v) + 1);
+    apf::Parts residence;
+    m->getResidence(v, residence);
+    double sum = 0;
+    APF_ITERATE(apf::Parts, residence, rit)
+      sum += *rit + 1;
+    PCU_ALWAYS_ASSERT(apf::getScalar(g, v, 0) == sum);
+  }
+  m->end(it);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+/* every part hears from exactly the parts it lists */
+static void checkSymmetric(apf::Parts const& neighbors)
+{
+  std::vector<int> ranks(neighbors.begin(), neighbors.end());
+  PCU_Comm_Begin_Neighbors(ranks.empty() ? 0 : &ranks[0], ranks.size());
+  for (size_t i = 0; i < ranks.size(); ++i)
+    PCU_COMM_PACK(ranks[i], ranks[i]);
+  PCU_Comm_Send();
+  size_t count = 0;
+  while (PCU_Comm_Receive()) {
+    int to;
+    PCU_COMM_UNPACK(to);
+    PCU_ALWAYS_ASSERT(to == PCU_Comm_Self());
+    PCU_ALWAYS_ASSERT(neighbors.count(PCU_Comm_Sender()));
+    ++count;
+  }
+  PCU_ALWAYS_ASSERT(count == ranks.size());
+}
+
+/* the corner (x,1,1) */
+static bool onCorner(apf::Mesh* m, apf::MeshEntity* v, double x)
+{
+  apf::Vector3 p;
+  m->getPoint(v, 0, p);
+  return (p - apf::Vector3(x, 1, 1)).getLength() < 1e-12;
+}
+
+/* matches a corner of the first slab to one of the last, as a
+   periodic mesh would. with a single matched vertex whose index
+   is not zero, every index must be visited to find the neighbor */
+static void testMatches()
+{
+  apf::Mesh2* m = makeSlabs(n);
+  apf::setMdsMatching(m, true);
+  int self = PCU_Comm_Self();
+  int last = PCU_Comm_Peers() - 1;
+  bool end = (self == 0 || self == last);
+  int other = self ? 0 : last;
+  double x = self ? 1 : 0;
+  apf::MeshEntity* v;
+  apf::MeshIterator* it;
+  PCU_Comm_Begin();
+  if (end) {
+    it = m->begin(0);
+    while ((v = m->iterate(it)))
+      if (onCorner(m, v, x))
+        PCU_COMM_PACK(other, v);
+    m->end(it);
+  }
+  PCU_Comm_Send();
+  while (PCU_Comm_Receive()) {
+    apf::MeshEntity* remote;
+    PCU_COMM_UNPACK(remote);
+    it = m->begin(0);
+    while ((v = m->iterate(it)))
+      if (onCorner(m, v, x)) {
+        PCU_ALWAYS_ASSERT(apf::getMdsIndex(m, v));
+        m->addMatch(v, PCU_Comm_Sender(), remote);
+      }
+    m->end(it);
+  }
+  m->acceptChanges();
+  apf::Parts neighbors;
+  PCU_ALWAYS_ASSERT(m->getNeighbors(neighbors));
+  apf::Parts expected;
+  if (self > 0)
+    expected.insert(self - 1);
+  if (self < last)
+    expected.insert(self + 1);
+  if (end)
+    expected.insert(other);
+  PCU_ALWAYS_ASSERT(neighbors == expected);
+  checkSymmetric(neighbors);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  testRing();
+  testFields();
+  if (PCU_Comm_Peers() > 2)
+    testMatches();
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
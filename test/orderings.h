@@ -0,0 +1,51 @@
+#ifndef TEST_ORDERINGS_H
+#define TEST_ORDERINGS_H
+
+/* helpers shared by the tests and benchmarks of MDS orderings */
+
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+/* maximum index distance between the two vertices of an edge,
+   the bandwidth of a vertex-based sparse matrix */
+inline long bandwidth(apf::Mesh2* m)
+{
+  long bw = 0;
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(1);
+  while ((e = m->iterate(it))) {
+    apf::MeshEntity* v[2];
+    m->getDownward(e, 0, v);
+    long a = apf::getMdsIndex(m, v[0]);
+    long b = apf::getMdsIndex(m, v[1]);
+    bw = std::max(bw, std::abs(a - b));
+  }
+  m->end(it);
+  return bw;
+}
+
+/* a random permutation of the vertices, so that every ordering
+   has work to do and benchmarks start from the worst case */
+inline void scramble(apf::Mesh2* m)
+{
+  std::vector<int> labels(m->count(0));
+  for (size_t i = 0; i < labels.size(); ++i)
+    labels[i] = i;
+  srand(42);
+  for (size_t i = labels.size(); i > 1; --i)
+    std::swap(labels[i - 1], labels[rand() % i]);
+  apf::MeshTag* t = m->createIntTag("scramble", 1);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  size_t i = 0;
+  while ((v = m->iterate(it)))
+    m->setIntTag(v, t, &labels[i++]);
+  m->end(it);
+  /* the numbering tag is consumed by the reordering */
+  apf::reorderMdsMesh(m, t);
+}
+
+#endif
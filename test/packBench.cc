@@ -0,0 +1,81 @@
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdlib>
+
+/* each rank sends its ring neighbors (records) records of
+   one id and (width) doubles, either one scalar at a time
+   or reserving and extracting each record in one call */
+static double exchange(int records, int width, bool bulk)
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  int ranks[2] = {(self + peers - 1) % peers, (self + 1) % peers};
+  double t0 = PCU_Time();
+  PCU_Comm_Begin();
+  for (int i = 0; i < 2; ++i)
+    for (int r = 0; r < records; ++r) {
+      PCU_COMM_PACK(ranks[i], r);
+      if (bulk) {
+        double* v = PCU_COMM_RESERVE(ranks[i], double, width);
+        for (int j = 0; j < width; ++j)
+          v[j] = self + r + j;
+      } else
+        for (int j = 0; j < width; ++j) {
+          double v = self + r + j;
+          PCU_COMM_PACK(ranks[i], v);
+        }
+    }
+  PCU_Comm_Send();
+  double sum = 0;
+  while (PCU_Comm_Receive()) {
+    int r;
+    PCU_COMM_UNPACK(r);
+    double expected = PCU_Comm_Sender() + r;
+    if (bulk) {
+      double const* v = PCU_COMM_EXTRACT(double, width);
+      for (int j = 0; j < width; ++j)
+        sum += v[j] - (expected + j);
+    } else
+      for (int j = 0; j < width; ++j) {
+        double v;
+        PCU_COMM_UNPACK(v);
+        sum += v - (expected + j);
+      }
+  }
+  double t = PCU_Time() - t0;
+  PCU_ALWAYS_ASSERT(sum == 0);
+  return PCU_Max_Double(t);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <records> <iterations>\n"
+          "  times ring exchanges of records with a growing number\n"
+          "  of doubles, packed per scalar and packed in bulk\n",
+          argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  int records = atoi(argv[1]);
+  int iterations = atoi(argv[2]);
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"%d records per neighbor, seconds per exchange\n"
+        "%6s %12s %12s\n", records, "width", "per scalar", "bulk");
+  for (int width = 1; width <= 27; width *= 3) {
+    double t[2] = {0, 0};
+    for (int i = 0; i < iterations; ++i)
+      for (int bulk = 0; bulk < 2; ++bulk)
+        t[bulk] += exchange(records, width, bulk);
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"%6d %12f %12f\n", width,
+          t[0] / iterations, t[1] / iterations);
+  }
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
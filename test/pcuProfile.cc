@@ -0,0 +1,68 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdio>
+#include <cstring>
+#include "slabs.h"
+
+static char const* const prefix = "pcuProfile_";
+
+/* a box cut into slabs along x, one per rank */
+static void migrateSlabs()
+{
+  apf::Mesh2* m = makeSlabs(4);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+static void exchange()
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  PCU_Comm_Begin();
+  for (int to = 0; to < peers; ++to)
+    PCU_COMM_PACK(to, self);
+  PCU_Comm_Send();
+  int count = 0;
+  while (PCU_Comm_Receive()) {
+    int from;
+    PCU_COMM_UNPACK(from);
+    PCU_ALWAYS_ASSERT(from == PCU_Comm_Sender());
+    ++count;
+  }
+  PCU_ALWAYS_ASSERT(count == peers);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  /* labels before enabling are ignored */
+  PCU_Profile_Push("ignored");
+  PCU_Profile_Pop();
+  PCU_Profile_Enable(prefix);
+  PCU_Profile_Push("exchange");
+  exchange();
+  PCU_Profile_Push("sum");
+  PCU_ALWAYS_ASSERT(PCU_Add_Int(1) == PCU_Comm_Peers());
+  PCU_Profile_Pop();
+  PCU_Profile_Pop();
+  migrateSlabs();
+  char name[64];
+  sprintf(name, "%s%d.json", prefix, PCU_Comm_Self());
+  PCU_Comm_Free();
+  FILE* f = fopen(name, "r");
+  PCU_ALWAYS_ASSERT(f);
+  char const* head = "{\"traceEvents\":[";
+  char line[32];
+  PCU_ALWAYS_ASSERT(fgets(line, sizeof(line), f));
+  PCU_ALWAYS_ASSERT(!strncmp(line, head, strlen(head)));
+  fclose(f);
+  remove(name);
+  MPI_Finalize();
+}
@@ -0,0 +1,238 @@
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+/* Microbenchmarks of PCU phases and collectives. Rank 0 prints one
+   CSV row per measurement, the columns named by the header row:
+     benchmark   phase, all_to_some, receive or a collective name
+     ranks       PCU_Comm_Peers()
+     neighbors   ranks each rank sends to, rounded average for
+                 all_to_some, 0 for collectives
+     bytes       payload per message, or per rank for collectives
+     variant     what is being compared within the benchmark
+     iterations  repetitions averaged over
+     min_us, avg_us, max_us   microseconds per repetition,
+                              over the ranks */
+
+static int iterations;
+
+static void report(const char* benchmark, int neighbors, size_t bytes,
+    const char* variant, double seconds)
+{
+  double t = seconds / iterations * 1e6;
+  double lo = PCU_Min_Double(t);
+  double avg = PCU_Add_Double(t) / PCU_Comm_Peers();
+  double hi = PCU_Max_Double(t);
+  if (!PCU_Comm_Self())
+    lion_oprint(1, "%s,%d,%d,%lu,%s,%d,%.3f,%.3f,%.3f\n", benchmark,
+        PCU_Comm_Peers(), neighbors, (unsigned long)bytes, variant,
+        iterations, lo, avg, hi);
+}
+
+/* the ranks within (hops) of this one around a ring,
+   which is symmetric as Begin_Neighbors needs */
+static std::vector<int> getRing(int hops)
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  std::set<int> ranks;
+  for (int d = 1; d <= hops; ++d) {
+    ranks.insert((self + d) % peers);
+    ranks.insert((self + peers - d) % peers);
+  }
+  ranks.erase(self);
+  return std::vector<int>(ranks.begin(), ranks.end());
+}
+
+/* sends (bytes) to each of (to) and checks what arrives */
+static void exchange(std::vector<int> const& to, size_t bytes,
+    bool neighbors, std::vector<int> const& from)
+{
+  if (neighbors)
+    PCU_Comm_Begin_Neighbors(to.empty() ? 0 : &to[0], int(to.size()));
+  else
+    PCU_Comm_Begin();
+  for (size_t i = 0; i < to.size(); ++i) {
+    char* p = PCU_COMM_RESERVE(to[i], char, bytes);
+    memset(p, PCU_Comm_Self() & 0x7f, bytes);
+  }
+  PCU_Comm_Send();
+  size_t received = 0;
+  while (PCU_Comm_Receive()) {
+    char const* p = PCU_COMM_EXTRACT(char, bytes);
+    PCU_ALWAYS_ASSERT(p[bytes - 1] == (PCU_Comm_Sender() & 0x7f));
+    ++received;
+  }
+  PCU_ALWAYS_ASSERT(received == from.size());
+}
+
+static double timeExchanges(std::vector<int> const& to, size_t bytes,
+    bool neighbors, std::vector<int> const& from)
+{
+  exchange(to, bytes, neighbors, from);
+  PCU_Barrier();
+  double t0 = PCU_Time();
+  for (int i = 0; i < iterations; ++i)
+    exchange(to, bytes, neighbors, from);
+  return PCU_Time() - t0;
+}
+
+/* latency of a phase against neighbor count and payload,
+   ending with a barrier or by hearing from every neighbor */
+static void benchPhases(size_t maxBytes)
+{
+  int peers = PCU_Comm_Peers();
+  for (int hops = 1; hops <= peers / 2 || hops == 1; hops *= 2) {
+    std::vector<int> ring = getRing(hops);
+    for (size_t bytes = 8; bytes <= maxBytes; bytes *= 8) {
+      report("phase", int(ring.size()), bytes, "global",
+          timeExchanges(ring, bytes, false, ring));
+      report("phase", int(ring.size()), bytes, "neighbors",
+          timeExchanges(ring, bytes, true, ring));
+    }
+  }
+}
+
+/* each rank sends to an irregular half of the others, so
+   receivers do not know their senders in advance */
+static bool picks(int from, int to)
+{
+  unsigned h = unsigned(from) * 2654435761u ^ unsigned(to) * 40503u;
+  return from != to && (h >> 7) % 2 == 0;
+}
+
+static void benchAllToSome(size_t maxBytes)
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  std::vector<int> to, from;
+  for (int i = 0; i < peers; ++i) {
+    if (picks(self, i))
+      to.push_back(i);
+    if (picks(i, self))
+      from.push_back(i);
+  }
+  long messages = PCU_Add_Long(long(to.size()));
+  int average = int((messages + peers / 2) / peers);
+  for (size_t bytes = 8; bytes <= maxBytes; bytes *= 8)
+    report("all_to_some", average, bytes, "global",
+        timeExchanges(to, bytes, false, from));
+}
+
+/* everyone sends to everyone, receiving in arrival order
+   or in rank order with PCU_Comm_Order */
+static void benchReceive(size_t maxBytes)
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  std::vector<int> all;
+  for (int i = 0; i < peers; ++i)
+    if (i != self)
+      all.push_back(i);
+  for (size_t bytes = 8; bytes <= maxBytes; bytes *= 8)
+    for (int ordered = 0; ordered < 2; ++ordered) {
+      PCU_Comm_Order(ordered);
+      report("receive", int(all.size()), bytes,
+          ordered ? "ordered" : "unordered",
+          timeExchanges(all, bytes, false, all));
+    }
+  PCU_Comm_Order(false);
+}
+
+/* both implementations must agree exactly on integer results */
+static void checkCollectives(size_t n)
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  std::vector<long> a(n), b(n);
+  std::vector<int> c(n), d(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = b[i] = self + long(i);
+    c[i] = d[i] = (self * 7 + int(i)) % peers;
+  }
+  PCU_Native_Collectives(false);
+  PCU_Exscan_Longs(&a[0], n);
+  PCU_Max_Ints(&c[0], n);
+  PCU_Native_Collectives(true);
+  PCU_Exscan_Longs(&b[0], n);
+  PCU_Max_Ints(&d[0], n);
+  for (size_t i = 0; i < n; ++i) {
+    PCU_ALWAYS_ASSERT(a[i] == b[i]);
+    PCU_ALWAYS_ASSERT(a[i] == long(self) * (self - 1) / 2 + self * long(i));
+    PCU_ALWAYS_ASSERT(c[i] == d[i]);
+  }
+}
+
+/* PCU's point-to-point patterns against the MPI collectives */
+static void benchCollectives(size_t maxBytes)
+{
+  checkCollectives(1);
+  checkCollectives(maxBytes / sizeof(long));
+  for (int native = 0; native < 2; ++native) {
+    PCU_Native_Collectives(native);
+    const char* variant = native ? "native" : "patterns";
+    for (size_t n = 1; n * sizeof(double) <= maxBytes; n *= 8) {
+      std::vector<double> x(n, 1.0);
+      std::vector<long> y(n, 1);
+      PCU_Barrier();
+      double t0 = PCU_Time();
+      for (int i = 0; i < iterations; ++i)
+        PCU_Add_Doubles(&x[0], n);
+      report("add_doubles", 0, n * sizeof(double), variant,
+          PCU_Time() - t0);
+      PCU_Barrier();
+      t0 = PCU_Time();
+      for (int i = 0; i < iterations; ++i)
+        PCU_Exscan_Longs(&y[0], n);
+      report("exscan_longs", 0, n * sizeof(long), variant,
+          PCU_Time() - t0);
+    }
+    PCU_Barrier();
+    double t0 = PCU_Time();
+    for (int i = 0; i < iterations; ++i)
+      PCU_Max_Int(i);
+    report("max_int", 0, sizeof(int), variant, PCU_Time() - t0);
+    PCU_Barrier();
+    t0 = PCU_Time();
+    for (int i = 0; i < iterations; ++i)
+      PCU_Barrier();
+    report("barrier", 0, 0, variant, PCU_Time() - t0);
+  }
+  PCU_Native_Collectives(true);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <max bytes> <iterations>\n"
+          "  prints CSV timings of PCU phases, all-to-some exchanges,\n"
+          "  ordered and unordered receives and collectives for\n"
+          "  payloads of 8 up to (max bytes) bytes\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  size_t maxBytes = atol(argv[1]);
+  iterations = atoi(argv[2]);
+  PCU_ALWAYS_ASSERT(maxBytes >= 8);
+  PCU_ALWAYS_ASSERT(iterations > 0);
+  /* messages are received in arrival order except
+     where benchReceive compares the two */
+  PCU_Comm_Order(false);
+  if (!PCU_Comm_Self())
+    lion_oprint(1, "benchmark,ranks,neighbors,bytes,variant,iterations,"
+        "min_us,avg_us,max_us\n");
+  benchPhases(maxBytes);
+  benchAllToSome(maxBytes);
+  benchReceive(maxBytes);
+  benchCollectives(maxBytes);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,69 @@
+#include <ma.h>
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdlib>
+#include <sys/resource.h>
+
+/* peak resident memory of this process in MB */
+static double getPeakMB()
+{
+  struct rusage u;
+  getrusage(RUSAGE_SELF, &u);
+#ifdef __APPLE__
+  return u.ru_maxrss / (1024. * 1024.);
+#else
+  return u.ru_maxrss / 1024.;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 4 && argc != 5) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <levels> <paged> [reservation]\n"
+          "  uniformly refines an n^3 tet box mesh (levels) times\n"
+          "  with heap (0) or paged (1) MDS storage and reports\n"
+          "  the time and peak memory. Paged arrays reserve\n"
+          "  (reservation) KB each, arrays that outgrow it move\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  int n = atoi(argv[1]);
+  int levels = atoi(argv[2]);
+  apf::MdsStorage storage = atoi(argv[3]) ?
+    apf::MDS_STORAGE_PAGED : apf::MDS_STORAGE_HEAP;
+  if (argc == 5)
+    apf::setMdsPagedReservation(size_t(atoi(argv[4])) * 1024);
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true, storage);
+  double startMB = getPeakMB();
+  lion_set_verbosity(0);
+  double t0 = PCU_Time();
+  ma::Input* in = ma::configureUniformRefine(m, levels);
+  in->shouldSnap = false;
+  in->shouldTransferParametric = false;
+  in->shouldFixShape = false;
+  ma::adapt(in);
+  double t = PCU_Time() - t0;
+  lion_set_verbosity(1);
+  double peakMB = PCU_Max_Double(getPeakMB());
+  long elements = PCU_Add_Long(m->count(3));
+  m->verify();
+  PCU_ALWAYS_ASSERT(elements == 6L * n * n * n * (1L << (3 * levels)));
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"%s storage: %ld elements, refined in %f seconds, "
+        "peak memory %.1f MB (%.1f MB before refining)\n",
+        storage == apf::MDS_STORAGE_PAGED ? "paged" : "heap",
+        elements, t, peakMB, startMB);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
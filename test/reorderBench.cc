@@ -0,0 +1,160 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apfNumbering.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "orderings.h"
+
+namespace {
+
+/* hardware cache miss counter, reads -1 where unavailable */
+class CacheMisses
+{
+  public:
+    CacheMisses():fd(-1)
+    {
+#ifdef __linux__
+      perf_event_attr pe;
+      memset(&pe, 0, sizeof(pe));
+      pe.type = PERF_TYPE_HARDWARE;
+      pe.size = sizeof(pe);
+      pe.config = PERF_COUNT_HW_CACHE_MISSES;
+      pe.disabled = 1;
+      pe.exclude_kernel = 1;
+      pe.exclude_hv = 1;
+      fd = syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+#endif
+    }
+    ~CacheMisses()
+    {
+#ifdef __linux__
+      if (fd != -1)
+        close(fd);
+#endif
+    }
+    void start()
+    {
+#ifdef __linux__
+      if (fd == -1)
+        return;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    long long stop()
+    {
+      long long count = -1;
+#ifdef __linux__
+      if (fd == -1)
+        return count;
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &count, sizeof(count)) != sizeof(count))
+        count = -1;
+#endif
+      return count;
+    }
+  private:
+    long fd;
+};
+
+/* a stand-in for assembly: gather element vertex coordinates
+   and scatter a contribution back to a vertex-indexed array */
+double elementLoop(apf::Mesh2* m, std::vector<double>& vertexSums)
+{
+  int d = m->getDimension();
+  std::fill(vertexSums.begin(), vertexSums.end(), 0);
+  double total = 0;
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(d);
+  while ((e = m->iterate(it))) {
+    apf::Downward verts;
+    int nv = m->getDownward(e, 0, verts);
+    apf::Vector3 c(0,0,0);
+    apf::Vector3 x;
+    for (int i = 0; i < nv; ++i) {
+      m->getPoint(verts[i], 0, x);
+      c = c + x;
+    }
+    c = c / nv;
+    for (int i = 0; i < nv; ++i) {
+      m->getPoint(verts[i], 0, x);
+      double w = (x - c).getLength();
+      vertexSums[apf::getMdsIndex(m, verts[i])] += w;
+      total += w;
+    }
+  }
+  m->end(it);
+  return total;
+}
+
+void run(int n, int loops, bool simplex, const char* name, int ordering)
+{
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, simplex);
+  scramble(m);
+  double t0 = PCU_Time();
+  if (ordering >= 0)
+    apf::reorderMdsMesh(m, static_cast<apf::MdsOrdering>(ordering));
+  double reorderTime = PCU_Time() - t0;
+  std::vector<double> vertexSums(m->count(0));
+  CacheMisses misses;
+  elementLoop(m, vertexSums);
+  misses.start();
+  t0 = PCU_Time();
+  for (int i = 0; i < loops; ++i)
+    elementLoop(m, vertexSums);
+  double loopTime = (PCU_Time() - t0) / loops;
+  long long missCount = misses.stop();
+  if (missCount > 0)
+    missCount /= loops;
+  if (!PCU_Comm_Self())
+    lion_oprint(0, "%-8s %10ld %12.6f %12.6f %14lld %10ld\n",
+        name, (long)m->count(m->getDimension()), reorderTime, loopTime,
+        missCount, bandwidth(m));
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 4) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <loops> <simplex>\n"
+          "  times an element loop over an n^3 box mesh\n"
+          "  under each vertex/element ordering\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  int n = atoi(argv[1]);
+  int loops = atoi(argv[2]);
+  bool simplex = atoi(argv[3]);
+  lion_set_verbosity(0);
+  if (!PCU_Comm_Self())
+    lion_oprint(0, "%-8s %10s %12s %12s %14s %10s\n",
+        "order", "elements", "reorder(s)", "loop(s)",
+        "cache misses", "bandwidth");
+  run(n, loops, simplex, "random", -1);
+  run(n, loops, simplex, "bfs", apf::MDS_ORDER_BFS);
+  run(n, loops, simplex, "rcm", apf::MDS_ORDER_RCM);
+  run(n, loops, simplex, "hilbert", apf::MDS_ORDER_HILBERT);
+  run(n, loops, simplex, "morton", apf::MDS_ORDER_MORTON);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
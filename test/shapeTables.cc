@@ -0,0 +1,103 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdlib>
+
+/* sums values, global gradients and dV at every integration point.
+   apf::getIntPoint lets the elements built on its MeshElement read
+   shape tables, so without (tabulated) the points are taken from
+   another MeshElement and every call evaluates the shapes */
+static double sweep(apf::Field* f, int order, bool tabulated)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  int dim = m->getDimension();
+  double sum = 0;
+  apf::NewArray<double> values;
+  apf::NewArray<apf::Vector3> grads;
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(dim);
+  apf::MeshElement* other = apf::createMeshElement(m, m->iterate(it));
+  m->end(it);
+  it = m->begin(dim);
+  while ((e = m->iterate(it))) {
+    apf::MeshElement* me = apf::createMeshElement(m, e);
+    apf::Element* fe = apf::createElement(f, me);
+    int nn = apf::countNodes(fe);
+    int np = apf::countIntPoints(me, order);
+    for (int p = 0; p < np; ++p) {
+      apf::Vector3 xi;
+      apf::getIntPoint(tabulated ? me : other, order, p, xi);
+      apf::getShapeValues(fe, xi, values);
+      apf::getShapeGrads(fe, xi, grads);
+      double dv = apf::getDV(me, xi);
+      for (int i = 0; i < nn; ++i)
+        sum += (values[i] + grads[i] * apf::Vector3(1, 2, 3)) * dv;
+    }
+    apf::destroyElement(fe);
+    apf::destroyMeshElement(me);
+  }
+  m->end(it);
+  apf::destroyMeshElement(other);
+  return sum;
+}
+
+static void compare(apf::Field* f, int order, int steps)
+{
+  double t0 = PCU_Time();
+  double direct = 0;
+  for (int i = 0; i < steps; ++i)
+    direct = sweep(f, order, false);
+  double t1 = PCU_Time();
+  double tabulated = 0;
+  for (int i = 0; i < steps; ++i)
+    tabulated = sweep(f, order, true);
+  double t2 = PCU_Time();
+  /* the tables hold exactly what the shapes evaluate to */
+  PCU_ALWAYS_ASSERT(direct == tabulated);
+  lion_oprint(1, "%-20s %6d %12f %12f\n", apf::getShape(f)->getName(),
+      order, (t1 - t0) / steps, (t2 - t1) / steps);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <steps>\n"
+          "  evaluates shape functions at the integration points of\n"
+          "  an n^3 box, directly and from shape tables\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  PCU_ALWAYS_ASSERT(PCU_Comm_Peers() == 1);
+  int n = atoi(argv[1]);
+  int steps = atoi(argv[2]);
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true);
+  /* orientation dependent shapes are never tabulated */
+  PCU_ALWAYS_ASSERT(!apf::getShapeTable(
+        apf::getHierarchic(3)->getEntityShape(apf::Mesh::TRIANGLE),
+        apf::Mesh::TRIANGLE, 2));
+  apf::Field* fields[3];
+  fields[0] = apf::createLagrangeField(m, "p1", apf::SCALAR, 1);
+  fields[1] = apf::createLagrangeField(m, "p2", apf::SCALAR, 2);
+  fields[2] = apf::createField(m, "h2", apf::SCALAR, apf::getHierarchic(2));
+  lion_oprint(1, "seconds per sweep\n%-20s %6s %12s %12s\n",
+      "shape", "order", "direct", "tabulated");
+  for (int i = 0; i < 3; ++i) {
+    apf::zeroField(fields[i]);
+    compare(fields[i], 2, steps);
+    compare(fields[i], 4, steps);
+    apf::destroyField(fields[i]);
+  }
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,61 @@
+#ifndef TEST_SLABS_H
+#define TEST_SLABS_H
+
+/* mesh fixtures shared by the tests that need a distributed
+   mesh without reading one: a unit tet box made on rank 0
+   and cut along x into one slab per rank */
+
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+
+/* destroys a mesh and leaves its model to the caller */
+inline void destroyKeepingModel(apf::Mesh2* m)
+{
+  apf::disownMdsModel(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+/* send each element to the slab along x given by its centroid,
+   shifted by some number of parts */
+inline void cutSlabs(apf::Mesh2* m, int shift = 0)
+{
+  int peers = PCU_Comm_Peers();
+  apf::Migration* plan = new apf::Migration(m);
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(3);
+  while ((e = m->iterate(it))) {
+    int to = (int(apf::getLinearCentroid(m, e)[0] * peers) + shift) % peers;
+    if (to != PCU_Comm_Self())
+      plan->send(e, to);
+  }
+  m->end(it);
+  m->migrate(plan);
+}
+
+/* an n^3 box on every part of the current communicator,
+   still entirely on part 0. every rank needs the model,
+   rank 0 keeps the mesh */
+inline apf::Mesh2* makeExpandedBox(int n)
+{
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true);
+  gmi_model* g = m->getModel();
+  if (PCU_Comm_Self()) {
+    destroyKeepingModel(m);
+    m = 0;
+  }
+  return apf::expandMdsMesh(m, g, 1);
+}
+
+/* an n^3 box cut into slabs along x, one per part */
+inline apf::Mesh2* makeSlabs(int n)
+{
+  apf::Mesh2* m = makeExpandedBox(n);
+  cutSlabs(m);
+  return m;
+}
+
+#endif
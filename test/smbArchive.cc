@@ -0,0 +1,75 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <gmi.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdio>
+#include <vector>
+#include "slabs.h"
+
+static int const n = 4;
+
+/* written by the first half of the ranks, read by all of them */
+static void testExpand()
+{
+  MPI_Comm world = PCU_Get_Comm();
+  int half = PCU_Comm_Self() < PCU_Comm_Peers() / 2;
+  MPI_Comm group;
+  MPI_Comm_split(world, half, 0, &group);
+  PCU_Switch_Comm(group);
+  apf::Mesh2* m = makeSlabs(n);
+  gmi_model* g = m->getModel();
+  long elements = PCU_Add_Long(m->count(3));
+  if (half)
+    apf::writeMdsArchive(m, "half.smba", 1);
+  destroyKeepingModel(m);
+  PCU_Switch_Comm(world);
+  MPI_Comm_free(&group);
+  m = apf::loadMdsArchive(g, "half.smba");
+  m->verify();
+  PCU_ALWAYS_ASSERT(PCU_Add_Long(m->count(3)) == elements);
+  destroyKeepingModel(m);
+  gmi_destroy(g);
+}
+
+/* more files than one and fewer than the parts */
+static void testSameCount()
+{
+  apf::Mesh2* m = makeSlabs(n);
+  gmi_model* g = m->getModel();
+  std::size_t counts[4];
+  for (int d = 0; d <= 3; ++d)
+    counts[d] = m->count(d);
+  apf::writeMdsArchive(m, "full.smba", 3);
+  destroyKeepingModel(m);
+  m = apf::loadMdsArchive(g, "full.smba");
+  m->verify();
+  for (int d = 0; d <= 3; ++d)
+    PCU_ALWAYS_ASSERT(m->count(d) == counts[d]);
+  destroyKeepingModel(m);
+  gmi_destroy(g);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  PCU_ALWAYS_ASSERT(PCU_Comm_Peers() >= 2);
+  testExpand();
+  testSameCount();
+  PCU_Barrier();
+  if (!PCU_Comm_Self()) {
+    std::remove("half0.smba");
+    for (int i = 0; i < 3; ++i) {
+      char name[32];
+      std::sprintf(name, "full%d.smba", i);
+      std::remove(name);
+    }
+  }
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,106 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <gmi.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdio>
+#include <vector>
+#include "slabs.h"
+
+/* element vertex coordinates and tag values in iteration order */
+static void summarize(apf::Mesh2* m, std::vector<double>& out)
+{
+  out.clear();
+  int d = m->getDimension();
+  apf::MeshTag* dt = m->findTag("dbl");
+  apf::MeshTag* it = m->findTag("int");
+  PCU_ALWAYS_ASSERT(dt && it);
+  apf::MeshEntity* e;
+  apf::MeshIterator* i = m->begin(d);
+  while ((e = m->iterate(i))) {
+    apf::Downward v;
+    int nv = m->getDownward(e, 0, v);
+    for (int j = 0; j < nv; ++j) {
+      apf::Vector3 x;
+      m->getPoint(v[j], 0, x);
+      out.insert(out.end(), &x[0], &x[0] + 3);
+    }
+    double dv[2];
+    m->getDoubleTag(e, dt, dv);
+    out.insert(out.end(), dv, dv + 2);
+    if (m->hasTag(e, it)) {
+      int iv;
+      m->getIntTag(e, it, &iv);
+      out.push_back(iv);
+    }
+  }
+  m->end(i);
+}
+
+/* the version field of an SMB header, a big-endian word
+   after the magic number */
+static unsigned readVersion(const char* path)
+{
+  unsigned char h[8];
+  FILE* f = std::fopen(path, "rb");
+  PCU_ALWAYS_ASSERT(f);
+  PCU_ALWAYS_ASSERT(std::fread(h, 1, 8, f) == 8);
+  std::fclose(f);
+  return (unsigned(h[4]) << 24) | (h[5] << 16) | (h[6] << 8) | h[7];
+}
+
+static void roundTrip(bool simplex, int version)
+{
+  apf::Mesh2* m = apf::makeMdsBox(5, 5, 5, 1, 1, 1, simplex);
+  /* older readers only know version 5 */
+  PCU_ALWAYS_ASSERT(apf::getMdsSmbVersion(m) == 5);
+  apf::setMdsSmbVersion(m, version);
+  int d = m->getDimension();
+  apf::MeshTag* dt = m->createDoubleTag("dbl", 2);
+  apf::MeshTag* it = m->createIntTag("int", 1);
+  apf::MeshEntity* e;
+  apf::MeshIterator* i = m->begin(d);
+  int k = 0;
+  while ((e = m->iterate(i))) {
+    double dv[2] = {k * 0.5, -k * 0.25};
+    m->setDoubleTag(e, dt, dv);
+    if (k % 3 == 0)
+      m->setIntTag(e, it, &k);
+    ++k;
+  }
+  m->end(i);
+  std::vector<double> before;
+  summarize(m, before);
+  gmi_model* g = m->getModel();
+  m->writeNative("smbNative.smb");
+  destroyKeepingModel(m);
+  PCU_ALWAYS_ASSERT(readVersion("smbNative0.smb") == unsigned(version));
+  double t0 = PCU_Time();
+  m = apf::loadMdsMesh(g, "smbNative.smb");
+  double t1 = PCU_Time();
+  m->verify();
+  std::vector<double> after;
+  summarize(m, after);
+  PCU_ALWAYS_ASSERT(after == before);
+  if (!PCU_Comm_Self())
+    lion_oprint(1, "read %ld elements of version %d in %f seconds\n",
+        (long)m->count(d), version, t1 - t0);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  for (int simplex = 0; simplex < 2; ++simplex) {
+    roundTrip(simplex, 5);
+    roundTrip(simplex, 6);
+  }
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
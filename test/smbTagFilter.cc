@@ -0,0 +1,146 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <apf.h>
+#include <gmi.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include "slabs.h"
+
+static void tagMesh(apf::Mesh2* m)
+{
+  int d = m->getDimension();
+  apf::MeshTag* kept = m->createIntTag("kept", 1);
+  apf::MeshTag* big = m->createDoubleTag("big", 8);
+  apf::MeshTag* few = m->createIntTag("few", 1);
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(d);
+  int k = 0;
+  while ((e = m->iterate(it))) {
+    double v[8] = {0};
+    m->setIntTag(e, kept, &k);
+    m->setDoubleTag(e, big, v);
+    if (k % 5 == 0)
+      m->setIntTag(e, few, &k);
+    ++k;
+  }
+  m->end(it);
+  apf::Field* f = apf::createLagrangeField(m, "u", apf::SCALAR, 1);
+  apf::Field* g = apf::createLagrangeField(m, "w", apf::VECTOR, 1);
+  it = m->begin(0);
+  while ((e = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(e, 0, x);
+    apf::setScalar(f, e, 0, x[0]);
+    apf::setVector(g, e, 0, x);
+  }
+  m->end(it);
+}
+
+static void checkMesh(apf::Mesh2* m)
+{
+  PCU_ALWAYS_ASSERT(!m->findTag("big"));
+  PCU_ALWAYS_ASSERT(!m->findTag("few"));
+  PCU_ALWAYS_ASSERT(!m->findField("w"));
+  PCU_ALWAYS_ASSERT(!m->findTag("w_ver"));
+  apf::MeshTag* kept = m->findTag("kept");
+  PCU_ALWAYS_ASSERT(kept);
+  int d = m->getDimension();
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(d);
+  int k = 0;
+  while ((e = m->iterate(it))) {
+    int v;
+    m->getIntTag(e, kept, &v);
+    PCU_ALWAYS_ASSERT(v == k);
+    ++k;
+  }
+  m->end(it);
+  apf::Field* f = m->findField("u");
+  PCU_ALWAYS_ASSERT(f);
+  it = m->begin(0);
+  while ((e = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(e, 0, x);
+    PCU_ALWAYS_ASSERT(apf::getScalar(f, e, 0) == x[0]);
+  }
+  m->end(it);
+}
+
+/* both SMB versions lay tags out differently to skip over */
+static void filter(int version)
+{
+  apf::Mesh2* m = apf::makeMdsBox(4, 4, 4, 1, 1, 1, true);
+  apf::setMdsSmbVersion(m, version);
+  tagMesh(m);
+  gmi_model* g = m->getModel();
+  m->writeNative("smbTagFilter.smb");
+  destroyKeepingModel(m);
+  const char* tags[] = {"kept", "u", 0};
+  m = apf::loadMdsMesh(g, "smbTagFilter.smb", tags);
+  m->verify();
+  checkMesh(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+/* an edge node off its straight edge, which only the
+   coordinate tags of a quadratic mesh remember */
+static apf::Vector3 bend(apf::Vector3 const& x)
+{
+  return x + apf::Vector3(0, 0, 0.01 * x[0]);
+}
+
+static void bendEdges(apf::Mesh2* m, bool set)
+{
+  apf::MeshEntity* e;
+  apf::MeshIterator* it = m->begin(1);
+  while ((e = m->iterate(it))) {
+    apf::Vector3 x = apf::getLinearCentroid(m, e);
+    apf::Vector3 y;
+    if (set)
+      m->setPoint(e, 0, bend(x));
+    else {
+      m->getPoint(e, 0, y);
+      PCU_ALWAYS_ASSERT((y - bend(x)).getLength() < 1e-15);
+    }
+  }
+  m->end(it);
+}
+
+/* the coordinates of a curved mesh are tags as well,
+   and load without being listed */
+static void curved(int version)
+{
+  apf::Mesh2* m = apf::makeMdsBox(2, 2, 2, 1, 1, 1, true);
+  apf::setMdsSmbVersion(m, version);
+  apf::changeMeshShape(m, apf::getLagrange(2), true);
+  bendEdges(m, true);
+  tagMesh(m);
+  gmi_model* g = m->getModel();
+  m->writeNative("smbTagFilter.smb");
+  destroyKeepingModel(m);
+  const char* tags[] = {"kept", 0};
+  m = apf::loadMdsMesh(g, "smbTagFilter.smb", tags);
+  PCU_ALWAYS_ASSERT(m->getShape() == apf::getLagrange(2));
+  PCU_ALWAYS_ASSERT(!m->findField("u"));
+  m->verify();
+  bendEdges(m, false);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  filter(5);
+  filter(6);
+  curved(5);
+  curved(6);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
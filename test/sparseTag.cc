@@ -0,0 +1,125 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <gmi.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include "slabs.h"
+
+static int const n = 6;
+
+/* an identifier that survives reordering and file round trips */
+static int gridId(apf::Mesh* m, apf::MeshEntity* v)
+{
+  apf::Vector3 x;
+  m->getPoint(v, 0, x);
+  int id = 0;
+  for (int i = 2; i >= 0; --i)
+    id = id * (n + 1) + int(x[i] * n + 0.5);
+  return id;
+}
+
+static bool isTagged(int id)
+{
+  return id % 37 == 0;
+}
+
+static void tagFew(apf::Mesh2* m, apf::MeshTag* t)
+{
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    int id = gridId(m, v);
+    if (isTagged(id))
+      m->setIntTag(v, t, &id);
+  }
+  m->end(it);
+}
+
+static void checkFew(apf::Mesh2* m, apf::MeshTag* t)
+{
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    int id = gridId(m, v);
+    PCU_ALWAYS_ASSERT(m->hasTag(v, t) == isTagged(id));
+    if (!isTagged(id))
+      continue;
+    int value;
+    m->getIntTag(v, t, &value);
+    PCU_ALWAYS_ASSERT(value == id);
+  }
+  m->end(it);
+  /* so few values are kept out of the dense arrays */
+  apf::TagArray a;
+  PCU_ALWAYS_ASSERT(!m->getTagArray(t, apf::Mesh::VERTEX, a));
+}
+
+/* filling the tag moves it to arrays, emptying it moves it back */
+static void testSwitching(apf::Mesh2* m)
+{
+  apf::MeshTag* t = m->createIntTag("all", 1);
+  apf::setMdsTagSparse(m, t, true);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    int id = gridId(m, v);
+    m->setIntTag(v, t, &id);
+  }
+  m->end(it);
+  apf::TagArray a;
+  PCU_ALWAYS_ASSERT(m->getTagArray(t, apf::Mesh::VERTEX, a));
+  it = m->begin(0);
+  while ((v = m->iterate(it)))
+    if (!isTagged(gridId(m, v)))
+      m->removeTag(v, t);
+  m->end(it);
+  checkFew(m, t);
+  apf::setMdsTagSparse(m, t, false);
+  PCU_ALWAYS_ASSERT(m->getTagArray(t, apf::Mesh::VERTEX, a));
+  apf::setMdsTagSparse(m, t, true);
+  checkFew(m, t);
+  apf::removeTagFromDimension(m, t, 0);
+  m->destroyTag(t);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true);
+  testSwitching(m);
+  apf::MeshTag* t = m->createIntTag("few", 1);
+  apf::setMdsTagSparse(m, t, true);
+  tagFew(m, t);
+  checkFew(m, t);
+  apf::reorderMdsMesh(m, apf::MDS_ORDER_RCM);
+  checkFew(m, t);
+  apf::compactMdsMesh(m);
+  checkFew(m, t);
+  gmi_model* g = m->getModel();
+  /* version 6 files keep the storage choice, version 5 files do not */
+  m->writeNative("sparseTag.smb");
+  apf::setMdsSmbVersion(m, 6);
+  m->writeNative("sparseTag6.smb");
+  destroyKeepingModel(m);
+  m = apf::loadMdsMesh(g, "sparseTag.smb");
+  t = m->findTag("few");
+  PCU_ALWAYS_ASSERT(t);
+  apf::TagArray a;
+  PCU_ALWAYS_ASSERT(m->getTagArray(t, apf::Mesh::VERTEX, a));
+  apf::setMdsTagSparse(m, t, true);
+  checkFew(m, t);
+  destroyKeepingModel(m);
+  m = apf::loadMdsMesh(g, "sparseTag6.smb");
+  t = m->findTag("few");
+  PCU_ALWAYS_ASSERT(t);
+  checkFew(m, t);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,148 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "slabs.h"
+
+/* a value that tells apart fields, entities, nodes and components */
+static double getValue(apf::Mesh* m, apf::MeshEntity* e, int k, int node,
+    int component)
+{
+  apf::Vector3 x = apf::getLinearCentroid(m, e);
+  return x[0] * 100 + x[1] * 10 + x[2] + k * 1000 + node * 0.5 + component;
+}
+
+/* owned nodes get their value, copies get (other) */
+static void setValues(apf::Field* f, int k, bool all, double other)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::FieldShape* s = apf::getShape(f);
+  int nc = apf::countComponents(f);
+  std::vector<double> c(nc);
+  for (int d = 0; d <= 3; ++d) {
+    if (!s->hasNodesIn(d))
+      continue;
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it))) {
+      int nn = s->countNodesOn(m->getType(e));
+      for (int i = 0; i < nn; ++i) {
+        for (int j = 0; j < nc; ++j)
+          c[j] = (all || m->isOwned(e)) ? getValue(m, e, k, i, j) : other;
+        apf::setComponents(f, e, i, &c[0]);
+      }
+    }
+    m->end(it);
+  }
+}
+
+/* every node holds its value, times its copies when (shared) */
+static void checkValues(apf::Field* f, int k, bool shared)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::FieldShape* s = apf::getShape(f);
+  int nc = apf::countComponents(f);
+  std::vector<double> c(nc);
+  for (int d = 0; d <= 3; ++d) {
+    if (!s->hasNodesIn(d))
+      continue;
+    apf::MeshEntity* e;
+    apf::MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it))) {
+      apf::Parts residence;
+      m->getResidence(e, residence);
+      double factor = shared ? residence.size() : 1;
+      int nn = s->countNodesOn(m->getType(e));
+      for (int i = 0; i < nn; ++i) {
+        apf::getComponents(f, e, i, &c[0]);
+        for (int j = 0; j < nc; ++j)
+          PCU_ALWAYS_ASSERT(c[j] == getValue(m, e, k, i, j) * factor);
+      }
+    }
+    m->end(it);
+  }
+}
+
+/* vertex, edge and face nodes with 1, 3 and 9 components */
+static void testMixed(apf::Mesh2* m)
+{
+  std::vector<apf::Field*> fields;
+  fields.push_back(apf::createLagrangeField(m, "p", apf::SCALAR, 1));
+  fields.push_back(apf::createLagrangeField(m, "u", apf::VECTOR, 2));
+  fields.push_back(apf::createField(m, "t", apf::MATRIX,
+        apf::getConstant(2)));
+  for (size_t k = 0; k < fields.size(); ++k)
+    setValues(fields[k], k, false, -1);
+  apf::synchronize(fields);
+  for (size_t k = 0; k < fields.size(); ++k)
+    checkValues(fields[k], k, false);
+  for (size_t k = 0; k < fields.size(); ++k)
+    setValues(fields[k], k, true, 0);
+  apf::accumulate(fields);
+  for (size_t k = 0; k < fields.size(); ++k)
+    checkValues(fields[k], k, true);
+  for (size_t k = 0; k < fields.size(); ++k)
+    apf::destroyField(fields[k]);
+  /* an empty group has nothing to send */
+  fields.clear();
+  apf::synchronize(fields);
+  apf::accumulate(fields);
+}
+
+static void timeFields(apf::Mesh2* m, int count, int steps)
+{
+  std::vector<apf::Field*> fields;
+  for (int k = 0; k < count; ++k) {
+    char name[16];
+    sprintf(name, "f%d", k);
+    fields.push_back(apf::createLagrangeField(m, name, apf::VECTOR, 1));
+    setValues(fields[k], k, false, -1);
+  }
+  double t0 = PCU_Time();
+  for (int i = 0; i < steps; ++i)
+    for (int k = 0; k < count; ++k)
+      apf::synchronize(fields[k]);
+  double t1 = PCU_Time();
+  for (int i = 0; i < steps; ++i)
+    apf::synchronize(fields);
+  double t2 = PCU_Time();
+  for (int k = 0; k < count; ++k) {
+    checkValues(fields[k], k, false);
+    apf::destroyField(fields[k]);
+  }
+  double one = PCU_Max_Double(t1 - t0) / steps;
+  double all = PCU_Max_Double(t2 - t1) / steps;
+  if (!PCU_Comm_Self())
+    lion_oprint(1, "%d fields: %f seconds one at a time, %f together\n",
+        count, one, all);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 4) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <fields> <steps>\n"
+          "  checks grouped synchronize and accumulate on an n^3 box\n"
+          "  and times (fields) vector fields synchronized one at a\n"
+          "  time and together\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  apf::Mesh2* m = makeSlabs(atoi(argv[1]));
+  testMixed(m);
+  timeFields(m, atoi(argv[2]), atoi(argv[3]));
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,77 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+
+static void testVertexTag(apf::Mesh2* m)
+{
+  apf::MeshTag* t = m->createDoubleTag("x", 3);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  int i = 0;
+  while ((v = m->iterate(it))) {
+    /* leave every other vertex without the tag */
+    if (i++ % 2)
+      continue;
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    m->setDoubleTag(v, t, &x[0]);
+  }
+  m->end(it);
+  apf::TagArray a;
+  PCU_ALWAYS_ASSERT(m->getTagArray(t, apf::Mesh::VERTEX, a));
+  PCU_ALWAYS_ASSERT(a.stride == 3 * sizeof(double));
+  PCU_ALWAYS_ASSERT(a.count == m->count(0));
+  /* writes through the view are seen by the per-entity API */
+  size_t tagged = 0;
+  for (size_t j = 0; j < a.count; ++j)
+    if (a.hasValue(j)) {
+      a.get<double>(j)[0] *= 2;
+      ++tagged;
+    }
+  PCU_ALWAYS_ASSERT(tagged == (m->count(0) + 1) / 2);
+  it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    int j = apf::getMdsIndex(m, v);
+    PCU_ALWAYS_ASSERT(m->hasTag(v, t) == a.hasValue(j));
+    if (!a.hasValue(j))
+      continue;
+    apf::Vector3 x;
+    apf::Vector3 y;
+    m->getPoint(v, 0, x);
+    m->getDoubleTag(v, t, &y[0]);
+    PCU_ALWAYS_ASSERT(y[0] == 2 * x[0]);
+    PCU_ALWAYS_ASSERT(y[1] == x[1]);
+    PCU_ALWAYS_ASSERT(y[2] == x[2]);
+  }
+  m->end(it);
+  apf::removeTagFromDimension(m, t, 0);
+  m->destroyTag(t);
+}
+
+static void testUnusedType(apf::Mesh2* m)
+{
+  apf::MeshTag* t = m->createIntTag("n", 1);
+  apf::TagArray a;
+  PCU_ALWAYS_ASSERT(m->getTagArray(t, apf::Mesh::EDGE, a));
+  PCU_ALWAYS_ASSERT(a.count == 0);
+  PCU_ALWAYS_ASSERT(a.stride == sizeof(int));
+  m->destroyTag(t);
+}
+
+int main()
+{
+  MPI_Init(0,0);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  apf::Mesh2* m = apf::makeMdsBox(3, 3, 3, 1, 1, 1, true);
+  testVertexTag(m);
+  testUnusedType(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
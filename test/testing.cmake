@@ -34,6 +34,34 @@ mpi_test(qr_test 1 ./qr)
 mpi_test(base64 1 ./base64)
 mpi_test(tensor_test 1 ./tensor)
 mpi_test(verify_convert 1 ./verify_convert)
+mpi_test(freeze 1 ./freeze)
+mpi_test(reorderBench 1 ./reorderBench 4 1 1)
+mpi_test(mdsOrderings 1 ./mdsOrderings)
+mpi_test(compact 1 ./compact)
+mpi_test(compact_4 4 ./compact)
+mpi_test(refineBench_heap 1 ./refineBench 4 1 0)
+mpi_test(refineBench_paged 1 ./refineBench 4 1 1)
+mpi_test(refineBench_moved 1 ./refineBench 4 1 1 16)
+mpi_test(tagArray 1 ./tagArray)
+mpi_test(sparseTag 1 ./sparseTag)
+mpi_test(smbNative 1 ./smbNative)
+mpi_test(smbTagFilter 1 ./smbTagFilter)
+mpi_test(smbArchive 4 ./smbArchive)
+mpi_test(memoryUsage 1 ./memoryUsage)
+mpi_test(neighborExchange 4 ./neighborExchange)
+mpi_test(commPlan 4 ./commPlan)
+mpi_test(migrateBench 4 ./migrateBench 8 4)
+mpi_test(asyncExchange 4 ./asyncExchange)
+mpi_test(pcuProfile 4 ./pcuProfile)
+mpi_test(threadParts 2 ./threadParts 2 6 2)
+mpi_test(packBench 4 ./packBench 10000 5)
+mpi_test(writeBehind 2 ./writeBehind 12 4)
+mpi_test(pcu_bench 4 ./pcu_bench 4096 20)
+mpi_test(syncFields 4 ./syncFields 8 10 20)
+mpi_test(threadLoops 1 ./threadLoops 10 4)
+mpi_test(shapeTables 1 ./shapeTables 8 5)
+mpi_test(affineGeometry 1 ./affineGeometry 8 5)
+mpi_test(batchEval 1 ./batchEval 8 3)
 mpi_test(test_integrator 1
          ./test_integrator
          "${MESHES}/cube/cube.dmg"
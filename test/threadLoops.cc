@@ -0,0 +1,145 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cmath>
+#include <cstdlib>
+
+/* integrates the square of a field */
+class SquareIntegrator : public apf::Integrator
+{
+  public:
+    SquareIntegrator(apf::Field* f):
+      apf::Integrator(4), field(f), element(0), sum(0)
+    {
+    }
+    void inElement(apf::MeshElement* me)
+    {
+      element = apf::createElement(field, me);
+    }
+    void outElement()
+    {
+      apf::destroyElement(element);
+    }
+    void atPoint(apf::Vector3 const& p, double w, double dV)
+    {
+      apf::Vector3 v;
+      apf::getVector(element, p, v);
+      sum += (v * v) * w * dV;
+    }
+    void parallelReduce()
+    {
+      sum = PCU_Add_Double(sum);
+    }
+    apf::Integrator* clone()
+    {
+      return new SquareIntegrator(field);
+    }
+    void join(apf::Integrator* copy)
+    {
+      sum += static_cast<SquareIntegrator*>(copy)->sum;
+    }
+    apf::Field* field;
+    apf::Element* element;
+    double sum;
+};
+
+static apf::Field* makeField(apf::Mesh* m, const char* name)
+{
+  apf::Field* f = apf::createLagrangeField(m, name, apf::VECTOR, 2);
+  apf::projectField(f, m->getCoordinateField());
+  return f;
+}
+
+static double integrate(apf::Field* f, int threads, double* seconds)
+{
+  apf::setLoopThreads(threads);
+  SquareIntegrator in(f);
+  double t0 = PCU_Time();
+  in.process(apf::getMesh(f));
+  *seconds = PCU_Time() - t0;
+  apf::setLoopThreads(1);
+  return in.sum;
+}
+
+static void checkIntegrals(apf::Field* f, int threads)
+{
+  double t1, tn;
+  double one = integrate(f, 1, &t1);
+  double many = integrate(f, threads, &tn);
+  double again = integrate(f, threads, &tn);
+  /* the integral of x^2+y^2+z^2 over the unit cube is 1 */
+  PCU_ALWAYS_ASSERT(std::fabs(one - 1) < 1e-10);
+  PCU_ALWAYS_ASSERT(std::fabs(many - one) < 1e-12);
+  PCU_ALWAYS_ASSERT(many == again);
+  lion_oprint(1, "integral: %f seconds on 1 thread, %f on %d\n",
+      t1, tn, threads);
+}
+
+/* axpy overwrites values y has, in dense or sparse tags,
+   zeroing a frozen field overwrites its array */
+static void checkFieldOps(apf::Field* x, int threads)
+{
+  apf::Mesh2* m = static_cast<apf::Mesh2*>(apf::getMesh(x));
+  apf::Field* y = makeField(m, "y");
+  apf::Field* z = makeField(m, "z");
+  apf::Field* s = makeField(m, "s");
+  apf::setMdsTagSparse(m, m->findTag("s_ver"), true);
+  apf::setMdsTagSparse(m, m->findTag("s_edg"), true);
+  apf::axpy(2, x, y);
+  apf::setLoopThreads(threads);
+  apf::axpy(2, x, z);
+  apf::axpy(2, x, s);
+  apf::freeze(x);
+  apf::zeroField(x);
+  apf::setLoopThreads(1);
+  double t;
+  PCU_ALWAYS_ASSERT(integrate(x, 1, &t) == 0);
+  apf::unfreeze(x);
+  apf::MeshEntity* e;
+  for (int d = 0; d <= 1; ++d) {
+    apf::MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it))) {
+      apf::Vector3 a, b;
+      apf::getVector(y, e, 0, a);
+      apf::getVector(z, e, 0, b);
+      PCU_ALWAYS_ASSERT((a - b).getLength() == 0);
+      apf::getVector(s, e, 0, b);
+      PCU_ALWAYS_ASSERT((a - b).getLength() == 0);
+    }
+    m->end(it);
+  }
+  apf::destroyField(y);
+  apf::destroyField(z);
+  apf::destroyField(s);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <threads>\n"
+          "  integrates over an n^3 box and applies field operations\n"
+          "  with one thread and with (threads) threads\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  PCU_ALWAYS_ASSERT(PCU_Comm_Peers() == 1);
+  int n = atoi(argv[1]);
+  int threads = atoi(argv[2]);
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true);
+  apf::Field* x = makeField(m, "x");
+  checkIntegrals(x, threads);
+  checkFieldOps(x, threads);
+  apf::destroyField(x);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,86 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <apfShape.h>
+#include <gmi.h>
+#include <PCU.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdlib>
+#include <vector>
+#include "slabs.h"
+
+/* a run of this benchmark with P processes of T threads each
+   has P*T parts and can be compared with P*T processes of one */
+
+static int n;
+static int rounds;
+
+static void synchronizeOwners(apf::Field* f)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it)))
+    apf::setScalar(f, v, 0, m->isOwned(v) ? PCU_Comm_Self() : -1);
+  m->end(it);
+  apf::synchronize(f);
+  it = m->begin(0);
+  while ((v = m->iterate(it)))
+    PCU_ALWAYS_ASSERT(apf::getScalar(f, v, 0) == m->getOwner(v));
+  m->end(it);
+}
+
+static void* run(void*)
+{
+  apf::Mesh2* m = makeSlabs(n);
+  double t0 = PCU_Time();
+  for (int i = 1; i <= rounds; ++i)
+    cutSlabs(m, i);
+  double migration = PCU_Max_Double(PCU_Time() - t0);
+  apf::Field* f = apf::createLagrangeField(m, "owner", apf::SCALAR, 1);
+  t0 = PCU_Time();
+  for (int i = 0; i < rounds; ++i)
+    synchronizeOwners(f);
+  double synchronization = PCU_Max_Double(PCU_Time() - t0);
+  m->verify();
+  long elements = PCU_Add_Long(m->count(3));
+  PCU_ALWAYS_ASSERT(elements == 6L * n * n * n);
+  if (!PCU_Comm_Self())
+    lion_oprint(1,"%d parts (%d processes of %d threads): "
+        "%d migrations %f seconds, %d synchronizations %f seconds\n",
+        PCU_Comm_Peers(), PCU_Proc_Peers(), PCU_Thrd_Peers(),
+        rounds, migration, rounds, synchronization);
+  apf::destroyField(f);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  /* PCU_Thrd_Run fails if several ranks run threads
+     without MPI_THREAD_MULTIPLE */
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 4) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <threads> <n> <rounds>\n"
+          "  each of (threads) threads per process owns a part of an\n"
+          "  n^3 tet box mesh, whose slabs are migrated around the parts\n"
+          "  and then synchronized (rounds) times\n",
+          argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  int threads = atoi(argv[1]);
+  n = atoi(argv[2]);
+  rounds = atoi(argv[3]);
+  std::vector<void*> args(threads, (void*)0);
+  PCU_Thrd_Run(threads, run, &args[0]);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,148 @@
+#include <apfMDS.h>
+#include <apfBox.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <gmi.h>
+#include <PCU.h>
+#include <pcu_io.h>
+#include <lionPrint.h>
+#include <pcu_util.h>
+#include <cstdio>
+#include <cstdlib>
+#include "slabs.h"
+
+/* every rank writes its own box with a checkpoint-like
+   tag of three doubles per vertex */
+static apf::Mesh2* makeBox(int n, apf::MeshTag** t)
+{
+  apf::Mesh2* m = apf::makeMdsBox(n, n, n, 1, 1, 1, true);
+  *t = m->createDoubleTag("x", 3);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    m->setDoubleTag(v, *t, &x[0]);
+  }
+  m->end(it);
+  return m;
+}
+
+static void check(gmi_model* g, std::size_t elements)
+{
+  apf::Mesh2* m = apf::loadMdsMesh(g, "wb_0_.smb");
+  PCU_ALWAYS_ASSERT(m->count(3) == elements);
+  apf::MeshTag* t = m->findTag("x");
+  PCU_ALWAYS_ASSERT(t);
+  apf::MeshEntity* v;
+  apf::MeshIterator* it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x, y;
+    m->getPoint(v, 0, x);
+    m->getDoubleTag(v, t, &y[0]);
+    PCU_ALWAYS_ASSERT((x - y).getLength() == 0);
+  }
+  m->end(it);
+  apf::removeTagFromDimension(m, t, 0);
+  m->destroyTag(t);
+  destroyKeepingModel(m);
+}
+
+static void run(apf::Mesh2* m, int writes, size_t block, bool background,
+    const char* name)
+{
+  pcu_io_write_behind(block, background);
+  pcu_io_stats before, after;
+  pcu_io_get_stats(&before);
+  PCU_Barrier();
+  double t0 = PCU_Time();
+  for (int i = 0; i < writes; ++i) {
+    char path[32];
+    std::sprintf(path, "wb_%d_.smb", i);
+    m->writeNative(path);
+  }
+  double t1 = PCU_Time();
+  pcu_io_sync();
+  double t2 = PCU_Time();
+  pcu_io_get_stats(&after);
+  double mb = (after.bytes - before.bytes) / 1e6;
+  double disk = after.write_seconds - before.write_seconds;
+  double returned = PCU_Max_Double(t1 - t0) / writes;
+  double synced = PCU_Max_Double(t2 - t0) / writes;
+  if (!PCU_Comm_Self())
+    lion_oprint(1, "%-12s %10f %10f %8lu %10.1f\n", name, returned, synced,
+        (unsigned long)(after.blocks - before.blocks) / writes,
+        disk > 0 ? mb / disk : 0.0);
+}
+
+/* a run that only writes checkpoints never reads them back,
+   so closing must collect the finished writer threads itself */
+static void churn(int files)
+{
+  pcu_io_write_behind(1 << 16, true);
+  pcu_io_stats before, s;
+  pcu_io_get_stats(&before);
+  char data[1000] = {0};
+  char path[32];
+  for (int i = 0; i < files; ++i) {
+    std::sprintf(path, "churn_%d_%d.dat", i, PCU_Comm_Self());
+    pcu_file* f = pcu_fopen(path, true, false);
+    pcu_write(f, data, sizeof(data));
+    pcu_fclose(f);
+    pcu_io_get_stats(&s);
+    PCU_ALWAYS_ASSERT(s.pending <= 8);
+  }
+  pcu_io_sync();
+  pcu_io_get_stats(&s);
+  PCU_ALWAYS_ASSERT(s.pending == 0);
+  PCU_ALWAYS_ASSERT(s.files - before.files == (size_t)files);
+  for (int i = 0; i < files; ++i) {
+    std::sprintf(path, "churn_%d_%d.dat", i, PCU_Comm_Self());
+    std::remove(path);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  lion_set_verbosity(1);
+  if (argc != 3) {
+    if (!PCU_Comm_Self())
+      lion_oprint(1,"Usage: %s <n> <writes>\n"
+          "  writes an n^3 box per rank (writes) times with every record\n"
+          "  going straight to the file, through blocks, and through\n"
+          "  blocks drained by a background thread\n", argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  int n = atoi(argv[1]);
+  int writes = atoi(argv[2]);
+  apf::MeshTag* t;
+  apf::Mesh2* m = makeBox(n, &t);
+  gmi_model* g = m->getModel();
+  std::size_t elements = m->count(3);
+  if (!PCU_Comm_Self())
+    lion_oprint(1, "seconds per write, blocks per write, disk MB/s\n"
+        "%-12s %10s %10s %8s %10s\n",
+        "mode", "returned", "synced", "blocks", "MB/s");
+  run(m, writes, 0, false, "direct");
+  check(g, elements);
+  run(m, writes, 1 << 20, false, "blocks");
+  check(g, elements);
+  run(m, writes, 1 << 16, true, "background");
+  /* reading calls pcu_io_sync, so this sees the whole file */
+  check(g, elements);
+  churn(100);
+  apf::removeTagFromDimension(m, t, 0);
+  m->destroyTag(t);
+  destroyKeepingModel(m);
+  gmi_destroy(g);
+  for (int i = 0; i < writes; ++i) {
+    char name[32];
+    std::sprintf(name, "wb_%d_%d.smb", i, PCU_Comm_Self());
+    std::remove(name);
+  }
+  PCU_Comm_Free();
+  MPI_Finalize();
+}